@@ -0,0 +1,360 @@
+/**
+ * IFJ24
+ * @brief Control-flow graph of one function's generated code.
+ * @details Blocks are maximal runs of instructions entered only at a LABEL and left
+ *          only by their last instruction. The graph records successor and
+ *          predecessor edges, immediate dominators and the nesting of natural loops.
+ */
+
+#include "cfg.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Grows a dynamic array, exiting on allocation failure.
+ */
+static void *cfg_grow(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, *capacity * item_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Could not allocate memory for control-flow graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static void *cfg_alloc(size_t count, size_t item_size) {
+    void *array = calloc(count ? count : 1, item_size);
+    if (!array) {
+        fprintf(stderr, "Error: Could not allocate memory for control-flow graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+/**
+ * @brief Checks whether an instruction is a conditional or unconditional jump.
+ * @param instr Instruction to check.
+ * @return True for JUMP and all JUMPIF variants.
+ */
+bool cfg_is_jump(const ir_instr_t *instr) {
+    return strncmp(instr->opcode, "JUMP", 4) == 0;
+}
+
+/**
+ * @brief Checks whether control may leave the block after an instruction.
+ * @param instr Instruction to check.
+ * @return True for jumps, RETURN and EXIT.
+ */
+bool cfg_ends_block(const ir_instr_t *instr) {
+    return cfg_is_jump(instr) || ir_is(instr, "RETURN") || ir_is(instr, "EXIT");
+}
+
+/**
+ * @brief Finds the block starting with the given label.
+ * @param cfg Control-flow graph.
+ * @param label Label operand, e.g. "$while_start_3".
+ * @return Index of the block, or -1 if the label is not defined in the function.
+ */
+int cfg_find_label(const cfg_t *cfg, const char *label) {
+    for (int b = 0; b < cfg->block_count; b++) {
+        ir_instr_t *first = cfg->blocks[b].first;
+        if (ir_is(first, "LABEL") && strcmp(first->operands[0], label) == 0) return b;
+    }
+    return -1;
+}
+
+static void cfg_add_predecessor(cfg_block_t *block, int predecessor) {
+    if (block->predecessor_count == block->predecessor_capacity) {
+        block->predecessors = cfg_grow(block->predecessors, &block->predecessor_capacity, sizeof(int));
+    }
+    block->predecessors[block->predecessor_count++] = predecessor;
+}
+
+/**
+ * @brief Splits the instructions into blocks and connects them.
+ */
+static void cfg_build_blocks(cfg_t *cfg, ir_list_t *code) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        cfg_block_t *current = cfg->block_count ? &cfg->blocks[cfg->block_count - 1] : NULL;
+        if (!current || ir_is(instr, "LABEL") || cfg_ends_block(current->last)) {
+            if (cfg->block_count == cfg->block_capacity) {
+                cfg->blocks = cfg_grow(cfg->blocks, &cfg->block_capacity, sizeof(cfg_block_t));
+            }
+            current = &cfg->blocks[cfg->block_count++];
+            memset(current, 0, sizeof(cfg_block_t));
+            current->first = instr;
+            current->idom = -1;
+            current->loop_header = -1;
+        }
+        current->last = instr;
+    }
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        cfg_block_t *block = &cfg->blocks[b];
+        ir_instr_t *last = block->last;
+        bool falls_through = !ir_is(last, "JUMP") && !ir_is(last, "RETURN") && !ir_is(last, "EXIT");
+        block->successors[0] = falls_through && b + 1 < cfg->block_count ? b + 1 : -1;
+        block->successors[1] = cfg_is_jump(last) ? cfg_find_label(cfg, last->operands[0]) : -1;
+        for (int s = 0; s < 2; s++) {
+            if (block->successors[s] >= 0) cfg_add_predecessor(&cfg->blocks[block->successors[s]], b);
+        }
+    }
+}
+
+/**
+ * @brief Orders the reachable blocks in reverse postorder of a depth-first search.
+ */
+static void cfg_order_blocks(cfg_t *cfg) {
+    cfg->order = cfg_alloc(cfg->block_count, sizeof(int));
+    if (cfg->block_count == 0) return;
+
+    int *stack = cfg_alloc(cfg->block_count, sizeof(int));
+    int *next_edge = cfg_alloc(cfg->block_count, sizeof(int));
+    int depth = 0;
+    int postorder_count = 0;
+
+    stack[depth++] = 0;
+    cfg->blocks[0].reachable = true;
+    while (depth > 0) {
+        int b = stack[depth - 1];
+        if (next_edge[b] < 2) {
+            int successor = cfg->blocks[b].successors[next_edge[b]++];
+            if (successor >= 0 && !cfg->blocks[successor].reachable) {
+                cfg->blocks[successor].reachable = true;
+                stack[depth++] = successor;
+            }
+            continue;
+        }
+        depth--;
+        cfg->order[postorder_count++] = b;
+    }
+
+    for (int i = 0; i < postorder_count / 2; i++) {
+        int swap = cfg->order[i];
+        cfg->order[i] = cfg->order[postorder_count - 1 - i];
+        cfg->order[postorder_count - 1 - i] = swap;
+    }
+    cfg->order_count = postorder_count;
+    free(stack);
+    free(next_edge);
+}
+
+/**
+ * @brief Computes immediate dominators with the iterative algorithm of Cooper, Harvey and Kennedy.
+ */
+static void cfg_compute_dominators(cfg_t *cfg) {
+    if (cfg->order_count == 0) return;
+    int *position = cfg_alloc(cfg->block_count, sizeof(int));
+    for (int i = 0; i < cfg->order_count; i++) {
+        position[cfg->order[i]] = i;
+    }
+
+    int entry = cfg->order[0];
+    cfg->blocks[entry].idom = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < cfg->order_count; i++) {
+            cfg_block_t *block = &cfg->blocks[cfg->order[i]];
+            int idom = -1;
+            for (int p = 0; p < block->predecessor_count; p++) {
+                int predecessor = block->predecessors[p];
+                if (cfg->blocks[predecessor].idom < 0) continue;
+                if (idom < 0) {
+                    idom = predecessor;
+                    continue;
+                }
+                // Walk both blocks up the dominator tree until they meet
+                int a = predecessor;
+                int b = idom;
+                while (a != b) {
+                    while (position[a] > position[b]) a = cfg->blocks[a].idom;
+                    while (position[b] > position[a]) b = cfg->blocks[b].idom;
+                }
+                idom = a;
+            }
+            if (idom != block->idom) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    cfg->blocks[entry].idom = -1;
+    free(position);
+}
+
+/**
+ * @brief Finds natural loops and records for each block its innermost loop and nesting depth.
+ * @details Back edges to the same header form one loop. The body of a loop is the
+ *          header and every block that reaches a back edge without passing the header.
+ */
+static void cfg_find_loops(cfg_t *cfg) {
+    int *loop_size = cfg_alloc(cfg->block_count, sizeof(int));
+    bool *in_loop = cfg_alloc(cfg->block_count, sizeof(bool));
+    int *worklist = cfg_alloc(cfg->block_count, sizeof(int));
+
+    for (int header = 0; header < cfg->block_count; header++) {
+        cfg_block_t *header_block = &cfg->blocks[header];
+        int count = 0;
+        memset(in_loop, 0, cfg->block_count * sizeof(bool));
+        for (int p = 0; p < header_block->predecessor_count; p++) {
+            int latch = header_block->predecessors[p];
+            if (!cfg_is_back_edge(cfg, latch, header) || in_loop[latch]) continue;
+            in_loop[header] = true;
+            if (latch != header) {
+                in_loop[latch] = true;
+                worklist[count++] = latch;
+            }
+        }
+        if (!in_loop[header]) continue;
+
+        while (count > 0) {
+            cfg_block_t *block = &cfg->blocks[worklist[--count]];
+            for (int p = 0; p < block->predecessor_count; p++) {
+                int predecessor = block->predecessors[p];
+                if (!in_loop[predecessor] && cfg->blocks[predecessor].reachable) {
+                    in_loop[predecessor] = true;
+                    worklist[count++] = predecessor;
+                }
+            }
+        }
+
+        for (int b = 0; b < cfg->block_count; b++) {
+            if (in_loop[b]) loop_size[header]++;
+        }
+        for (int b = 0; b < cfg->block_count; b++) {
+            if (!in_loop[b]) continue;
+            cfg_block_t *block = &cfg->blocks[b];
+            block->loop_depth++;
+            if (block->loop_header < 0 || loop_size[header] < loop_size[block->loop_header]) {
+                block->loop_header = header;
+            }
+        }
+    }
+
+    free(loop_size);
+    free(in_loop);
+    free(worklist);
+}
+
+/**
+ * @brief Builds the control-flow graph of one function.
+ * @details Instructions marked as dead are skipped. Block 0 is the entry.
+ * @param code Instructions of the function.
+ * @return Newly allocated graph, free it with cfg_free.
+ */
+cfg_t *cfg_build(ir_list_t *code) {
+    cfg_t *cfg = cfg_alloc(1, sizeof(cfg_t));
+    cfg_build_blocks(cfg, code);
+    cfg_order_blocks(cfg);
+    cfg_compute_dominators(cfg);
+    cfg_find_loops(cfg);
+    return cfg;
+}
+
+/**
+ * @brief Frees a control-flow graph. The instructions are not affected.
+ * @param cfg Graph to free, may be NULL.
+ */
+void cfg_free(cfg_t *cfg) {
+    if (!cfg) return;
+    for (int b = 0; b < cfg->block_count; b++) {
+        free(cfg->blocks[b].predecessors);
+    }
+    free(cfg->blocks);
+    free(cfg->order);
+    free(cfg);
+}
+
+/**
+ * @brief Checks whether every path from the entry to a block passes another block.
+ * @param cfg Control-flow graph.
+ * @param dominator Candidate dominator.
+ * @param block Dominated block.
+ * @return True if dominator dominates block. Every reachable block dominates itself.
+ */
+bool cfg_dominates(const cfg_t *cfg, int dominator, int block) {
+    if (!cfg->blocks[block].reachable || !cfg->blocks[dominator].reachable) return false;
+    while (block >= 0) {
+        if (block == dominator) return true;
+        block = cfg->blocks[block].idom;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether an edge closes a loop, i.e. its target dominates its source.
+ * @param cfg Control-flow graph.
+ * @param from Source block of the edge.
+ * @param to Target block of the edge.
+ * @return True for a back edge.
+ */
+bool cfg_is_back_edge(const cfg_t *cfg, int from, int to) {
+    return cfg_dominates(cfg, to, from);
+}
+
+/**
+ * @brief Prints text escaped for a Graphviz string.
+ */
+static void cfg_dump_escaped(const char *text, FILE *out) {
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') fputc('\\', out);
+        fputc(*text, out);
+    }
+}
+
+/**
+ * @brief Writes the graph in Graphviz format.
+ * @details Loop headers are drawn bold, back edges red and jump edges dashed.
+ *          Unreachable blocks are grey.
+ * @param cfg Control-flow graph.
+ * @param name Name of the graph, usually the function name.
+ * @param out Output stream.
+ */
+void cfg_dump_dot(const cfg_t *cfg, const char *name, FILE *out) {
+    fputs("digraph \"", out);
+    cfg_dump_escaped(name, out);
+    fputs("\" {\n    node [shape=box, fontname=\"monospace\"];\n", out);
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        const cfg_block_t *block = &cfg->blocks[b];
+        bool header = block->loop_header == b;
+        fprintf(out, "    b%d [label=\"B%d", b, b);
+        if (block->idom >= 0) fprintf(out, " idom B%d", block->idom);
+        if (block->loop_depth > 0) fprintf(out, " loop depth %d", block->loop_depth);
+        fputs("\\l", out);
+        for (ir_instr_t *instr = block->first; instr; instr = instr->next) {
+            if (!instr->dead) {
+                fputs("  ", out);
+                cfg_dump_escaped(instr->opcode, out);
+                for (int i = 0; i < instr->operand_count; i++) {
+                    fputc(' ', out);
+                    cfg_dump_escaped(instr->operands[i], out);
+                }
+                fputs("\\l", out);
+            }
+            if (instr == block->last) break;
+        }
+        fputc('"', out);
+        if (header) fputs(", style=bold", out);
+        if (!block->reachable) fputs(", color=grey, fontcolor=grey", out);
+        fputs("];\n", out);
+    }
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        for (int s = 0; s < 2; s++) {
+            int successor = cfg->blocks[b].successors[s];
+            if (successor < 0) continue;
+            fprintf(out, "    b%d -> b%d", b, successor);
+            if (cfg_is_back_edge(cfg, b, successor)) {
+                fputs(s == 1 ? " [color=red, style=dashed]" : " [color=red]", out);
+            } else if (s == 1) {
+                fputs(" [style=dashed]", out);
+            }
+            fputs(";\n", out);
+        }
+    }
+    fputs("}\n", out);
+}
@@ -0,0 +1,41 @@
+/**
+ * IFJ24
+ * @brief Header for the control-flow graph of one function's generated code.
+ */
+
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ir.h"
+
+typedef struct {
+    ir_instr_t *first;          // First live instruction, a LABEL if the block is a jump target
+    ir_instr_t *last;           // Last live instruction, a jump if the block ends with one
+    int successors[2];          // Fallthrough and jump target, -1 if none
+    int *predecessors;
+    int predecessor_count, predecessor_capacity;
+    int idom;                   // Immediate dominator, -1 for the entry and unreachable blocks
+    int loop_header;            // Header of the innermost loop containing the block, -1 if none
+    int loop_depth;             // Number of loops containing the block
+    bool reachable;             // Reachable from the entry along the edges of the graph
+} cfg_block_t;
+
+typedef struct {
+    cfg_block_t *blocks;
+    int block_count, block_capacity;
+    int *order;                 // Reachable blocks in reverse postorder
+    int order_count;
+} cfg_t;
+
+bool cfg_is_jump(const ir_instr_t *instr);
+bool cfg_ends_block(const ir_instr_t *instr);
+cfg_t *cfg_build(ir_list_t *code);
+void cfg_free(cfg_t *cfg);
+int cfg_find_label(const cfg_t *cfg, const char *label);
+bool cfg_dominates(const cfg_t *cfg, int dominator, int block);
+bool cfg_is_back_edge(const cfg_t *cfg, int from, int to);
+void cfg_dump_dot(const cfg_t *cfg, const char *name, FILE *out);
+
+#endif
@@ -0,0 +1,204 @@
+/**
+ * IFJ24
+ * @brief Compile-time evaluation of calls to pure user functions.
+ * @details A function is pure if neither it nor any function it calls reads
+ *          input, writes output or exits. Calls of pure functions with constant
+ *          arguments are run on the virtual machine under a budget of jumps and
+ *          calls. Any run-time error, result the machine does not vouch for or
+ *          exhausted budget leaves the call to be evaluated at run time.
+ */
+
+#include "ctfe.h"
+#include "optimizer.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CTFE_STEP_BUDGET    250000      // Jumps and calls executed by one evaluated call
+#define CTFE_TOTAL_BUDGET   5000000     // Jumps and calls executed during the whole compilation
+
+typedef struct {
+    const char *label;
+    ir_list_t *code;
+    bool pure;
+} ctfe_function_t;
+
+typedef struct {
+    char *key;                  // Label and arguments separated by spaces
+    char *result;               // Literal, or NULL if the call could not be evaluated
+} ctfe_memo_t;
+
+static ir_list_t *ctfe_header = NULL;
+static ir_list_t **ctfe_lists = NULL;   // Code an evaluation loads
+static ctfe_function_t *ctfe_functions = NULL;
+static int ctfe_function_count = 0;
+static ctfe_memo_t *ctfe_memo = NULL;
+static int ctfe_memo_count = 0, ctfe_memo_capacity = 0;
+static long ctfe_total_steps = 0;
+
+/**
+ * @brief Grows a dynamic array, exiting on allocation failure.
+ */
+static void *ctfe_grow(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, *capacity * item_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Could not allocate memory for compile-time evaluation.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static void *ctfe_alloc(size_t size) {
+    void *memory = malloc(size ? size : 1);
+    if (!memory) {
+        fprintf(stderr, "Error: Could not allocate memory for compile-time evaluation.\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Interface                                                                 */
+/* ------------------------------------------------------------------------ */
+
+static ctfe_function_t *ctfe_find_function(const char *label) {
+    for (int i = 0; i < ctfe_function_count; i++) {
+        if (ctfe_functions[i].label && strcmp(ctfe_functions[i].label, label) == 0) return &ctfe_functions[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks whether a function may do something the evaluation cannot repeat.
+ * @details Calls of impure functions are resolved by the caller's fixed point.
+ */
+static bool ctfe_has_side_effects(const ctfe_function_t *function) {
+    static const char *const effects[] = { "READ", "WRITE", "EXIT", "DPRINT", "BREAK" };
+    for (const ir_instr_t *instr = function->code->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); i++) {
+            if (ir_is(instr, effects[i])) return true;
+        }
+        if (ir_is(instr, "CALL")) {
+            const builtin_info_t *builtin = builtin_lookup(instr->operands[0]);
+            const ctfe_function_t *callee = builtin ? NULL : ctfe_find_function(instr->operands[0]);
+            if (builtin ? !builtin->pure : !callee || !callee->pure) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Registers the functions of the program and finds the pure ones.
+ * @details Functions start out pure and lose it when they have side effects or
+ *          call an impure function, until nothing changes, so recursive pure
+ *          functions stay pure. Passing no functions releases the registry.
+ * @param header Header and built-in functions, or NULL.
+ * @param functions Instruction lists of all user functions, each starting with its LABEL.
+ * @param count Number of functions.
+ */
+void ctfe_set_program(ir_list_t *header, ir_list_t **functions, int count) {
+    free(ctfe_functions);
+    free(ctfe_lists);
+    ctfe_functions = NULL;
+    ctfe_lists = NULL;
+    ctfe_function_count = 0;
+    ctfe_header = header;
+    for (int i = 0; i < ctfe_memo_count; i++) {
+        free(ctfe_memo[i].key);
+        free(ctfe_memo[i].result);
+    }
+    free(ctfe_memo);
+    ctfe_memo = NULL;
+    ctfe_memo_count = ctfe_memo_capacity = 0;
+    if (count == 0) return;
+
+    ctfe_functions = ctfe_alloc(count * sizeof(ctfe_function_t));
+    ctfe_lists = ctfe_alloc((count + 1) * sizeof(ir_list_t *));
+    for (int i = 0; i < count; i++) {
+        const ir_instr_t *head = functions[i]->head;
+        ctfe_functions[i].label = head && ir_is(head, "LABEL") ? head->operands[0] : NULL;
+        ctfe_functions[i].code = functions[i];
+        ctfe_functions[i].pure = ctfe_functions[i].label != NULL;
+    }
+    ctfe_function_count = count;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < count; i++) {
+            if (ctfe_functions[i].pure && ctfe_has_side_effects(&ctfe_functions[i])) {
+                ctfe_functions[i].pure = false;
+                changed = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks whether calls of a user function may be evaluated at compile time.
+ * @param label Label of the function including the '$' prefix.
+ */
+bool ctfe_is_pure(const char *label) {
+    const ctfe_function_t *function = ctfe_find_function(label);
+    return function && function->pure;
+}
+
+/**
+ * @brief Evaluates a call of a pure user function on constant arguments.
+ * @details Results are remembered, so each call is evaluated once however often
+ *          the optimizer asks for it.
+ * @param caller Function containing the call, its code is not used by the evaluation.
+ * @param label Label of the called function including the '$' prefix.
+ * @param args Literal operands of the arguments in the order they are pushed.
+ * @param arg_count Number of arguments.
+ * @return Newly allocated literal the call returns, or NULL if it is not evaluated.
+ */
+char *ctfe_call(const ir_list_t *caller, const char *label, char **args, int arg_count) {
+    if (!ctfe_is_pure(label)) return NULL;
+
+    size_t key_length = strlen(label) + 1;
+    for (int i = 0; i < arg_count; i++) {
+        key_length += strlen(args[i]) + 1;
+    }
+    char *key = ctfe_alloc(key_length);
+    strcpy(key, label);
+    for (int i = 0; i < arg_count; i++) {
+        strcat(key, " ");
+        strcat(key, args[i]);
+    }
+    for (int i = 0; i < ctfe_memo_count; i++) {
+        if (strcmp(ctfe_memo[i].key, key) == 0) {
+            free(key);
+            return ctfe_memo[i].result ? strcpy(ctfe_alloc(strlen(ctfe_memo[i].result) + 1), ctfe_memo[i].result) : NULL;
+        }
+    }
+
+    // The caller may be in the middle of a rewrite, its code is left out
+    int list_count = 0;
+    if (ctfe_header) ctfe_lists[list_count++] = ctfe_header;
+    for (int i = 0; i < ctfe_function_count; i++) {
+        if (ctfe_functions[i].code != caller) ctfe_lists[list_count++] = ctfe_functions[i].code;
+    }
+    long budget = CTFE_TOTAL_BUDGET - ctfe_total_steps;
+    if (budget > CTFE_STEP_BUDGET) budget = CTFE_STEP_BUDGET;
+    long left = budget;
+    bool missing_function = false;
+    char *result = budget > 0 ? vm_evaluate(ctfe_lists, list_count, label, args, arg_count, &left, &missing_function) : NULL;
+    ctfe_total_steps += budget - left;
+
+    // Without the caller loaded the outcome may differ from another call site
+    if (missing_function) {
+        free(key);
+        return result;
+    }
+    if (ctfe_memo_count == ctfe_memo_capacity) {
+        ctfe_memo = ctfe_grow(ctfe_memo, &ctfe_memo_capacity, sizeof(ctfe_memo_t));
+    }
+    ctfe_memo[ctfe_memo_count].key = key;
+    ctfe_memo[ctfe_memo_count].result = result ? strcpy(ctfe_alloc(strlen(result) + 1), result) : NULL;
+    ctfe_memo_count++;
+    return result;
+}
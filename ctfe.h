@@ -0,0 +1,16 @@
+/**
+ * IFJ24
+ * @brief Header for compile-time evaluation of calls to pure user functions.
+ */
+
+#ifndef CTFE_H
+#define CTFE_H
+
+#include <stdbool.h>
+#include "ir.h"
+
+void ctfe_set_program(ir_list_t *header, ir_list_t **functions, int count);
+bool ctfe_is_pure(const char *label);
+char *ctfe_call(const ir_list_t *caller, const char *label, char **args, int arg_count);
+
+#endif
@@ -0,0 +1,1302 @@
+/**
+ * IFJ24
+ * @brief Translation of the generated IFJcode24 code to C99.
+ * @details Each function becomes a C function whose local frame variables
+ *          are C locals, so CREATEFRAME, PUSHFRAME and POPFRAME disappear
+ *          and CALL and RETURN become a direct call and return. Values are
+ *          tagged like in IFJcode24 and the operations keep its run-time
+ *          checks and exit codes. Runs of stack instructions are folded into
+ *          nested C expressions, and only values still on the stack at a
+ *          call, jump or label go through the runtime's data stack. Calls of
+ *          the built-in functions become calls of their C implementations in
+ *          the runtime, which is printed in front of the program.
+ */
+
+#include "emit_c.h"
+#include "optimizer.h"
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runtime printed in front of every translated program
+static const char *const c_runtime[] = {
+    "#include <ctype.h>",
+    "#include <limits.h>",
+    "#include <stdio.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "",
+    "enum { RT_UNDEFINED, RT_UNSET, RT_NIL, RT_INT, RT_FLOAT, RT_BOOL, RT_STRING };",
+    "",
+    "typedef struct {",
+    "    int refs;",
+    "    int ascii;",
+    "    size_t length;",
+    "    char bytes[];",
+    "} rt_string_t;",
+    "",
+    "typedef struct {",
+    "    int kind;",
+    "    union {",
+    "        long long i;",
+    "        double f;",
+    "        int b;",
+    "        rt_string_t *s;",
+    "    } as;",
+    "} rt_value_t;",
+    "",
+    "static rt_value_t *rt_stack;",
+    "static size_t rt_stack_count, rt_stack_capacity;",
+    "static char *rt_line;",
+    "static size_t rt_line_capacity;",
+    "",
+    "static inline void rt_error(int code, const char *message) {",
+    "    fflush(stdout);",
+    "    fprintf(stderr, \"Error: %s\\n\", message);",
+    "    exit(code);",
+    "}",
+    "",
+    "static inline void *rt_alloc(size_t size) {",
+    "    void *memory = malloc(size);",
+    "    if (memory == NULL) rt_error(99, \"Out of memory\");",
+    "    return memory;",
+    "}",
+    "",
+    "static inline rt_value_t rt_int(long long i) {",
+    "    rt_value_t value;",
+    "    value.kind = RT_INT;",
+    "    value.as.i = i;",
+    "    return value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_float(double f) {",
+    "    rt_value_t value;",
+    "    value.kind = RT_FLOAT;",
+    "    value.as.f = f;",
+    "    return value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_bool(int b) {",
+    "    rt_value_t value;",
+    "    value.kind = RT_BOOL;",
+    "    value.as.b = b != 0;",
+    "    return value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_nil(void) {",
+    "    rt_value_t value;",
+    "    value.kind = RT_NIL;",
+    "    value.as.i = 0;",
+    "    return value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_string(const char *bytes, size_t length) {",
+    "    rt_string_t *string = rt_alloc(sizeof(rt_string_t) + length + 1);",
+    "    string->refs = 1;",
+    "    string->ascii = 1;",
+    "    for (size_t i = 0; i < length; i++) {",
+    "        if ((unsigned char)bytes[i] >= 128) string->ascii = 0;",
+    "    }",
+    "    string->length = length;",
+    "    memcpy(string->bytes, bytes, length);",
+    "    string->bytes[length] = '\\0';",
+    "    rt_value_t value;",
+    "    value.kind = RT_STRING;",
+    "    value.as.s = string;",
+    "    return value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_copy(rt_value_t value) {",
+    "    if (value.kind == RT_STRING) value.as.s->refs++;",
+    "    return value;",
+    "}",
+    "",
+    "static inline void rt_release(rt_value_t *value) {",
+    "    if (value->kind == RT_STRING && --value->as.s->refs == 0) free(value->as.s);",
+    "    value->kind = RT_UNSET;",
+    "}",
+    "",
+    "static inline void rt_drop(rt_value_t value) {",
+    "    rt_release(&value);",
+    "}",
+    "",
+    "static inline rt_value_t rt_get(const rt_value_t *variable) {",
+    "    if (variable->kind == RT_UNDEFINED) rt_error(54, \"Access to an undefined variable\");",
+    "    if (variable->kind == RT_UNSET) rt_error(56, \"Read of a variable without a value\");",
+    "    return rt_copy(*variable);",
+    "}",
+    "",
+    "static inline void rt_defvar(rt_value_t *variable) {",
+    "    if (variable->kind != RT_UNDEFINED) rt_error(52, \"Redefinition of a variable\");",
+    "    variable->kind = RT_UNSET;",
+    "}",
+    "",
+    "static inline void rt_assign(rt_value_t *variable, rt_value_t value) {",
+    "    if (variable->kind == RT_UNDEFINED) rt_error(54, \"Access to an undefined variable\");",
+    "    rt_release(variable);",
+    "    *variable = value;",
+    "}",
+    "",
+    "static inline void rt_push(rt_value_t value) {",
+    "    if (rt_stack_count == rt_stack_capacity) {",
+    "        rt_stack_capacity = rt_stack_capacity ? 2 * rt_stack_capacity : 64;",
+    "        rt_stack = realloc(rt_stack, rt_stack_capacity * sizeof(rt_value_t));",
+    "        if (rt_stack == NULL) rt_error(99, \"Out of memory\");",
+    "    }",
+    "    rt_stack[rt_stack_count++] = value;",
+    "}",
+    "",
+    "static inline rt_value_t rt_pop(void) {",
+    "    if (rt_stack_count == 0) rt_error(56, \"Pop from an empty data stack\");",
+    "    return rt_stack[--rt_stack_count];",
+    "}",
+    "",
+    "static inline void rt_clears(void) {",
+    "    while (rt_stack_count > 0) rt_release(&rt_stack[--rt_stack_count]);",
+    "}",
+    "",
+    "static size_t rt_utf8_size(unsigned char lead) {",
+    "    if (lead >= 0xF0) return 4;",
+    "    if (lead >= 0xE0) return 3;",
+    "    if (lead >= 0xC0) return 2;",
+    "    return 1;",
+    "}",
+    "",
+    "static size_t rt_utf8_encode(long code, char *out) {",
+    "    if (code < 0x80) {",
+    "        out[0] = (char)code;",
+    "        return 1;",
+    "    }",
+    "    if (code < 0x800) {",
+    "        out[0] = (char)(0xC0 | (code >> 6));",
+    "        out[1] = (char)(0x80 | (code & 0x3F));",
+    "        return 2;",
+    "    }",
+    "    if (code < 0x10000) {",
+    "        out[0] = (char)(0xE0 | (code >> 12));",
+    "        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));",
+    "        out[2] = (char)(0x80 | (code & 0x3F));",
+    "        return 3;",
+    "    }",
+    "    out[0] = (char)(0xF0 | (code >> 18));",
+    "    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));",
+    "    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));",
+    "    out[3] = (char)(0x80 | (code & 0x3F));",
+    "    return 4;",
+    "}",
+    "",
+    "static inline long long rt_char_count(const rt_string_t *string) {",
+    "    if (string->ascii) return (long long)string->length;",
+    "    long long count = 0;",
+    "    for (size_t i = 0; i < string->length; i += rt_utf8_size((unsigned char)string->bytes[i])) count++;",
+    "    return count;",
+    "}",
+    "",
+    "static inline int rt_char_at(const rt_string_t *string, long long index, size_t *offset, size_t *size) {",
+    "    if (index < 0) return 0;",
+    "    if (string->ascii) {",
+    "        if (index >= (long long)string->length) return 0;",
+    "        *offset = (size_t)index;",
+    "        *size = 1;",
+    "        return 1;",
+    "    }",
+    "    size_t i = 0;",
+    "    for (; i < string->length && index > 0; index--) i += rt_utf8_size((unsigned char)string->bytes[i]);",
+    "    if (i >= string->length) return 0;",
+    "    *offset = i;",
+    "    *size = rt_utf8_size((unsigned char)string->bytes[i]);",
+    "    if (i + *size > string->length) *size = string->length - i;",
+    "    return 1;",
+    "}",
+    "",
+    "static inline int rt_compare_strings(const rt_string_t *a, const rt_string_t *b) {",
+    "    size_t common = a->length < b->length ? a->length : b->length;",
+    "    int order = memcmp(a->bytes, b->bytes, common);",
+    "    if (order != 0) return order;",
+    "    return (a->length > b->length) - (a->length < b->length);",
+    "}",
+    "",
+    "static inline rt_value_t rt_add(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return rt_int((long long)((unsigned long long)a.as.i + (unsigned long long)b.as.i));",
+    "    if (a.kind == RT_FLOAT && b.kind == RT_FLOAT) return rt_float(a.as.f + b.as.f);",
+    "    rt_error(53, \"Wrong operand types of ADD\");",
+    "    return a;",
+    "}",
+    "",
+    "static inline rt_value_t rt_sub(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return rt_int((long long)((unsigned long long)a.as.i - (unsigned long long)b.as.i));",
+    "    if (a.kind == RT_FLOAT && b.kind == RT_FLOAT) return rt_float(a.as.f - b.as.f);",
+    "    rt_error(53, \"Wrong operand types of SUB\");",
+    "    return a;",
+    "}",
+    "",
+    "static inline rt_value_t rt_mul(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return rt_int((long long)((unsigned long long)a.as.i * (unsigned long long)b.as.i));",
+    "    if (a.kind == RT_FLOAT && b.kind == RT_FLOAT) return rt_float(a.as.f * b.as.f);",
+    "    rt_error(53, \"Wrong operand types of MUL\");",
+    "    return a;",
+    "}",
+    "",
+    "static inline rt_value_t rt_div(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind != RT_FLOAT || b.kind != RT_FLOAT) rt_error(53, \"Wrong operand types of DIV\");",
+    "    if (b.as.f == 0.0) rt_error(57, \"Division by zero\");",
+    "    return rt_float(a.as.f / b.as.f);",
+    "}",
+    "",
+    "static inline rt_value_t rt_idiv(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind != RT_INT || b.kind != RT_INT) rt_error(53, \"Wrong operand types of IDIV\");",
+    "    if (b.as.i == 0) rt_error(57, \"Division by zero\");",
+    "    if (b.as.i == -1) return rt_int((long long)(0ULL - (unsigned long long)a.as.i));",
+    "    return rt_int(a.as.i / b.as.i);",
+    "}",
+    "",
+    "static inline int rt_order(rt_value_t a, rt_value_t b, const char *name) {",
+    "    int order;",
+    "    if (a.kind != b.kind || a.kind == RT_NIL) {",
+    "        fflush(stdout);",
+    "        fprintf(stderr, \"Error: Wrong operand types of %s\\n\", name);",
+    "        exit(53);",
+    "    }",
+    "    switch (a.kind) {",
+    "        case RT_INT: order = (a.as.i > b.as.i) - (a.as.i < b.as.i); break;",
+    "        case RT_FLOAT: order = (a.as.f > b.as.f) - (a.as.f < b.as.f); break;",
+    "        case RT_BOOL: order = a.as.b - b.as.b; break;",
+    "        default: order = rt_compare_strings(a.as.s, b.as.s); break;",
+    "    }",
+    "    rt_drop(a);",
+    "    rt_drop(b);",
+    "    return order;",
+    "}",
+    "",
+    "static inline rt_value_t rt_lt(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return rt_bool(a.as.i < b.as.i);",
+    "    return rt_bool(rt_order(a, b, \"LT\") < 0);",
+    "}",
+    "",
+    "static inline rt_value_t rt_gt(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return rt_bool(a.as.i > b.as.i);",
+    "    return rt_bool(rt_order(a, b, \"GT\") > 0);",
+    "}",
+    "",
+    "static inline int rt_test_eq(rt_value_t a, rt_value_t b) {",
+    "    int equal;",
+    "    if (a.kind == RT_INT && b.kind == RT_INT) return a.as.i == b.as.i;",
+    "    if (a.kind == RT_NIL || b.kind == RT_NIL) {",
+    "        equal = a.kind == b.kind;",
+    "    } else if (a.kind != b.kind) {",
+    "        rt_error(53, \"Wrong operand types of EQ\");",
+    "        return 0;",
+    "    } else {",
+    "        switch (a.kind) {",
+    "            case RT_FLOAT: equal = a.as.f == b.as.f; break;",
+    "            case RT_BOOL: equal = a.as.b == b.as.b; break;",
+    "            default: equal = rt_compare_strings(a.as.s, b.as.s) == 0; break;",
+    "        }",
+    "    }",
+    "    rt_drop(a);",
+    "    rt_drop(b);",
+    "    return equal;",
+    "}",
+    "",
+    "static inline rt_value_t rt_eq(rt_value_t a, rt_value_t b) {",
+    "    return rt_bool(rt_test_eq(a, b));",
+    "}",
+    "",
+    "static inline rt_value_t rt_and(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind != RT_BOOL || b.kind != RT_BOOL) rt_error(53, \"Wrong operand types of AND\");",
+    "    return rt_bool(a.as.b && b.as.b);",
+    "}",
+    "",
+    "static inline rt_value_t rt_or(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind != RT_BOOL || b.kind != RT_BOOL) rt_error(53, \"Wrong operand types of OR\");",
+    "    return rt_bool(a.as.b || b.as.b);",
+    "}",
+    "",
+    "static inline rt_value_t rt_not(rt_value_t a) {",
+    "    if (a.kind != RT_BOOL) rt_error(53, \"Wrong operand type of NOT\");",
+    "    return rt_bool(!a.as.b);",
+    "}",
+    "",
+    "static inline rt_value_t rt_int2float(rt_value_t a) {",
+    "    if (a.kind != RT_INT) rt_error(53, \"Wrong operand type of INT2FLOAT\");",
+    "    return rt_float((double)a.as.i);",
+    "}",
+    "",
+    "static inline rt_value_t rt_float2int(rt_value_t a) {",
+    "    if (a.kind != RT_FLOAT) rt_error(53, \"Wrong operand type of FLOAT2INT\");",
+    "    if (!(a.as.f > (double)LLONG_MIN - 1.0 && a.as.f < (double)LLONG_MAX)) rt_error(57, \"FLOAT2INT of a value out of range\");",
+    "    return rt_int((long long)a.as.f);",
+    "}",
+    "",
+    "static inline rt_value_t rt_int2char(rt_value_t a) {",
+    "    char bytes[4];",
+    "    if (a.kind != RT_INT) rt_error(53, \"Wrong operand type of INT2CHAR\");",
+    "    if (a.as.i < 0 || a.as.i > 0x10FFFF) rt_error(58, \"INT2CHAR of an invalid code\");",
+    "    return rt_string(bytes, rt_utf8_encode((long)a.as.i, bytes));",
+    "}",
+    "",
+    "static inline rt_value_t rt_stri2int(rt_value_t a, rt_value_t b) {",
+    "    size_t offset, size;",
+    "    if (a.kind != RT_STRING || b.kind != RT_INT) rt_error(53, \"Wrong operand types of STRI2INT\");",
+    "    if (!rt_char_at(a.as.s, b.as.i, &offset, &size)) rt_error(58, \"STRI2INT index out of range\");",
+    "    const unsigned char *text = (const unsigned char *)a.as.s->bytes + offset;",
+    "    long code = size == 1 ? text[0] : text[0] & (0xFF >> (size + 1));",
+    "    for (size_t i = 1; i < size; i++) code = (code << 6) | (text[i] & 0x3F);",
+    "    rt_drop(a);",
+    "    return rt_int(code);",
+    "}",
+    "",
+    "static inline rt_value_t rt_getchar(rt_value_t a, rt_value_t b) {",
+    "    size_t offset, size;",
+    "    if (a.kind != RT_STRING || b.kind != RT_INT) rt_error(53, \"Wrong operand types of GETCHAR\");",
+    "    if (!rt_char_at(a.as.s, b.as.i, &offset, &size)) rt_error(58, \"GETCHAR index out of range\");",
+    "    rt_value_t result = rt_string(a.as.s->bytes + offset, size);",
+    "    rt_drop(a);",
+    "    return result;",
+    "}",
+    "",
+    "static inline rt_value_t rt_concat(rt_value_t a, rt_value_t b) {",
+    "    if (a.kind != RT_STRING || b.kind != RT_STRING) rt_error(53, \"Wrong operand types of CONCAT\");",
+    "    rt_string_t *joined = rt_alloc(sizeof(rt_string_t) + a.as.s->length + b.as.s->length + 1);",
+    "    joined->refs = 1;",
+    "    joined->ascii = a.as.s->ascii && b.as.s->ascii;",
+    "    joined->length = a.as.s->length + b.as.s->length;",
+    "    memcpy(joined->bytes, a.as.s->bytes, a.as.s->length);",
+    "    memcpy(joined->bytes + a.as.s->length, b.as.s->bytes, b.as.s->length + 1);",
+    "    rt_drop(a);",
+    "    rt_drop(b);",
+    "    rt_value_t result;",
+    "    result.kind = RT_STRING;",
+    "    result.as.s = joined;",
+    "    return result;",
+    "}",
+    "",
+    "static inline rt_value_t rt_strlen(rt_value_t a) {",
+    "    if (a.kind != RT_STRING) rt_error(53, \"Wrong operand type of STRLEN\");",
+    "    long long length = rt_char_count(a.as.s);",
+    "    rt_drop(a);",
+    "    return rt_int(length);",
+    "}",
+    "",
+    "static inline void rt_setchar(rt_value_t *variable, rt_value_t index, rt_value_t with) {",
+    "    size_t offset, size, with_offset, with_size;",
+    "    rt_value_t target = rt_get(variable);",
+    "    if (target.kind != RT_STRING || index.kind != RT_INT || with.kind != RT_STRING) rt_error(53, \"Wrong operand types of SETCHAR\");",
+    "    if (!rt_char_at(target.as.s, index.as.i, &offset, &size) || !rt_char_at(with.as.s, 0, &with_offset, &with_size)) {",
+    "        rt_error(58, \"SETCHAR index out of range or empty string\");",
+    "    }",
+    "    size_t length = target.as.s->length - size + with_size;",
+    "    char *bytes = rt_alloc(length + 1);",
+    "    memcpy(bytes, target.as.s->bytes, offset);",
+    "    memcpy(bytes + offset, with.as.s->bytes, with_size);",
+    "    memcpy(bytes + offset + with_size, target.as.s->bytes + offset + size, target.as.s->length - offset - size);",
+    "    rt_assign(variable, rt_string(bytes, length));",
+    "    free(bytes);",
+    "    rt_drop(target);",
+    "    rt_drop(with);",
+    "}",
+    "",
+    "static inline rt_value_t rt_type_name(int kind) {",
+    "    static const char *const names[] = { \"\", \"\", \"nil\", \"int\", \"float\", \"bool\", \"string\" };",
+    "    return rt_string(names[kind], strlen(names[kind]));",
+    "}",
+    "",
+    "static inline rt_value_t rt_type(const rt_value_t *variable) {",
+    "    if (variable->kind == RT_UNDEFINED) rt_error(54, \"Access to an undefined variable\");",
+    "    return rt_type_name(variable->kind);",
+    "}",
+    "",
+    "static inline rt_value_t rt_read(int kind) {",
+    "    size_t length = 0;",
+    "    int c = getchar();",
+    "    if (c == EOF) return rt_nil();",
+    "    for (;;) {",
+    "        if (length + 1 >= rt_line_capacity) {",
+    "            rt_line_capacity = rt_line_capacity ? 2 * rt_line_capacity : 128;",
+    "            rt_line = realloc(rt_line, rt_line_capacity);",
+    "            if (rt_line == NULL) rt_error(99, \"Out of memory\");",
+    "        }",
+    "        if (c == EOF || c == '\\n') break;",
+    "        rt_line[length++] = (char)c;",
+    "        c = getchar();",
+    "    }",
+    "    rt_line[length] = '\\0';",
+    "    if (kind == RT_STRING) return rt_string(rt_line, length);",
+    "",
+    "    char *text = rt_line, *last = rt_line + length, *end;",
+    "    while (isspace((unsigned char)*text)) text++;",
+    "    while (last > text && isspace((unsigned char)last[-1])) *--last = '\\0';",
+    "    if (kind == RT_INT) {",
+    "        long long number = strtoll(text, &end, 10);",
+    "        return end != text && *end == '\\0' ? rt_int(number) : rt_nil();",
+    "    }",
+    "    if (kind == RT_FLOAT) {",
+    "        double number = strtod(text, &end);",
+    "        return end != text && *end == '\\0' ? rt_float(number) : rt_nil();",
+    "    }",
+    "    int truth = strlen(text) == 4;",
+    "    for (int i = 0; truth && i < 4; i++) truth = tolower((unsigned char)text[i]) == \"true\"[i];",
+    "    return rt_bool(truth);",
+    "}",
+    "",
+    "static inline void rt_print(rt_value_t value, FILE *out) {",
+    "    switch (value.kind) {",
+    "        case RT_INT: fprintf(out, \"%lld\", value.as.i); break;",
+    "        case RT_FLOAT: fprintf(out, \"%a\", value.as.f); break;",
+    "        case RT_BOOL: fputs(value.as.b ? \"true\" : \"false\", out); break;",
+    "        case RT_STRING: fwrite(value.as.s->bytes, 1, value.as.s->length, out); break;",
+    "        default: break;",
+    "    }",
+    "    rt_drop(value);",
+    "}",
+    "",
+    "static inline void rt_write(rt_value_t value) {",
+    "    rt_print(value, stdout);",
+    "}",
+    "",
+    "static inline void rt_dprint(rt_value_t value) {",
+    "    rt_print(value, stderr);",
+    "}",
+    "",
+    "static inline void rt_break(void) {",
+    "    fprintf(stderr, \"%zu values on the data stack\\n\", rt_stack_count);",
+    "}",
+    "",
+    "static inline void rt_exit(rt_value_t code) {",
+    "    if (code.kind != RT_INT) rt_error(53, \"Wrong operand type of EXIT\");",
+    "    if (code.as.i < 0 || code.as.i > 9) rt_error(57, \"EXIT code out of range\");",
+    "    fflush(stdout);",
+    "    exit((int)code.as.i);",
+    "}",
+    "",
+    "static inline rt_value_t rt_ifj_ord(rt_value_t s, rt_value_t i) {",
+    "    if (s.kind != RT_STRING) {",
+    "        rt_drop(s);",
+    "        rt_drop(i);",
+    "        return rt_int(0);",
+    "    }",
+    "    if (i.kind != RT_INT) rt_error(53, \"Wrong operand types of LT\");",
+    "    if (i.as.i < 0 || i.as.i >= rt_char_count(s.as.s)) {",
+    "        rt_drop(s);",
+    "        return rt_int(0);",
+    "    }",
+    "    return rt_stri2int(s, i);",
+    "}",
+    "",
+    "static inline rt_value_t rt_ifj_substring(rt_value_t s, rt_value_t i, rt_value_t j) {",
+    "    size_t first = 0, last = 0, size;",
+    "    if (s.kind != RT_STRING) rt_error(53, \"Wrong operand type of STRLEN\");",
+    "    if (i.kind != RT_INT || j.kind != RT_INT) rt_error(53, \"Wrong operand types of LT\");",
+    "    long long length = rt_char_count(s.as.s);",
+    "    if (i.as.i < 0 || j.as.i < 0 || i.as.i > j.as.i || i.as.i >= length || j.as.i > length) {",
+    "        rt_drop(s);",
+    "        return rt_nil();",
+    "    }",
+    "    rt_char_at(s.as.s, i.as.i, &first, &size);",
+    "    if (j.as.i == length) last = s.as.s->length;",
+    "    else rt_char_at(s.as.s, j.as.i, &last, &size);",
+    "    rt_value_t result = rt_string(s.as.s->bytes + first, last - first);",
+    "    rt_drop(s);",
+    "    return result;",
+    "}",
+    "",
+    "static inline rt_value_t rt_ifj_strcmp(rt_value_t a, rt_value_t b) {",
+    "    int order = rt_order(a, b, \"GT\");",
+    "    return rt_int((order > 0) - (order < 0));",
+    "}",
+    "",
+    "static inline rt_value_t rt_constant(rt_value_t *constant, const char *bytes, size_t length) {",
+    "    if (constant->kind == RT_UNDEFINED) *constant = rt_string(bytes, length);",
+    "    return rt_copy(*constant);",
+    "}",
+};
+
+// Entry points of the runtime for code that passes values by address, e.g. assembly
+static const char *const c_runtime_exports[] = {
+    "#define RT_EXPORT_BINARY(name) \\",
+    "    void rt_x86_##name(rt_value_t *variable, const rt_value_t *a, const rt_value_t *b) { \\",
+    "        rt_value_t x = rt_get(a); \\",
+    "        rt_assign(variable, rt_##name(x, rt_get(b))); \\",
+    "    }",
+    "#define RT_EXPORT_UNARY(name) \\",
+    "    void rt_x86_##name(rt_value_t *variable, const rt_value_t *a) { \\",
+    "        rt_assign(variable, rt_##name(rt_get(a))); \\",
+    "    }",
+    "",
+    "RT_EXPORT_BINARY(add)",
+    "RT_EXPORT_BINARY(sub)",
+    "RT_EXPORT_BINARY(mul)",
+    "RT_EXPORT_BINARY(div)",
+    "RT_EXPORT_BINARY(idiv)",
+    "RT_EXPORT_BINARY(lt)",
+    "RT_EXPORT_BINARY(gt)",
+    "RT_EXPORT_BINARY(eq)",
+    "RT_EXPORT_BINARY(and)",
+    "RT_EXPORT_BINARY(or)",
+    "RT_EXPORT_BINARY(stri2int)",
+    "RT_EXPORT_BINARY(concat)",
+    "RT_EXPORT_BINARY(getchar)",
+    "RT_EXPORT_UNARY(not)",
+    "RT_EXPORT_UNARY(int2float)",
+    "RT_EXPORT_UNARY(float2int)",
+    "RT_EXPORT_UNARY(int2char)",
+    "RT_EXPORT_UNARY(strlen)",
+    "",
+    "void rt_x86_string(rt_value_t *constant, const char *bytes, long length) {",
+    "    *constant = rt_string(bytes, (size_t)length);",
+    "}",
+    "",
+    "void rt_x86_defvar(rt_value_t *variable) {",
+    "    rt_defvar(variable);",
+    "}",
+    "",
+    "void rt_x86_move(rt_value_t *variable, const rt_value_t *value) {",
+    "    rt_assign(variable, rt_get(value));",
+    "}",
+    "",
+    "void rt_x86_release(rt_value_t *variable) {",
+    "    rt_release(variable);",
+    "}",
+    "",
+    "void rt_x86_push(const rt_value_t *value) {",
+    "    rt_push(rt_get(value));",
+    "}",
+    "",
+    "void rt_x86_pop(rt_value_t *variable) {",
+    "    rt_assign(variable, rt_pop());",
+    "}",
+    "",
+    "void rt_x86_clears(void) {",
+    "    rt_clears();",
+    "}",
+    "",
+    "long rt_x86_test_eq(const rt_value_t *a, const rt_value_t *b) {",
+    "    rt_value_t x = rt_get(a);",
+    "    return rt_test_eq(x, rt_get(b));",
+    "}",
+    "",
+    "void rt_x86_read(rt_value_t *variable, long kind) {",
+    "    rt_assign(variable, rt_read((int)kind));",
+    "}",
+    "",
+    "void rt_x86_write(const rt_value_t *value) {",
+    "    rt_write(rt_get(value));",
+    "}",
+    "",
+    "void rt_x86_dprint(const rt_value_t *value) {",
+    "    rt_dprint(rt_get(value));",
+    "}",
+    "",
+    "void rt_x86_break(void) {",
+    "    rt_break();",
+    "}",
+    "",
+    "void rt_x86_exit(const rt_value_t *value) {",
+    "    rt_exit(rt_get(value));",
+    "}",
+    "",
+    "void rt_x86_setchar(rt_value_t *variable, const rt_value_t *index, const rt_value_t *with) {",
+    "    rt_value_t i = rt_get(index);",
+    "    rt_setchar(variable, i, rt_get(with));",
+    "}",
+    "",
+    "void rt_x86_type(rt_value_t *variable, const rt_value_t *value) {",
+    "    rt_assign(variable, rt_type(value));",
+    "}",
+    "",
+    "void rt_x86_finish(void) {",
+    "    fflush(stdout);",
+    "}",
+    "",
+    "void rt_x86_ifj_readstr(rt_value_t *result) {",
+    "    rt_assign(result, rt_read(RT_STRING));",
+    "}",
+    "",
+    "void rt_x86_ifj_readi32(rt_value_t *result) {",
+    "    rt_assign(result, rt_read(RT_INT));",
+    "}",
+    "",
+    "void rt_x86_ifj_readf64(rt_value_t *result) {",
+    "    rt_assign(result, rt_read(RT_FLOAT));",
+    "}",
+    "",
+    "void rt_x86_ifj_write(const rt_value_t *a) {",
+    "    rt_write(rt_get(a));",
+    "}",
+    "",
+    "void rt_x86_ifj_i2f(rt_value_t *result, const rt_value_t *a) {",
+    "    rt_assign(result, rt_int2float(rt_get(a)));",
+    "}",
+    "",
+    "void rt_x86_ifj_f2i(rt_value_t *result, const rt_value_t *a) {",
+    "    rt_assign(result, rt_float2int(rt_get(a)));",
+    "}",
+    "",
+    "void rt_x86_ifj_string(rt_value_t *result, const rt_value_t *a) {",
+    "    rt_assign(result, rt_get(a));",
+    "}",
+    "",
+    "void rt_x86_ifj_concat(rt_value_t *result, const rt_value_t *a, const rt_value_t *b) {",
+    "    rt_value_t x = rt_get(a);",
+    "    rt_assign(result, rt_concat(x, rt_get(b)));",
+    "}",
+    "",
+    "void rt_x86_ifj_length(rt_value_t *result, const rt_value_t *a) {",
+    "    rt_assign(result, rt_strlen(rt_get(a)));",
+    "}",
+    "",
+    "void rt_x86_ifj_chr(rt_value_t *result, const rt_value_t *a) {",
+    "    rt_assign(result, rt_int2char(rt_get(a)));",
+    "}",
+    "",
+    "void rt_x86_ifj_ord(rt_value_t *result, const rt_value_t *a, const rt_value_t *b) {",
+    "    rt_value_t x = rt_get(a);",
+    "    rt_assign(result, rt_ifj_ord(x, rt_get(b)));",
+    "}",
+    "",
+    "void rt_x86_ifj_substring(rt_value_t *result, const rt_value_t *a, const rt_value_t *b, const rt_value_t *c) {",
+    "    rt_value_t x = rt_get(a), y = rt_get(b);",
+    "    rt_assign(result, rt_ifj_substring(x, y, rt_get(c)));",
+    "}",
+    "",
+    "void rt_x86_ifj_strcmp(rt_value_t *result, const rt_value_t *a, const rt_value_t *b) {",
+    "    rt_value_t x = rt_get(a);",
+    "    rt_assign(result, rt_ifj_strcmp(x, rt_get(b)));",
+    "}",
+};
+
+typedef struct {
+    const char *opcode;     // Three-address instruction, the stack variant has an 'S' suffix
+    const char *function;   // Runtime function computing the result
+    int arity;
+} c_operation_t;
+
+static const c_operation_t c_operations[] = {
+    { "ADD",       "rt_add",       2 },
+    { "SUB",       "rt_sub",       2 },
+    { "MUL",       "rt_mul",       2 },
+    { "DIV",       "rt_div",       2 },
+    { "IDIV",      "rt_idiv",      2 },
+    { "LT",        "rt_lt",        2 },
+    { "GT",        "rt_gt",        2 },
+    { "EQ",        "rt_eq",        2 },
+    { "AND",       "rt_and",       2 },
+    { "OR",        "rt_or",        2 },
+    { "STRI2INT",  "rt_stri2int",  2 },
+    { "CONCAT",    "rt_concat",    2 },
+    { "GETCHAR",   "rt_getchar",   2 },
+    { "NOT",       "rt_not",       1 },
+    { "INT2FLOAT", "rt_int2float", 1 },
+    { "FLOAT2INT", "rt_float2int", 1 },
+    { "INT2CHAR",  "rt_int2char",  1 },
+    { "STRLEN",    "rt_strlen",    1 },
+};
+
+typedef struct {
+    const char *label;      // Label of the built-in function
+    const char *function;   // Runtime function returning the result, NULL for ifj.write
+} c_builtin_t;
+
+static const c_builtin_t c_builtins[] = {
+    { "$ifj_readstr",   "rt_read(RT_STRING" },
+    { "$ifj_readi32",   "rt_read(RT_INT" },
+    { "$ifj_readf64",   "rt_read(RT_FLOAT" },
+    { "$ifj_write",     NULL },
+    { "$ifj_i2f",       "rt_int2float(" },
+    { "$ifj_f2i",       "rt_float2int(" },
+    { "$ifj_string",    "(" },
+    { "$ifj_concat",    "rt_concat(" },
+    { "$ifj_length",    "rt_strlen(" },
+    { "$ifj_chr",       "rt_int2char(" },
+    { "$ifj_ord",       "rt_ifj_ord(" },
+    { "$ifj_substring", "rt_ifj_substring(" },
+    { "$ifj_strcmp",    "rt_ifj_strcmp(" },
+};
+
+typedef struct {
+    char *text;             // C expression of an owned value
+    bool pops;              // Pops from the runtime data stack
+} c_expr_t;
+
+typedef struct {
+    const char **names;
+    int count, capacity;
+} c_names_t;
+
+static FILE *c_out;
+static c_expr_t *c_stack = NULL;    // Values pushed but not yet materialized
+static int c_stack_count = 0, c_stack_capacity = 0;
+static int c_temp_counter = 0;
+static c_names_t c_globals, c_constants, c_functions, c_locals, c_labels;
+
+/**
+ * @brief Allocates a string formatted like printf, exits on failure.
+ */
+static char *c_format(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char *text = malloc(length + 1);
+    if (text == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    return text;
+}
+
+/**
+ * @brief Returns the index of a name, adding it if missing.
+ */
+static int c_name_index(c_names_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i], name) == 0) return i;
+    }
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? 2 * table->capacity : 16;
+        const char **grown = realloc(table->names, table->capacity * sizeof(const char *));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+            exit(EXIT_FAILURE);
+        }
+        table->names = grown;
+    }
+    table->names[table->count] = name;
+    return table->count++;
+}
+
+static bool c_name_contains(const c_names_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Turns a name of IFJcode24 into a C identifier suffix.
+ * @details Letters and digits stay, '_' is doubled and other characters
+ *          become '_' followed by two hexadecimal digits, so distinct
+ *          names stay distinct.
+ */
+static char *c_mangle(const char *prefix, const char *name) {
+    char *text = malloc(strlen(prefix) + 3 * strlen(name) + 1);
+    if (text == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *end = text + sprintf(text, "%s", prefix);
+    for (const char *c = name; *c; c++) {
+        if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9')) {
+            *end++ = *c;
+        } else if (*c == '_') {
+            end += sprintf(end, "__");
+        } else {
+            end += sprintf(end, "_%02x", (unsigned char)*c);
+        }
+    }
+    *end = '\0';
+    return text;
+}
+
+static const c_builtin_t *c_builtin(const char *label) {
+    for (size_t i = 0; i < sizeof(c_builtins) / sizeof(c_builtins[0]); i++) {
+        if (strcmp(c_builtins[i].label, label) == 0) return &c_builtins[i];
+    }
+    return NULL;
+}
+
+static const c_operation_t *c_operation(const char *opcode, bool stack) {
+    size_t length = strlen(opcode) - (stack ? 1 : 0);
+    if (stack && opcode[length] != 'S') return NULL;
+    for (size_t i = 0; i < sizeof(c_operations) / sizeof(c_operations[0]); i++) {
+        if (strlen(c_operations[i].opcode) == length && strncmp(c_operations[i].opcode, opcode, length) == 0) {
+            return &c_operations[i];
+        }
+    }
+    return NULL;
+}
+
+static bool c_is_variable(const char *operand) {
+    return strncmp(operand, "GF@", 3) == 0 || strncmp(operand, "LF@", 3) == 0 || strncmp(operand, "TF@", 3) == 0;
+}
+
+/**
+ * @brief Returns the C address of a variable operand.
+ */
+static char *c_variable(const char *operand) {
+    if (strncmp(operand, "GF@", 3) == 0) return c_mangle("&g_", operand + 3);
+    if (strncmp(operand, "LF@", 3) == 0) return c_mangle("&v_", operand + 3);
+    fprintf(stderr, "Error: The C backend does not support the operand %s.\n", operand);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Decodes the escape sequences of a string literal into a C string literal.
+ * @details An escape sequence stands for a code point and becomes its UTF-8
+ *          encoding, like in the interpreter; other bytes are copied.
+ * @param length Set to the number of bytes of the decoded string.
+ */
+static char *c_string_literal(const char *text, size_t *length) {
+    char *literal = malloc(4 * strlen(text) + 3);
+    if (literal == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *end = literal;
+    *end++ = '"';
+    *length = 0;
+    while (*text) {
+        unsigned char bytes[2];
+        int size = 1;
+        if (text[0] == '\\' && text[1] && text[2] && text[3]) {
+            int code = (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+            if (code < 0x80) {
+                bytes[0] = (unsigned char)code;
+            } else {
+                bytes[0] = (unsigned char)(0xC0 | (code >> 6));
+                bytes[1] = (unsigned char)(0x80 | (code & 0x3F));
+                size = 2;
+            }
+            text += 4;
+        } else {
+            bytes[0] = (unsigned char)*text++;
+        }
+        for (int i = 0; i < size; i++) {
+            if (bytes[i] == '"' || bytes[i] == '\\' || bytes[i] == '?') {
+                end += sprintf(end, "\\%c", bytes[i]);
+            } else if (bytes[i] < 32 || bytes[i] >= 127) {
+                end += sprintf(end, "\\%03o", bytes[i]);
+            } else {
+                *end++ = (char)bytes[i];
+            }
+        }
+        *length += size;
+    }
+    *end++ = '"';
+    *end = '\0';
+    return literal;
+}
+
+/**
+ * @brief Returns the C expression of an owned copy of a symbol operand.
+ */
+static char *c_operand(const char *operand) {
+    if (c_is_variable(operand)) {
+        char *variable = c_variable(operand);
+        char *text = c_format("rt_get(%s)", variable);
+        free(variable);
+        return text;
+    }
+    if (strncmp(operand, "int@", 4) == 0) {
+        long long value = strtoll(operand + 4, NULL, 10);
+        if (value == LLONG_MIN) return c_format("rt_int(-%lldLL - 1)", LLONG_MAX);
+        return c_format("rt_int(%lldLL)", value);
+    }
+    if (strncmp(operand, "float@", 6) == 0) return c_format("rt_float(%s)", operand + 6);
+    if (strncmp(operand, "bool@", 5) == 0) return c_format("rt_bool(%d)", strcmp(operand + 5, "true") == 0);
+    if (strcmp(operand, "nil@nil") == 0) return c_format("rt_nil()");
+    if (strncmp(operand, "string@", 7) == 0) {
+        size_t length;
+        char *literal = c_string_literal(operand + 7, &length);
+        char *text = c_format("rt_constant(&k_%d, %s, %zu)", c_name_index(&c_constants, operand), literal, length);
+        free(literal);
+        return text;
+    }
+    fprintf(stderr, "Error: The C backend does not support the operand %s.\n", operand);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Prints a statement of the translated function, taking over the text.
+ */
+static void c_statement(char *text) {
+    fprintf(c_out, "    %s\n", text);
+    free(text);
+}
+
+static void c_push(char *text, bool pops) {
+    if (c_stack_count == c_stack_capacity) {
+        c_stack_capacity = c_stack_capacity ? 2 * c_stack_capacity : 16;
+        c_expr_t *grown = realloc(c_stack, c_stack_capacity * sizeof(c_expr_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+            exit(EXIT_FAILURE);
+        }
+        c_stack = grown;
+    }
+    c_stack[c_stack_count].text = text;
+    c_stack[c_stack_count++].pops = pops;
+}
+
+/**
+ * @brief Pops values of the data stack, the last one from the top.
+ * @details Values missing on the folded stack are popped from the runtime's
+ *          data stack. At most one of the expressions pops, the others are
+ *          stored in temporaries first, since C leaves the order of
+ *          evaluating arguments open.
+ */
+static void c_pop(c_expr_t *values, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        if (c_stack_count > 0) {
+            values[i] = c_stack[--c_stack_count];
+        } else {
+            values[i].text = c_format("rt_pop()");
+            values[i].pops = true;
+        }
+    }
+    for (int i = count - 1; i > 0; i--) {
+        bool deeper_pops = false;
+        for (int j = 0; j < i; j++) {
+            deeper_pops = deeper_pops || values[j].pops;
+        }
+        if (values[i].pops && deeper_pops) {
+            int temp = c_temp_counter++;
+            c_statement(c_format("rt_value_t t_%d = %s;", temp, values[i].text));
+            free(values[i].text);
+            values[i].text = c_format("t_%d", temp);
+            values[i].pops = false;
+        }
+    }
+}
+
+/**
+ * @brief Pushes the values left on the folded stack to the runtime's data stack.
+ */
+static void c_flush() {
+    for (int i = 0; i < c_stack_count; i++) {
+        c_statement(c_format("rt_push(%s);", c_stack[i].text));
+    }
+    c_stack_count = 0;
+}
+
+/**
+ * @brief Prints the release of all local variables and the return.
+ */
+static void c_leave() {
+    for (int i = 0; i < c_locals.count; i++) {
+        char *local = c_mangle("&v_", c_locals.names[i]);
+        c_statement(c_format("rt_release(%s);", local));
+        free(local);
+    }
+    c_statement(c_format("return;"));
+}
+
+/**
+ * @brief Prints a call of a built-in function with its arguments taken from the stack.
+ */
+static void c_builtin_call(const c_builtin_t *builtin) {
+    const builtin_info_t *info = builtin_lookup(builtin->label);
+    int arity = info ? info->arity : 0;
+    c_expr_t args[IR_MAX_OPERANDS];
+    c_pop(args, arity);
+    c_flush();
+    char *joined = c_format("%s", "");
+    for (int i = 0; i < arity; i++) {
+        char *grown = c_format("%s%s%s", joined, i > 0 ? ", " : "", args[i].text);
+        free(joined);
+        free(args[i].text);
+        joined = grown;
+    }
+    if (builtin->function == NULL) {
+        c_statement(c_format("rt_write(%s);", joined));
+    } else {
+        bool reads = strncmp(builtin->function, "rt_read(", 8) == 0;
+        c_statement(c_format("rt_assign(&g_return, %s%s%s);", builtin->function, reads ? "" : joined, ")"));
+    }
+    free(joined);
+}
+
+/**
+ * @brief Translates one instruction of a function.
+ */
+static void c_instruction(const ir_instr_t *instr) {
+    const char *const *op = (const char *const *)instr->operands;
+    const c_operation_t *operation;
+    c_expr_t values[IR_MAX_OPERANDS];
+
+    if (ir_is(instr, "PUSHS")) {
+        c_push(c_operand(op[0]), false);
+        return;
+    }
+    if ((operation = c_operation(instr->opcode, true)) != NULL) {
+        c_pop(values, operation->arity);
+        bool pops = values[0].pops || (operation->arity == 2 && values[1].pops);
+        char *text = operation->arity == 2
+            ? c_format("%s(%s, %s)", operation->function, values[0].text, values[1].text)
+            : c_format("%s(%s)", operation->function, values[0].text);
+        for (int i = 0; i < operation->arity; i++) {
+            free(values[i].text);
+        }
+        c_push(text, pops);
+        return;
+    }
+    if (ir_is(instr, "POPS") || ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+        bool pops = ir_is(instr, "POPS");
+        c_pop(values, pops ? 1 : 2);
+        c_flush();
+        char *target = pops ? c_variable(op[0]) : c_mangle("L_", op[0]);
+        if (pops) {
+            c_statement(c_format("rt_assign(%s, %s);", target, values[0].text));
+        } else {
+            c_statement(c_format("if (%srt_test_eq(%s, %s)) goto %s;", ir_is(instr, "JUMPIFEQS") ? "" : "!",
+                                 values[0].text, values[1].text, target));
+            free(values[1].text);
+        }
+        free(values[0].text);
+        free(target);
+        return;
+    }
+    c_flush();
+
+    char *a = NULL, *b = NULL, *c = NULL;
+    if ((operation = c_operation(instr->opcode, false)) != NULL) {
+        a = c_variable(op[0]);
+        b = c_operand(op[1]);
+        if (operation->arity == 2) {
+            c = c_operand(op[2]);
+            c_statement(c_format("rt_assign(%s, %s(%s, %s));", a, operation->function, b, c));
+        } else {
+            c_statement(c_format("rt_assign(%s, %s(%s));", a, operation->function, b));
+        }
+    } else if (ir_is(instr, "MOVE")) {
+        a = c_variable(op[0]);
+        b = c_operand(op[1]);
+        c_statement(c_format("rt_assign(%s, %s);", a, b));
+    } else if (ir_is(instr, "DEFVAR")) {
+        a = c_variable(op[0]);
+        c_statement(c_format("rt_defvar(%s);", a));
+    } else if (ir_is(instr, "CREATEFRAME") || ir_is(instr, "PUSHFRAME") || ir_is(instr, "POPFRAME")) {
+        // The frame of a function is the scope of its C function
+    } else if (ir_is(instr, "CALL")) {
+        const c_builtin_t *builtin = c_builtin(op[0]);
+        if (builtin) {
+            c_builtin_call(builtin);
+        } else if (c_name_contains(&c_functions, op[0])) {
+            a = c_mangle("f_", op[0] + 1);
+            c_statement(c_format("%s();", a));
+        } else {
+            fprintf(stderr, "Error: The C backend cannot call %s, it does not start a function.\n", op[0]);
+            exit(EXIT_FAILURE);
+        }
+    } else if (ir_is(instr, "RETURN")) {
+        c_leave();
+    } else if (ir_is(instr, "CLEARS")) {
+        c_statement(c_format("rt_clears();"));
+    } else if (ir_is(instr, "READ")) {
+        a = c_variable(op[0]);
+        const char *kind = strcmp(op[1], "int") == 0 ? "RT_INT" : strcmp(op[1], "float") == 0 ? "RT_FLOAT" :
+                           strcmp(op[1], "bool") == 0 ? "RT_BOOL" : "RT_STRING";
+        c_statement(c_format("rt_assign(%s, rt_read(%s));", a, kind));
+    } else if (ir_is(instr, "WRITE") || ir_is(instr, "DPRINT") || ir_is(instr, "EXIT")) {
+        a = c_operand(op[0]);
+        c_statement(c_format("rt_%s(%s);", ir_is(instr, "WRITE") ? "write" : ir_is(instr, "EXIT") ? "exit" : "dprint", a));
+    } else if (ir_is(instr, "BREAK")) {
+        c_statement(c_format("rt_break();"));
+    } else if (ir_is(instr, "SETCHAR")) {
+        a = c_variable(op[0]);
+        b = c_operand(op[1]);
+        c = c_operand(op[2]);
+        c_statement(c_format("rt_setchar(%s, %s, %s);", a, b, c));
+    } else if (ir_is(instr, "TYPE")) {
+        a = c_variable(op[0]);
+        if (c_is_variable(op[1])) {
+            b = c_variable(op[1]);
+            c_statement(c_format("rt_assign(%s, rt_type(%s));", a, b));
+        } else {
+            b = c_operand(op[1]);
+            c_statement(c_format("rt_assign(%s, rt_type_name((%s).kind));", a, b));
+        }
+    } else if (ir_is(instr, "LABEL")) {
+        if (c_name_contains(&c_labels, op[0])) {
+            a = c_mangle("L_", op[0]);
+            fprintf(c_out, "%s:;\n", a);
+        }
+    } else if (ir_is(instr, "JUMP")) {
+        a = c_mangle("L_", op[0]);
+        c_statement(c_format("goto %s;", a));
+    } else if (ir_is(instr, "JUMPIFEQ") || ir_is(instr, "JUMPIFNEQ")) {
+        a = c_mangle("L_", op[0]);
+        b = c_operand(op[1]);
+        c = c_operand(op[2]);
+        c_statement(c_format("if (%srt_test_eq(%s, %s)) goto %s;", ir_is(instr, "JUMPIFEQ") ? "" : "!", b, c, a));
+    } else {
+        fprintf(stderr, "Error: The C backend does not support the instruction %s.\n", instr->opcode);
+        exit(EXIT_FAILURE);
+    }
+    free(a);
+    free(b);
+    free(c);
+}
+
+static bool c_is_jump(const ir_instr_t *instr) {
+    return ir_is(instr, "JUMP") || ir_is(instr, "JUMPIFEQ") || ir_is(instr, "JUMPIFNEQ") ||
+           ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS");
+}
+
+/**
+ * @brief Translates the instructions from first up to last, exclusive.
+ * @details Collects the local variables and the jump targets first, jumps
+ *          must stay inside the translated range.
+ */
+static void c_body(const ir_instr_t *first, const ir_instr_t *last) {
+    c_locals.count = 0;
+    c_labels.count = 0;
+    c_names_t defined = { NULL, 0, 0 };
+    for (const ir_instr_t *instr = first; instr != last; instr = instr->next) {
+        if (ir_is(instr, "LABEL")) c_name_index(&defined, instr->operands[0]);
+        if (c_is_jump(instr)) c_name_index(&c_labels, instr->operands[0]);
+        for (int i = 0; i < instr->operand_count; i++) {
+            if (strncmp(instr->operands[i], "LF@", 3) == 0) c_name_index(&c_locals, instr->operands[i] + 3);
+        }
+    }
+    for (int i = 0; i < c_labels.count; i++) {
+        if (!c_name_contains(&defined, c_labels.names[i])) {
+            fprintf(stderr, "Error: The C backend cannot jump to %s outside of the function.\n", c_labels.names[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(defined.names);
+
+    for (int i = 0; i < c_locals.count; i++) {
+        char *local = c_mangle("v_", c_locals.names[i]);
+        c_statement(c_format("rt_value_t %s = { RT_UNDEFINED, { 0 } };", local));
+        free(local);
+    }
+    for (const ir_instr_t *instr = first; instr != last; instr = instr->next) {
+        if (instr->opcode[0] != '.') c_instruction(instr);
+    }
+    c_flush();
+}
+
+/**
+ * @brief Translates the program to C99.
+ * @details The header up to its jump to main becomes the start of the C main
+ *          function, its built-in functions are replaced by the runtime.
+ * @param header Header and built-in functions.
+ * @param functions Code of all user functions, each starting with its label.
+ * @param count Number of functions.
+ * @param out Stream receiving the C source.
+ */
+void emit_c(ir_list_t *header, ir_list_t **functions, int count, FILE *out) {
+    c_out = out;
+    c_temp_counter = 0;
+    const ir_instr_t *entry = header ? header->head : NULL;
+    while (entry && !(ir_is(entry, "JUMP") && strcmp(entry->operands[0], "$main") == 0)) {
+        entry = entry->next;
+    }
+
+    // Functions reachable from main, the others are left out
+    bool *reachable = calloc(count > 0 ? count : 1, sizeof(bool));
+    if (reachable == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for the C backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    c_name_index(&c_functions, "$main");
+    for (int done = 0; done < c_functions.count; done++) {
+        for (int f = 0; f < count; f++) {
+            ir_list_t *code = functions[f];
+            if (code == NULL || reachable[f] || !ir_is(code->head, "LABEL") ||
+                strcmp(code->head->operands[0], c_functions.names[done]) != 0) {
+                continue;
+            }
+            reachable[f] = true;
+            for (const ir_instr_t *instr = code->head; instr; instr = instr->next) {
+                if (ir_is(instr, "CALL") && !c_builtin(instr->operands[0])) c_name_index(&c_functions, instr->operands[0]);
+            }
+        }
+    }
+
+    // Names declared before the functions
+    for (int f = -1; f < count; f++) {
+        if (f >= 0 && !reachable[f]) continue;
+        const ir_instr_t *end = f < 0 ? entry : NULL;
+        for (const ir_instr_t *instr = f < 0 ? (header ? header->head : NULL) : functions[f]->head; instr != end; instr = instr->next) {
+            for (int i = 0; i < instr->operand_count; i++) {
+                if (strncmp(instr->operands[i], "GF@", 3) == 0) c_name_index(&c_globals, instr->operands[i] + 3);
+                if (strncmp(instr->operands[i], "string@", 7) == 0) c_name_index(&c_constants, instr->operands[i]);
+            }
+        }
+    }
+    c_name_index(&c_globals, "return");
+    for (int i = 0; i < c_functions.count; i++) {
+        bool defined = false;
+        for (int f = 0; f < count; f++) {
+            defined = defined || (reachable[f] && strcmp(functions[f]->head->operands[0], c_functions.names[i]) == 0);
+        }
+        if (!defined) {
+            fprintf(stderr, "Error: The C backend cannot call %s, it does not start a function.\n", c_functions.names[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(out, "/* Generated by ifj24 */\n\n");
+    for (size_t i = 0; i < sizeof(c_runtime) / sizeof(c_runtime[0]); i++) {
+        fprintf(out, "%s\n", c_runtime[i]);
+    }
+    fprintf(out, "\n");
+    for (int i = 0; i < c_globals.count; i++) {
+        char *global = c_mangle("g_", c_globals.names[i]);
+        fprintf(out, "static rt_value_t %s;\n", global);
+        free(global);
+    }
+    for (int i = 0; i < c_constants.count; i++) {
+        fprintf(out, "static rt_value_t k_%d;\n", i);
+    }
+    for (int i = 0; i < c_functions.count; i++) {
+        char *function = c_mangle("f_", c_functions.names[i] + 1);
+        fprintf(out, "static void %s(void);\n", function);
+        free(function);
+    }
+
+    for (int f = 0; f < count; f++) {
+        ir_list_t *code = functions[f];
+        if (!reachable[f]) {
+            continue;
+        }
+        char *function = c_mangle("f_", code->head->operands[0] + 1);
+        fprintf(out, "\nstatic void %s(void) {\n", function);
+        free(function);
+        c_body(code->head->next, NULL);
+        fprintf(out, "}\n");
+    }
+
+    fprintf(out, "\nint main(void) {\n");
+    if (header) {
+        c_body(header->head, entry);
+    }
+    fprintf(out, "    f_main();\n");
+    fprintf(out, "    fflush(stdout);\n");
+    fprintf(out, "    return 0;\n");
+    fprintf(out, "}\n");
+
+    free(reachable);
+    free(c_stack);
+    c_stack = NULL;
+    c_stack_count = c_stack_capacity = 0;
+    c_names_t *tables[] = { &c_globals, &c_constants, &c_functions, &c_locals, &c_labels };
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        free(tables[i]->names);
+        tables[i]->names = NULL;
+        tables[i]->count = tables[i]->capacity = 0;
+    }
+}
+
+/**
+ * @brief Prints the runtime as a C source file to link with assembly of the program.
+ * @details The exported functions take and return values by address.
+ * @param out Stream receiving the C source.
+ */
+void emit_c_runtime(FILE *out) {
+    fprintf(out, "/* Runtime of programs generated by ifj24 */\n\n");
+    for (size_t i = 0; i < sizeof(c_runtime) / sizeof(c_runtime[0]); i++) {
+        fprintf(out, "%s\n", c_runtime[i]);
+    }
+    fprintf(out, "\n");
+    for (size_t i = 0; i < sizeof(c_runtime_exports) / sizeof(c_runtime_exports[0]); i++) {
+        fprintf(out, "%s\n", c_runtime_exports[i]);
+    }
+}
@@ -0,0 +1,15 @@
+/**
+ * IFJ24
+ * @brief Header for the translation of the generated IFJcode24 code to C99.
+ */
+
+#ifndef EMIT_C_H
+#define EMIT_C_H
+
+#include <stdio.h>
+#include "ir.h"
+
+void emit_c(ir_list_t *header, ir_list_t **functions, int count, FILE *out);
+void emit_c_runtime(FILE *out);
+
+#endif
@@ -0,0 +1,846 @@
+/**
+ * IFJ24
+ * @brief Translation of the generated IFJcode24 code to x86-64 assembly.
+ * @details Prints GNU assembler text for Linux and the System V ABI, linked
+ *          with the runtime printed by emit_c_runtime(). Each function gets
+ *          a stack frame with a 16-byte slot per local variable, plus slots
+ *          for values of the folded data stack. Values are tagged like in
+ *          IFJcode24, except local variables whose DEFVARs carry a static
+ *          type: their tag is written once by the prologue and never checked
+ *          or stored again. Arithmetic, comparisons, conditional jumps and
+ *          moves check unknown tags inline and compute on integers and floats
+ *          in registers; strings, nil, run-time errors and the other
+ *          instructions go through calls of the runtime.
+ */
+
+#include "emit_x86.h"
+#include "optimizer.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Type tags of the runtime
+#define X86_UNDEFINED   0
+#define X86_UNSET       1
+#define X86_NIL         2
+#define X86_INT         3
+#define X86_FLOAT       4
+#define X86_BOOL        5
+#define X86_STRING      6
+
+#define X86_SLOT_SIZE   16  // Tag, padding and payload of a value
+#define X86_POP_SLOTS   IR_MAX_OPERANDS
+
+typedef struct {
+    char kind[96];          // Address of the type tag
+    char payload[96];       // Address of the payload
+    int known;              // Tag known at compile time, X86_UNDEFINED if checked at run time
+    bool typed;             // Local variable whose tag is set only by the prologue
+} x86_operand_t;
+
+typedef struct {
+    const char **names;
+    int count, capacity;
+} x86_names_t;
+
+static FILE *x86_out;
+static x86_operand_t *x86_stack = NULL;     // Values pushed but not yet materialized
+static int x86_stack_count = 0, x86_stack_capacity = 0;
+static int x86_label_counter = 0;
+static int x86_temp_count = 0;              // Slots used for the folded data stack
+static int x86_pop_count = 0;               // Slots used for values popped by the current instruction
+static char x86_return[80];                 // Label of the epilogue of the current function
+static x86_names_t x86_constants, x86_functions, x86_locals, x86_labels;
+static int *x86_local_kinds = NULL;         // Static tag of each local variable, X86_UNDEFINED if none
+
+static void x86_line(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(x86_out, "    ");
+    vfprintf(x86_out, format, args);
+    fprintf(x86_out, "\n");
+    va_end(args);
+}
+
+/**
+ * @brief Returns the index of a name, adding it if missing.
+ */
+static int x86_name_index(x86_names_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i], name) == 0) return i;
+    }
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? 2 * table->capacity : 16;
+        const char **grown = realloc(table->names, table->capacity * sizeof(const char *));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for the x86-64 backend.\n");
+            exit(EXIT_FAILURE);
+        }
+        table->names = grown;
+    }
+    table->names[table->count] = name;
+    return table->count++;
+}
+
+static bool x86_name_contains(const x86_names_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Turns a name of IFJcode24 into an assembler symbol.
+ * @details Letters and digits stay, '_' is doubled and other characters
+ *          become '_' followed by two hexadecimal digits.
+ */
+static void x86_mangle(const char *prefix, const char *name, char *out, size_t size) {
+    size_t length = (size_t)snprintf(out, size, "%s", prefix);
+    for (const char *c = name; *c && length + 4 < size; c++) {
+        if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9')) {
+            out[length++] = *c;
+        } else if (*c == '_') {
+            length += (size_t)snprintf(out + length, size - length, "__");
+        } else {
+            length += (size_t)snprintf(out + length, size - length, "_%02x", (unsigned char)*c);
+        }
+    }
+    out[length] = '\0';
+}
+
+static x86_operand_t x86_slot(int index) {
+    x86_operand_t operand;
+    int offset = X86_SLOT_SIZE * (index + 1);
+    snprintf(operand.kind, sizeof(operand.kind), "-%d(%%rbp)", offset);
+    snprintf(operand.payload, sizeof(operand.payload), "-%d(%%rbp)", offset - 8);
+    operand.known = X86_UNDEFINED;
+    operand.typed = false;
+    return operand;
+}
+
+static x86_operand_t x86_symbol(const char *prefix, const char *name) {
+    x86_operand_t operand;
+    char symbol[64];
+    x86_mangle(prefix, name, symbol, sizeof(symbol));
+    snprintf(operand.kind, sizeof(operand.kind), "%s(%%rip)", symbol);
+    snprintf(operand.payload, sizeof(operand.payload), "%s+8(%%rip)", symbol);
+    operand.known = X86_UNDEFINED;
+    operand.typed = false;
+    return operand;
+}
+
+/**
+ * @brief Returns the tag of a literal operand.
+ */
+static int x86_literal_kind(const char *operand) {
+    if (strncmp(operand, "int@", 4) == 0) return X86_INT;
+    if (strncmp(operand, "float@", 6) == 0) return X86_FLOAT;
+    if (strncmp(operand, "bool@", 5) == 0) return X86_BOOL;
+    if (strncmp(operand, "nil@", 4) == 0) return X86_NIL;
+    if (strncmp(operand, "string@", 7) == 0) return X86_STRING;
+    return X86_UNDEFINED;
+}
+
+/**
+ * @brief Returns the operand of a variable or literal.
+ */
+static x86_operand_t x86_operand(const char *operand) {
+    if (strncmp(operand, "GF@", 3) == 0) return x86_symbol("g_", operand + 3);
+    if (strncmp(operand, "LF@", 3) == 0) {
+        int index = x86_name_index(&x86_locals, operand + 3);
+        x86_operand_t local = x86_slot(index);
+        local.known = x86_local_kinds[index];
+        local.typed = local.known != X86_UNDEFINED;
+        return local;
+    }
+    int kind = x86_literal_kind(operand);
+    if (kind == X86_UNDEFINED) {
+        fprintf(stderr, "Error: The x86-64 backend does not support the operand %s.\n", operand);
+        exit(EXIT_FAILURE);
+    }
+    char index[16];
+    snprintf(index, sizeof(index), "%d", x86_name_index(&x86_constants, operand));
+    x86_operand_t constant = x86_symbol("k_", index);
+    constant.known = kind;
+    return constant;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Folded data stack                                                         */
+/* ------------------------------------------------------------------------ */
+
+static void x86_push(x86_operand_t operand) {
+    if (x86_stack_count == x86_stack_capacity) {
+        x86_stack_capacity = x86_stack_capacity ? 2 * x86_stack_capacity : 16;
+        x86_operand_t *grown = realloc(x86_stack, x86_stack_capacity * sizeof(x86_operand_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for the x86-64 backend.\n");
+            exit(EXIT_FAILURE);
+        }
+        x86_stack = grown;
+    }
+    x86_stack[x86_stack_count++] = operand;
+}
+
+/**
+ * @brief Returns the slot holding the folded stack value at a depth.
+ */
+static x86_operand_t x86_temp(int depth) {
+    if (depth + 1 > x86_temp_count) x86_temp_count = depth + 1;
+    return x86_slot(x86_locals.count + X86_POP_SLOTS + depth);
+}
+
+/**
+ * @brief Pops values, the last one from the top.
+ * @details Values missing on the folded stack are popped from the runtime's
+ *          data stack into slots of their own.
+ */
+static void x86_pop(x86_operand_t *values, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        if (x86_stack_count > 0) {
+            values[i] = x86_stack[--x86_stack_count];
+        } else {
+            values[i] = x86_slot(x86_locals.count + x86_pop_count++);
+            x86_line("leaq %s, %%rdi", values[i].kind);
+            x86_line("call rt_x86_pop");
+        }
+    }
+}
+
+/**
+ * @brief Pushes the values left on the folded stack to the runtime's data stack.
+ */
+static void x86_flush() {
+    for (int i = 0; i < x86_stack_count; i++) {
+        x86_line("leaq %s, %%rdi", x86_stack[i].kind);
+        x86_line("call rt_x86_push");
+    }
+    x86_stack_count = 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Instructions                                                              */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Prints a call of the runtime with the addresses of values as arguments.
+ */
+static void x86_call(const char *function, const x86_operand_t *values, int count) {
+    static const char *const registers[] = { "%rdi", "%rsi", "%rdx", "%rcx" };
+    for (int i = 0; i < count; i++) {
+        x86_line("leaq %s, %s", values[i].kind, registers[i]);
+    }
+    x86_line("call %s", function);
+}
+
+/**
+ * @brief Jumps to a label unless a value has a tag, known tags need no test.
+ */
+static bool x86_check_kind(const x86_operand_t *value, int kind, const char *otherwise) {
+    if (value->known != X86_UNDEFINED) {
+        if (value->known != kind) x86_line("jmp %s", otherwise);
+        return value->known == kind;
+    }
+    x86_line("cmpl $%d, %s", kind, value->kind);
+    x86_line("jne %s", otherwise);
+    return true;
+}
+
+/**
+ * @brief Jumps to the slow path unless the destination can be overwritten in place.
+ * @details Defined variables holding no string can take a new value without a release,
+ *          typed variables never hold one.
+ */
+static void x86_check_destination(const x86_operand_t *destination, const char *slow) {
+    if (destination->typed) return;
+    x86_line("movl %s, %%ecx", destination->kind);
+    x86_line("subl $%d, %%ecx", X86_UNSET);
+    x86_line("cmpl $%d, %%ecx", X86_BOOL - X86_UNSET);
+    x86_line("ja %s", slow);
+}
+
+static void x86_store(const x86_operand_t *destination, int kind, const char *source) {
+    if (!destination->typed) x86_line("movl $%d, %s", kind, destination->kind);
+    x86_line("%s %s, %s", kind == X86_FLOAT ? "movsd" : "movq", source, destination->payload);
+}
+
+/**
+ * @brief Prints an operation computing a value from one or two values.
+ * @details Integer and float operands take an inline path, the runtime
+ *          function handles the remaining cases including errors.
+ */
+static void x86_operation(const char *opcode, x86_operand_t destination, const x86_operand_t *a, const x86_operand_t *b) {
+    int label = x86_label_counter++;
+    char slow[32], next[32], done[32];
+    snprintf(slow, sizeof(slow), ".Ls%d", label);
+    snprintf(next, sizeof(next), ".Lf%d", label);
+    snprintf(done, sizeof(done), ".Ld%d", label);
+
+    bool arithmetic = strcmp(opcode, "ADD") == 0 || strcmp(opcode, "SUB") == 0 || strcmp(opcode, "MUL") == 0;
+    bool compare = strcmp(opcode, "LT") == 0 || strcmp(opcode, "GT") == 0 || strcmp(opcode, "EQ") == 0;
+    bool integers = arithmetic || compare || strcmp(opcode, "IDIV") == 0;
+    bool floats = arithmetic || strcmp(opcode, "DIV") == 0 || strcmp(opcode, "LT") == 0 || strcmp(opcode, "GT") == 0;
+    if (b == NULL) integers = floats = false;
+
+    if (integers || floats) {
+        x86_check_destination(&destination, slow);
+    }
+    if (integers && x86_check_kind(a, X86_INT, next) && x86_check_kind(b, X86_INT, next)) {
+        if (strcmp(opcode, "IDIV") == 0) {
+            x86_line("movq %s, %%rcx", b->payload);
+            x86_line("testq %%rcx, %%rcx");
+            x86_line("je %s", slow);
+            x86_line("cmpq $-1, %%rcx");
+            x86_line("je %s", slow);
+            x86_line("movq %s, %%rax", a->payload);
+            x86_line("cqto");
+            x86_line("idivq %%rcx");
+        } else {
+            x86_line("movq %s, %%rax", a->payload);
+        }
+        if (arithmetic) {
+            const char *instruction = strcmp(opcode, "ADD") == 0 ? "addq" : strcmp(opcode, "SUB") == 0 ? "subq" : "imulq";
+            x86_line("%s %s, %%rax", instruction, b->payload);
+        }
+        if (compare) {
+            const char *set = strcmp(opcode, "LT") == 0 ? "setl" : strcmp(opcode, "GT") == 0 ? "setg" : "sete";
+            x86_line("cmpq %s, %%rax", b->payload);
+            x86_line("%s %%al", set);
+            x86_line("movzbq %%al, %%rax");
+        }
+        x86_store(&destination, compare ? X86_BOOL : X86_INT, "%rax");
+        x86_line("jmp %s", done);
+    }
+    if (integers) {
+        fprintf(x86_out, "%s:\n", next);
+    }
+    if (floats && x86_check_kind(a, X86_FLOAT, slow) && x86_check_kind(b, X86_FLOAT, slow)) {
+        if (strcmp(opcode, "DIV") == 0) {
+            x86_line("movsd %s, %%xmm1", b->payload);
+            x86_line("xorpd %%xmm2, %%xmm2");
+            x86_line("ucomisd %%xmm2, %%xmm1");
+            x86_line("je %s", slow);
+            x86_line("movsd %s, %%xmm0", a->payload);
+            x86_line("divsd %%xmm1, %%xmm0");
+            x86_store(&destination, X86_FLOAT, "%xmm0");
+        } else if (arithmetic) {
+            const char *instruction = strcmp(opcode, "ADD") == 0 ? "addsd" : strcmp(opcode, "SUB") == 0 ? "subsd" : "mulsd";
+            x86_line("movsd %s, %%xmm0", a->payload);
+            x86_line("%s %s, %%xmm0", instruction, b->payload);
+            x86_store(&destination, X86_FLOAT, "%xmm0");
+        } else {
+            // Unordered operands leave the flags of "above" clear, so NaN compares false
+            bool less = strcmp(opcode, "LT") == 0;
+            x86_line("movsd %s, %%xmm0", less ? b->payload : a->payload);
+            x86_line("ucomisd %s, %%xmm0", less ? a->payload : b->payload);
+            x86_line("seta %%al");
+            x86_line("movzbq %%al, %%rax");
+            x86_store(&destination, X86_BOOL, "%rax");
+        }
+        x86_line("jmp %s", done);
+    }
+
+    fprintf(x86_out, "%s:\n", slow);
+    char function[32];
+    snprintf(function, sizeof(function), "rt_x86_%s", opcode);
+    for (char *c = function; *c; c++) {
+        if (*c >= 'A' && *c <= 'Z') *c = (char)(*c - 'A' + 'a');
+    }
+    x86_operand_t values[3] = { destination, *a, b ? *b : *a };
+    x86_call(function, values, b ? 3 : 2);
+    fprintf(x86_out, "%s:\n", done);
+}
+
+/**
+ * @brief Returns the tag of the result of an operation, X86_UNDEFINED if not known.
+ * @details Integer and float arithmetic and comparisons of operands with known
+ *          tags have a result of a known tag, whichever path computes it.
+ */
+static int x86_result_kind(const char *opcode, const x86_operand_t *a, const x86_operand_t *b) {
+    if (b == NULL || a->known != b->known || (a->known != X86_INT && a->known != X86_FLOAT)) return X86_UNDEFINED;
+    if (strcmp(opcode, "LT") == 0 || strcmp(opcode, "GT") == 0 || strcmp(opcode, "EQ") == 0) return X86_BOOL;
+    if (strcmp(opcode, "ADD") == 0 || strcmp(opcode, "SUB") == 0 || strcmp(opcode, "MUL") == 0) return a->known;
+    if (strcmp(opcode, "IDIV") == 0) return a->known == X86_INT ? X86_INT : X86_UNDEFINED;
+    if (strcmp(opcode, "DIV") == 0) return a->known == X86_FLOAT ? X86_FLOAT : X86_UNDEFINED;
+    return X86_UNDEFINED;
+}
+
+/**
+ * @brief Prints a move of a value, values other than strings are copied inline.
+ * @details The parser lets a typed variable receive only values of its type.
+ */
+static void x86_move(x86_operand_t destination, const x86_operand_t *source) {
+    int label = x86_label_counter++;
+    char slow[32], done[32];
+    snprintf(slow, sizeof(slow), ".Ls%d", label);
+    snprintf(done, sizeof(done), ".Ld%d", label);
+    if (destination.typed) {
+        // The source has the type of the destination, only the payload changes
+        if (strcmp(source->payload, destination.payload) != 0) {
+            x86_line("movq %s, %%rdx", source->payload);
+            x86_line("movq %%rdx, %s", destination.payload);
+        }
+        return;
+    }
+    if (source->known != X86_STRING) {
+        x86_check_destination(&destination, slow);
+        if (source->known != X86_UNDEFINED) {
+            x86_line("movl $%d, %%eax", source->known);
+        } else {
+            x86_line("movl %s, %%eax", source->kind);
+            x86_line("cmpl $%d, %%eax", X86_NIL);
+            x86_line("jb %s", slow);
+            x86_line("cmpl $%d, %%eax", X86_STRING);
+            x86_line("je %s", slow);
+        }
+        x86_line("movq %s, %%rdx", source->payload);
+        x86_line("movl %%eax, %s", destination.kind);
+        x86_line("movq %%rdx, %s", destination.payload);
+        x86_line("jmp %s", done);
+    }
+    fprintf(x86_out, "%s:\n", slow);
+    x86_operand_t values[2] = { destination, *source };
+    x86_call("rt_x86_move", values, 2);
+    fprintf(x86_out, "%s:\n", done);
+}
+
+/**
+ * @brief Prints a jump taken if two values are equal, or unequal with negate.
+ * @details Integers and booleans compare inline.
+ */
+static void x86_jump_if(const char *target, bool negate, const x86_operand_t *a, const x86_operand_t *b) {
+    int label = x86_label_counter++;
+    char slow[32], done[32], boolean[32];
+    snprintf(slow, sizeof(slow), ".Ls%d", label);
+    snprintf(done, sizeof(done), ".Ld%d", label);
+    snprintf(boolean, sizeof(boolean), ".Lb%d", label);
+    const char *jump = negate ? "jne" : "je";
+
+    int kind = a->known == X86_INT || a->known == X86_BOOL ? a->known :
+               b->known == X86_INT || b->known == X86_BOOL ? b->known : X86_UNDEFINED;
+    if (kind != X86_UNDEFINED) {
+        if (x86_check_kind(a, kind, slow) && x86_check_kind(b, kind, slow)) {
+            x86_line(kind == X86_INT ? "movq %s, %%rax" : "movl %s, %%eax", a->payload);
+            x86_line(kind == X86_INT ? "cmpq %s, %%rax" : "cmpl %s, %%eax", b->payload);
+            x86_line("%s %s", jump, target);
+            x86_line("jmp %s", done);
+        }
+    } else if (a->known == X86_UNDEFINED && b->known == X86_UNDEFINED) {
+        x86_line("movl %s, %%eax", a->kind);
+        x86_line("cmpl %s, %%eax", b->kind);
+        x86_line("jne %s", slow);
+        x86_line("cmpl $%d, %%eax", X86_INT);
+        x86_line("jne %s", boolean);
+        x86_line("movq %s, %%rax", a->payload);
+        x86_line("cmpq %s, %%rax", b->payload);
+        x86_line("%s %s", jump, target);
+        x86_line("jmp %s", done);
+        fprintf(x86_out, "%s:\n", boolean);
+        x86_line("cmpl $%d, %%eax", X86_BOOL);
+        x86_line("jne %s", slow);
+        x86_line("movl %s, %%eax", a->payload);
+        x86_line("cmpl %s, %%eax", b->payload);
+        x86_line("%s %s", jump, target);
+        x86_line("jmp %s", done);
+    }
+    fprintf(x86_out, "%s:\n", slow);
+    x86_operand_t values[2] = { *a, *b };
+    x86_call("rt_x86_test_eq", values, 2);
+    x86_line("testq %%rax, %%rax");
+    x86_line("%s %s", negate ? "je" : "jne", target);
+    fprintf(x86_out, "%s:\n", done);
+}
+
+/**
+ * @brief Prints the release of all slots holding strings and the return.
+ */
+static void x86_leave(int slots) {
+    for (int i = 0; i < slots; i++) {
+        if (i < x86_locals.count && x86_local_kinds[i] != X86_UNDEFINED) continue;
+        x86_operand_t slot = x86_slot(i);
+        int label = x86_label_counter++;
+        x86_line("cmpl $%d, %s", X86_STRING, slot.kind);
+        x86_line("jne .Lr%d", label);
+        x86_line("leaq %s, %%rdi", slot.kind);
+        x86_line("call rt_x86_release");
+        fprintf(x86_out, ".Lr%d:\n", label);
+    }
+    x86_line("leave");
+    x86_line("ret");
+}
+
+/**
+ * @brief Returns the operations computing a value, with their number of operands.
+ */
+static int x86_operation_arity(const char *opcode) {
+    static const char *const binary[] = {
+        "ADD", "SUB", "MUL", "DIV", "IDIV", "LT", "GT", "EQ", "AND", "OR", "STRI2INT", "CONCAT", "GETCHAR",
+    };
+    static const char *const unary[] = { "NOT", "INT2FLOAT", "FLOAT2INT", "INT2CHAR", "STRLEN" };
+    for (size_t i = 0; i < sizeof(binary) / sizeof(binary[0]); i++) {
+        if (strcmp(binary[i], opcode) == 0) return 2;
+    }
+    for (size_t i = 0; i < sizeof(unary) / sizeof(unary[0]); i++) {
+        if (strcmp(unary[i], opcode) == 0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Translates one instruction of a function.
+ */
+static void x86_instruction(const ir_instr_t *instr) {
+    char *const *op = instr->operands;
+    char stack_opcode[16];
+    x86_operand_t values[IR_MAX_OPERANDS];
+    char label[128];
+    x86_pop_count = 0;
+
+    size_t length = strlen(instr->opcode);
+    snprintf(stack_opcode, sizeof(stack_opcode), "%.*s", (int)(length > 0 ? length - 1 : 0), instr->opcode);
+    int stack_arity = length > 1 && instr->opcode[length - 1] == 'S' ? x86_operation_arity(stack_opcode) : 0;
+
+    if (ir_is(instr, "PUSHS")) {
+        x86_push(x86_operand(op[0]));
+        return;
+    }
+    if (stack_arity > 0) {
+        x86_pop(values, stack_arity);
+        x86_operand_t result = x86_temp(x86_stack_count);
+        x86_operation(stack_opcode, result, &values[0], stack_arity == 2 ? &values[1] : NULL);
+        result.known = x86_result_kind(stack_opcode, &values[0], stack_arity == 2 ? &values[1] : NULL);
+        x86_push(result);
+        return;
+    }
+    if (ir_is(instr, "POPS")) {
+        x86_operand_t destination = x86_operand(op[0]);
+        if (x86_stack_count > 0) {
+            x86_pop(values, 1);
+            x86_flush();
+            x86_move(destination, &values[0]);
+        } else {
+            x86_call("rt_x86_pop", &destination, 1);
+        }
+        return;
+    }
+    if (ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+        x86_pop(values, 2);
+        x86_flush();
+        x86_mangle(".Lj", op[0], label, sizeof(label));
+        x86_jump_if(label, ir_is(instr, "JUMPIFNEQS"), &values[0], &values[1]);
+        return;
+    }
+    x86_flush();
+
+    int arity = x86_operation_arity(instr->opcode);
+    if (arity > 0) {
+        values[0] = x86_operand(op[1]);
+        if (arity == 2) values[1] = x86_operand(op[2]);
+        x86_operation(instr->opcode, x86_operand(op[0]), &values[0], arity == 2 ? &values[1] : NULL);
+    } else if (ir_is(instr, "MOVE")) {
+        values[0] = x86_operand(op[1]);
+        x86_move(x86_operand(op[0]), &values[0]);
+    } else if (ir_is(instr, "DEFVAR")) {
+        values[0] = x86_operand(op[0]);
+        if (values[0].typed) {
+            // The prologue defines typed variables
+        } else if (strncmp(op[0], "LF@", 3) == 0) {
+            // A redefinition is left to the runtime, which reports it
+            int skip = x86_label_counter++;
+            x86_line("cmpl $%d, %s", X86_UNDEFINED, values[0].kind);
+            x86_line("jne .Ls%d", skip);
+            x86_line("movl $%d, %s", X86_UNSET, values[0].kind);
+            x86_line("jmp .Ld%d", skip);
+            fprintf(x86_out, ".Ls%d:\n", skip);
+            x86_call("rt_x86_defvar", values, 1);
+            fprintf(x86_out, ".Ld%d:\n", skip);
+        } else {
+            x86_call("rt_x86_defvar", values, 1);
+        }
+    } else if (ir_is(instr, "CREATEFRAME") || ir_is(instr, "PUSHFRAME") || ir_is(instr, "POPFRAME")) {
+        // The frame of a function is its stack frame
+    } else if (ir_is(instr, "CALL")) {
+        const builtin_info_t *builtin = builtin_lookup(op[0]);
+        if (builtin) {
+            bool result = strcmp(op[0], "$ifj_write") != 0;
+            x86_operand_t args[IR_MAX_OPERANDS + 1];
+            args[0] = x86_symbol("g_", "return");
+            x86_pop(args + (result ? 1 : 0), builtin->arity);
+            x86_flush();
+            snprintf(label, sizeof(label), "rt_x86_%s", op[0] + 1);
+            x86_call(label, args, builtin->arity + (result ? 1 : 0));
+        } else if (x86_name_contains(&x86_functions, op[0])) {
+            x86_mangle("f_", op[0] + 1, label, sizeof(label));
+            x86_line("call %s", label);
+        } else {
+            fprintf(stderr, "Error: The x86-64 backend cannot call %s, it does not start a function.\n", op[0]);
+            exit(EXIT_FAILURE);
+        }
+    } else if (ir_is(instr, "RETURN")) {
+        x86_line("jmp %s", x86_return);
+    } else if (ir_is(instr, "CLEARS")) {
+        x86_line("call rt_x86_clears");
+    } else if (ir_is(instr, "READ")) {
+        values[0] = x86_operand(op[0]);
+        int kind = strcmp(op[1], "int") == 0 ? X86_INT : strcmp(op[1], "float") == 0 ? X86_FLOAT :
+                   strcmp(op[1], "bool") == 0 ? X86_BOOL : X86_STRING;
+        x86_line("movq $%d, %%rsi", kind);
+        x86_call("rt_x86_read", values, 1);
+    } else if (ir_is(instr, "WRITE") || ir_is(instr, "DPRINT") || ir_is(instr, "EXIT")) {
+        values[0] = x86_operand(op[0]);
+        x86_call(ir_is(instr, "WRITE") ? "rt_x86_write" : ir_is(instr, "EXIT") ? "rt_x86_exit" : "rt_x86_dprint", values, 1);
+    } else if (ir_is(instr, "BREAK")) {
+        x86_line("call rt_x86_break");
+    } else if (ir_is(instr, "SETCHAR") || ir_is(instr, "TYPE")) {
+        for (int i = 0; i < instr->operand_count; i++) {
+            values[i] = x86_operand(op[i]);
+        }
+        x86_call(ir_is(instr, "TYPE") ? "rt_x86_type" : "rt_x86_setchar", values, instr->operand_count);
+    } else if (ir_is(instr, "LABEL")) {
+        x86_mangle(".Lj", op[0], label, sizeof(label));
+        fprintf(x86_out, "%s:\n", label);
+    } else if (ir_is(instr, "JUMP")) {
+        x86_mangle(".Lj", op[0], label, sizeof(label));
+        x86_line("jmp %s", label);
+    } else if (ir_is(instr, "JUMPIFEQ") || ir_is(instr, "JUMPIFNEQ")) {
+        values[0] = x86_operand(op[1]);
+        values[1] = x86_operand(op[2]);
+        x86_mangle(".Lj", op[0], label, sizeof(label));
+        x86_jump_if(label, ir_is(instr, "JUMPIFNEQ"), &values[0], &values[1]);
+    } else {
+        fprintf(stderr, "Error: The x86-64 backend does not support the instruction %s.\n", instr->opcode);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static bool x86_is_jump(const ir_instr_t *instr) {
+    return ir_is(instr, "JUMP") || ir_is(instr, "JUMPIFEQ") || ir_is(instr, "JUMPIFNEQ") ||
+           ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS");
+}
+
+/**
+ * @brief Translates the instructions from first up to last, exclusive, into a function.
+ * @details The body goes to a temporary file first, since the size of the
+ *          stack frame is known only after the folded stack is translated.
+ */
+static void x86_function(const char *symbol, const ir_instr_t *first, const ir_instr_t *last, bool entry) {
+    x86_locals.count = 0;
+    x86_labels.count = 0;
+    x86_names_t defined = { NULL, 0, 0 };
+    for (const ir_instr_t *instr = first; instr != last; instr = instr->next) {
+        if (ir_is(instr, "LABEL")) x86_name_index(&defined, instr->operands[0]);
+        if (x86_is_jump(instr)) x86_name_index(&x86_labels, instr->operands[0]);
+        for (int i = 0; i < instr->operand_count; i++) {
+            if (strncmp(instr->operands[i], "LF@", 3) == 0) x86_name_index(&x86_locals, instr->operands[i] + 3);
+            if (strncmp(instr->operands[i], "TF@", 3) == 0) {
+                fprintf(stderr, "Error: The x86-64 backend does not support the operand %s.\n", instr->operands[i]);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    for (int i = 0; i < x86_labels.count; i++) {
+        if (!x86_name_contains(&defined, x86_labels.names[i])) {
+            fprintf(stderr, "Error: The x86-64 backend cannot jump to %s outside of the function.\n", x86_labels.names[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(defined.names);
+
+    // A local is typed when all its DEFVARs agree on an integer or float type
+    x86_local_kinds = malloc((x86_locals.count + 1) * sizeof(int));
+    if (x86_local_kinds == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for the x86-64 backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < x86_locals.count; i++) {
+        x86_local_kinds[i] = -1;
+    }
+    for (const ir_instr_t *instr = first; instr != last; instr = instr->next) {
+        if (!ir_is(instr, "DEFVAR") || strncmp(instr->operands[0], "LF@", 3) != 0) continue;
+        int index = x86_name_index(&x86_locals, instr->operands[0] + 3);
+        int kind = instr->type == IR_TYPE_INT ? X86_INT : instr->type == IR_TYPE_FLOAT ? X86_FLOAT : X86_UNDEFINED;
+        x86_local_kinds[index] = x86_local_kinds[index] < 0 || x86_local_kinds[index] == kind ? kind : X86_UNDEFINED;
+    }
+    for (int i = 0; i < x86_locals.count; i++) {
+        if (x86_local_kinds[i] < 0) x86_local_kinds[i] = X86_UNDEFINED;
+    }
+
+    FILE *out = x86_out;
+    FILE *body = tmpfile();
+    if (body == NULL) {
+        fprintf(stderr, "Error: Could not create a temporary file for the x86-64 backend.\n");
+        exit(EXIT_FAILURE);
+    }
+    x86_out = body;
+    x86_temp_count = 0;
+    snprintf(x86_return, sizeof(x86_return), ".Lreturn_%s", symbol);
+    for (const ir_instr_t *instr = first; instr != last; instr = instr->next) {
+        if (instr->opcode[0] != '.') x86_instruction(instr);
+    }
+    x86_flush();
+    x86_out = out;
+
+    int slots = x86_locals.count + X86_POP_SLOTS + x86_temp_count;
+    fprintf(out, "\n    .globl %s\n    .type %s, @function\n%s:\n", symbol, symbol, symbol);
+    x86_line("pushq %%rbp");
+    x86_line("movq %%rsp, %%rbp");
+    x86_line("subq $%d, %%rsp", X86_SLOT_SIZE * slots);
+    for (int i = 0; i < slots; i++) {
+        x86_line("movq $%d, %s", i < x86_locals.count ? x86_local_kinds[i] : X86_UNSET, x86_slot(i).kind);
+    }
+    if (entry) {
+        for (int i = 0; i < x86_constants.count; i++) {
+            if (x86_literal_kind(x86_constants.names[i]) != X86_STRING) continue;
+            x86_line("leaq k_%d(%%rip), %%rdi", i);
+            x86_line("leaq s_%d(%%rip), %%rsi", i);
+            x86_line("movq $s_%d_end - s_%d, %%rdx", i, i);
+            x86_line("call rt_x86_string");
+        }
+    }
+
+    rewind(body);
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), body)) > 0) {
+        fwrite(buffer, 1, read, out);
+    }
+    fclose(body);
+
+    if (entry) {
+        x86_line("call f_main");
+        x86_line("call rt_x86_finish");
+        x86_line("xorl %%eax, %%eax");
+        x86_line("leave");
+        x86_line("ret");
+    } else {
+        fprintf(out, "%s:\n", x86_return);
+        x86_leave(slots);
+    }
+    free(x86_local_kinds);
+    x86_local_kinds = NULL;
+}
+
+/**
+ * @brief Prints the bytes of a string literal as assembler data.
+ * @details An escape sequence stands for a code point and becomes its UTF-8
+ *          encoding, like in the interpreter; other bytes are copied.
+ */
+static void x86_string_data(const char *text) {
+    fprintf(x86_out, "    .ascii \"");
+    while (*text) {
+        unsigned char bytes[2];
+        int size = 1;
+        if (text[0] == '\\' && text[1] && text[2] && text[3]) {
+            int code = (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+            if (code < 0x80) {
+                bytes[0] = (unsigned char)code;
+            } else {
+                bytes[0] = (unsigned char)(0xC0 | (code >> 6));
+                bytes[1] = (unsigned char)(0x80 | (code & 0x3F));
+                size = 2;
+            }
+            text += 4;
+        } else {
+            bytes[0] = (unsigned char)*text++;
+        }
+        for (int i = 0; i < size; i++) {
+            if (bytes[i] == '"' || bytes[i] == '\\') {
+                fprintf(x86_out, "\\%c", bytes[i]);
+            } else if (bytes[i] < 32 || bytes[i] >= 127) {
+                fprintf(x86_out, "\\%03o", bytes[i]);
+            } else {
+                fputc(bytes[i], x86_out);
+            }
+        }
+    }
+    fprintf(x86_out, "\"\n");
+}
+
+/**
+ * @brief Translates the program to x86-64 assembly.
+ * @details The header up to its jump to main becomes the C entry point main,
+ *          its built-in functions are replaced by the runtime.
+ * @param header Header and built-in functions.
+ * @param functions Code of all user functions, each starting with its label.
+ * @param count Number of functions.
+ * @param out Stream receiving the assembly.
+ */
+void emit_x86(ir_list_t *header, ir_list_t **functions, int count, FILE *out) {
+    x86_out = out;
+    x86_label_counter = 0;
+    const ir_instr_t *entry = header ? header->head : NULL;
+    while (entry && !(ir_is(entry, "JUMP") && strcmp(entry->operands[0], "$main") == 0)) {
+        entry = entry->next;
+    }
+    x86_names_t globals = { NULL, 0, 0 };
+    x86_name_index(&globals, "return");
+    for (int f = -1; f < count; f++) {
+        ir_list_t *code = f < 0 ? header : functions[f];
+        if (code == NULL) continue;
+        if (f >= 0 && ir_is(code->head, "LABEL")) x86_name_index(&x86_functions, code->head->operands[0]);
+        const ir_instr_t *end = f < 0 ? entry : NULL;
+        for (const ir_instr_t *instr = code->head; instr != end; instr = instr->next) {
+            for (int i = 0; i < instr->operand_count; i++) {
+                if (strncmp(instr->operands[i], "GF@", 3) == 0) x86_name_index(&globals, instr->operands[i] + 3);
+                if (x86_literal_kind(instr->operands[i]) != X86_UNDEFINED && !(ir_is(instr, "READ") && i == 1)) {
+                    x86_name_index(&x86_constants, instr->operands[i]);
+                }
+            }
+        }
+    }
+    if (!x86_name_contains(&x86_functions, "$main")) {
+        fprintf(stderr, "Error: The x86-64 backend found no main function.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(out, "# Generated by ifj24, link with the runtime printed by --emit=runtime\n");
+    fprintf(out, "    .text\n");
+    char symbol[80];
+    for (int f = 0; f < count; f++) {
+        ir_list_t *code = functions[f];
+        if (code == NULL || !ir_is(code->head, "LABEL")) continue;
+        x86_mangle("f_", code->head->operands[0] + 1, symbol, sizeof(symbol));
+        x86_function(symbol, code->head->next, NULL, false);
+    }
+    x86_function("main", header ? header->head : NULL, entry, true);
+
+    fprintf(out, "\n    .data\n    .align 16\n");
+    for (int i = 0; i < globals.count; i++) {
+        x86_mangle("g_", globals.names[i], symbol, sizeof(symbol));
+        fprintf(out, "%s:\n    .zero %d\n", symbol, X86_SLOT_SIZE);
+    }
+    for (int i = 0; i < x86_constants.count; i++) {
+        const char *literal = x86_constants.names[i];
+        int kind = x86_literal_kind(literal);
+        unsigned long long payload = 0;
+        if (kind == X86_INT) {
+            payload = (unsigned long long)strtoll(literal + 4, NULL, 10);
+        } else if (kind == X86_FLOAT) {
+            double number = strtod(literal + 6, NULL);
+            memcpy(&payload, &number, sizeof(payload));
+        } else if (kind == X86_BOOL) {
+            payload = strcmp(literal + 5, "true") == 0;
+        }
+        // Strings are created by the runtime when the program starts
+        fprintf(out, "k_%d:\n    .long %d, 0\n    .quad 0x%llx\n", i, kind == X86_STRING ? X86_UNDEFINED : kind, payload);
+    }
+    fprintf(out, "\n    .section .rodata\n");
+    for (int i = 0; i < x86_constants.count; i++) {
+        if (x86_literal_kind(x86_constants.names[i]) != X86_STRING) continue;
+        fprintf(out, "s_%d:\n", i);
+        x86_string_data(x86_constants.names[i] + 7);
+        fprintf(out, "s_%d_end:\n", i);
+    }
+    fprintf(out, "\n    .section .note.GNU-stack,\"\",@progbits\n");
+
+    free(globals.names);
+    free(x86_stack);
+    x86_stack = NULL;
+    x86_stack_count = x86_stack_capacity = 0;
+    x86_names_t *tables[] = { &x86_constants, &x86_functions, &x86_locals, &x86_labels };
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        free(tables[i]->names);
+        tables[i]->names = NULL;
+        tables[i]->count = tables[i]->capacity = 0;
+    }
+}
@@ -0,0 +1,14 @@
+/**
+ * IFJ24
+ * @brief Header for the translation of the generated IFJcode24 code to x86-64 assembly.
+ */
+
+#ifndef EMIT_X86_H
+#define EMIT_X86_H
+
+#include <stdio.h>
+#include "ir.h"
+
+void emit_x86(ir_list_t *header, ir_list_t **functions, int count, FILE *out);
+
+#endif
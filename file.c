@@ -5,85 +5,93 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define TEMP_FILE "temp_code.ifj"
+#define SOURCE_INIT_SIZE 4096
 
 /**
- * @brief Saves input from STDIN to a temporary file.
+ * @brief Reads the whole input into a memory buffer.
+ * @details The buffer stays allocated for the whole compilation, so string
+ *          tokens can reference the literals in it instead of copying them.
+ * @param input Stream to read, usually STDIN.
+ * @return Pointer to the loaded source code.
  */
-void save_input_to_file() {
-    FILE *file = fopen(TEMP_FILE, "w");
-    if (!file) {
-        perror("Failed to create temporary file");
+source_t *source_load(FILE *input) {
+    source_t *source = malloc(sizeof(source_t));
+    if (!source) {
+        perror("Failed to allocate source buffer");
         exit(EXIT_FAILURE);
     }
 
-    int c;
-    while ((c = getchar()) != EOF) {
-        if (fputc(c, file) == EOF) {
-            perror("Failed to write to temporary file");
-            fclose(file);
-            exit(EXIT_FAILURE);
+    size_t capacity = SOURCE_INIT_SIZE;
+    source->data = malloc(capacity);
+    source->length = 0;
+    source->position = 0;
+    if (!source->data) {
+        perror("Failed to allocate source buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t read;
+    while ((read = fread(source->data + source->length, 1, capacity - source->length, input)) > 0) {
+        source->length += read;
+        if (source->length == capacity) {
+            capacity *= 2;
+            char *grown = realloc(source->data, capacity);
+            if (!grown) {
+                perror("Failed to allocate source buffer");
+                exit(EXIT_FAILURE);
+            }
+            source->data = grown;
         }
     }
 
-    if (fclose(file) != 0) {
-        perror("Failed to close temporary file after writing");
+    if (ferror(input)) {
+        perror("Failed to read source code");
         exit(EXIT_FAILURE);
     }
+    return source;
 }
 
 /**
- * @brief Opens the temporary file for reading.
- * @return FILE* Pointer to the opened file.
+ * @brief Reads the next character of the source code.
+ * @param source Pointer to the source code.
+ * @return The character, or EOF at the end of the source code.
  */
-FILE* open_temp_file() {
-    FILE *file = fopen(TEMP_FILE, "r");
-    if (!file) {
-        perror("Failed to open temporary file");
-        exit(EXIT_FAILURE);
+int source_getc(source_t *source) {
+    if (source->position >= source->length) {
+        return EOF;
     }
-    return file;
+    return (unsigned char)source->data[source->position++];
 }
 
 /**
- * @brief Rewinds the temporary file to the beginning.
- * @param file Pointer to the file to rewind.
+ * @brief Returns the last read character back to the source code.
+ * @param source Pointer to the source code.
+ * @param c The returned character, EOF is ignored.
  */
-void rewind_file(FILE *file) {
-    if (!file) {
-        fprintf(stderr, "Error: Invalid file pointer in rewind_file\n");
-        return;
-    }
-    
-    if (fseek(file, 0, SEEK_SET) != 0) {
-        perror("Error rewinding file");
+void source_ungetc(source_t *source, int c) {
+    if (c != EOF && source->position > 0) {
+        source->position--;
     }
 }
 
 /**
- * @brief Deletes the temporary file.
+ * @brief Rewinds the source code to the beginning.
+ * @param source Pointer to the source code.
  */
-void cleanup_temp_file() {
-    if (remove(TEMP_FILE) != 0) {
-        perror("Failed to delete temporary file");
+void source_rewind(source_t *source) {
+    if (!source) {
+        fprintf(stderr, "Error: Invalid source in source_rewind\n");
+        return;
     }
+    source->position = 0;
 }
 
 /**
- * @brief Prints the content of the temporary file for debugging.
+ * @brief Frees the source code buffer.
+ * @param source Pointer to the source code.
  */
-void debug_temp_file() {
-    FILE *file = fopen(TEMP_FILE, "r");
-    if (!file) {
-        perror("Failed to open temporary file for debugging");
-        return;
-    }
-
-    printf("Temporary file content:\n");
-    int c;
-    while ((c = fgetc(file)) != EOF) {
-        putchar(c);
-    }
-
-    fclose(file);
-}
\ No newline at end of file
+void source_free(source_t *source) {
+    if (!source) return;
+    free(source->data);
+    free(source);
+}
@@ -6,10 +6,16 @@
 
 #include <stdio.h>
 
-void save_input_to_file();
-FILE* open_temp_file();
-void rewind_file(FILE *file);
-void cleanup_temp_file();
-void debug_temp_file();
+typedef struct {
+    char *data;         // Whole source code, tokens may reference slices of it
+    size_t length;
+    size_t position;    // Index of the next character to read
+} source_t;
 
-#endif 
\ No newline at end of file
+source_t *source_load(FILE *input);
+int source_getc(source_t *source);
+void source_ungetc(source_t *source, int c);
+void source_rewind(source_t *source);
+void source_free(source_t *source);
+
+#endif
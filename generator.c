@@ -4,11 +4,40 @@
  */
 
 #include "generator.h"
+#include "optimizer.h"
+#include "cfg.h"
+#include "vm.h"
+#include "emit_c.h"
+#include "emit_x86.h"
 #include <stdio.h>
+#include <stdint.h>
+
+typedef struct {
+    char *function;     // Name of the function containing the block
+    int line;           // Source line where the block starts
+    const char *kind;   // "function", "then", "else", "join", "loop" or "exit"
+} gen_counter_t;
 
 genStack *if_stack;      
 genStack *while_stack;   
 int label_counter; 
+bool compact_names = false;
+FILE *name_map = NULL;
+FILE *cfg_dump = NULL;
+bool string_pool = false;
+ir_list_t *header = NULL;           // Header and built-in functions, printed before the user functions
+ir_instr_t *header_entry = NULL;    // Jump to main, global definitions go in front of it
+int unroll_factor = 4;              // Copies of a counted loop body per iteration, 1 disables unrolling
+bool run_program = false;           // Run the program in the virtual machine instead of printing it
+int run_status = 0;                 // Exit code of the program run in the virtual machine
+emit_target_t emit_target = EMIT_IFJCODE;
+ir_instr_t *first_param_pop = NULL; // Pop of the first parameter of the current function
+ir_list_t **functions = NULL;       // Finished functions waiting for gen_program_finish()
+int function_count = 0, function_capacity = 0;
+source_t *instrument_source = NULL; // Source of the program when blocks get profile counters, else NULL
+gen_counter_t *counters = NULL;     // Source position of each profile counter GF@_prof_N
+int counter_count = 0, counter_capacity = 0;
+char current_function_name[256];    // Function whose blocks are being counted
 
 /**
  * @brief Initializes the generator by setting up stacks and counters.
@@ -32,6 +61,174 @@ void generator_init() {
     label_counter = 0;
 }
 
+/**
+ * @brief Selects whether functions are printed with compact local and label names.
+ * @param enabled True to rename locals and labels to short names.
+ * @param map Stream for the map back to the original names, or NULL.
+ */
+void gen_set_compact_names(bool enabled, FILE *map) {
+    compact_names = enabled;
+    name_map = map;
+}
+
+/**
+ * @brief Selects a stream for the control-flow graphs of generated functions.
+ * @param out Stream receiving one Graphviz graph per function, or NULL.
+ */
+void gen_set_cfg_dump(FILE *out) {
+    cfg_dump = out;
+}
+
+/**
+ * @brief Selects whether long or repeated string literals are defined once as global variables.
+ * @param enabled True to build the string pool.
+ */
+void gen_set_string_pool(bool enabled) {
+    string_pool = enabled;
+}
+
+/**
+ * @brief Selects whether the finished program is run in-process instead of printed.
+ * @param enabled True to run the program in the virtual machine.
+ */
+void gen_set_run(bool enabled) {
+    run_program = enabled;
+}
+
+/**
+ * @brief Selects the language the finished program is printed in.
+ * @param target IFJcode24, C source including its runtime, or x86-64 assembly
+ *               linked with the runtime.
+ */
+void gen_set_emit(emit_target_t target) {
+    emit_target = target;
+}
+
+/**
+ * @brief Selects whether each block of the program counts how often it runs.
+ * @details Every function entry and every block of an if or a while increments
+ *          its own global counter, and main writes all of them to stdout before
+ *          it exits, one "profile FUNCTION LINE KIND COUNT" line per counter.
+ * @param source Source code the counters report lines of, or NULL to disable counting.
+ */
+void gen_set_instrument(source_t *source) {
+    instrument_source = source;
+}
+
+/**
+ * @brief Returns the line of the source code the scanner has reached.
+ * @details Newlines are counted on from the previous call, the parser only
+ *          moves forward through the source.
+ */
+static int gen_source_line() {
+    static size_t counted = 0;
+    static int line = 1;
+    size_t position = instrument_source->position;
+    if (position < counted) {
+        counted = 0;
+        line = 1;
+    }
+    for (; counted < position && counted < instrument_source->length; counted++) {
+        if (instrument_source->data[counted] == '\n') line++;
+    }
+    return line;
+}
+
+/**
+ * @brief Starts a block with an increment of its own profile counter.
+ * @param kind Kind of the block reported with the counter.
+ */
+static void gen_count_block(const char *kind) {
+    if (instrument_source == NULL) return;
+    if (counter_count == counter_capacity) {
+        counter_capacity = counter_capacity ? counter_capacity * 2 : 16;
+        gen_counter_t *grown = realloc(counters, counter_capacity * sizeof(gen_counter_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for profile counters.\n");
+            exit(EXIT_FAILURE);
+        }
+        counters = grown;
+    }
+    gen_counter_t *counter = &counters[counter_count];
+    counter->function = malloc(strlen(current_function_name) + 1);
+    if (counter->function == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for profile counters.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(counter->function, current_function_name);
+    counter->line = gen_source_line();
+    counter->kind = kind;
+    ir_emit("ADD GF@_prof_%d GF@_prof_%d int@1\n", counter_count, counter_count);
+    counter_count++;
+}
+
+/**
+ * @brief Defines the profile counters and makes main write them before it exits.
+ * @details The counters are defined in front of the jump to main. The writes
+ *          go to a function $_prof_dump, called in front of each EXIT and
+ *          RETURN of main.
+ */
+static void gen_finish_counters() {
+    if (counter_count == 0 || header == NULL) return;
+    char name[32];
+    for (int i = 0; i < counter_count; i++) {
+        snprintf(name, sizeof(name), "GF@_prof_%d", i);
+        ir_insert_before(header, header_entry, ir_instr_create("DEFVAR", 1, name));
+        ir_insert_before(header, header_entry, ir_instr_create("MOVE", 2, name, "int@0"));
+    }
+
+    for (int i = 0; i < function_count; i++) {
+        ir_list_t *code = functions[i];
+        if (!ir_is(code->head, "LABEL") || strcmp(code->head->operands[0], "$main") != 0) continue;
+        for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+            if (!instr->dead && (ir_is(instr, "EXIT") || ir_is(instr, "RETURN"))) {
+                ir_insert_before(code, instr, ir_instr_create("CALL", 1, "$_prof_dump"));
+            }
+        }
+    }
+
+    ir_list_t *dump = ir_list_create();
+    ir_begin(dump);
+    ir_emit("\nLABEL $_prof_dump\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    for (int i = 0; i < counter_count; i++) {
+        ir_emit("WRITE string@profile\\032%s\\032%d\\032%s\\032\n", counters[i].function, counters[i].line, counters[i].kind);
+        ir_emit("WRITE GF@_prof_%d\n", i);
+        ir_emit("WRITE string@\\010\n");
+    }
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+    gen_func_finish();
+}
+
+/**
+ * @brief Releases the source positions of the profile counters.
+ */
+static void gen_free_counters() {
+    for (int i = 0; i < counter_count; i++) {
+        free(counters[i].function);
+    }
+    free(counters);
+    counters = NULL;
+    counter_count = counter_capacity = 0;
+}
+
+/**
+ * @brief Returns the exit code of the program run by gen_program_finish().
+ */
+int gen_run_status() {
+    return run_status;
+}
+
+/**
+ * @brief Sets how many copies of the body a partially unrolled counted loop runs per iteration.
+ * @param factor Unroll factor, 1 or less disables partial unrolling.
+ */
+void gen_set_unroll_factor(int factor) {
+    unroll_factor = factor;
+}
+
 /**
  * @brief Cleans up the generator by freeing allocated stacks.
  * @details Ensures memory allocated for the if and while stacks is freed.
@@ -45,19 +242,35 @@ void generator_cleanup() {
         free(while_stack);
         while_stack = NULL;
     }
+    ir_list_free(ir_end());
+    ir_list_free(header);
+    header = NULL;
+    header_entry = NULL;
+    for (int i = 0; i < function_count; i++) {
+        ir_list_free(functions[i]);
+    }
+    free(functions);
+    functions = NULL;
+    function_count = function_capacity = 0;
+    gen_free_counters();
 }
 
 /**
  * @brief Generates the header for IFJcode24.
- * @details Outputs initial IFJcode24 setup, including definitions and the main label.
+ * @details Buffers initial IFJcode24 setup, including definitions and the jump
+ *          to main, and the built-in functions until gen_program_finish().
  */
 void gen_header() {
-    printf(".IFJcode24\n");
-    printf("DEFVAR GF@return\n");
-    printf("DEFVAR GF@_discard\n");
-    printf("DEFVAR GF@temp\n");
-    printf("JUMP $main\n");
+    header = ir_list_create();
+    ir_begin(header);
+    ir_emit(".IFJcode24\n");
+    ir_emit("DEFVAR GF@return\n");
+    ir_emit("DEFVAR GF@_discard\n");
+    ir_emit("DEFVAR GF@temp\n");
+    ir_emit("JUMP $main\n");
+    header_entry = ir_last();
     gen_builtin_functions();
+    ir_end();
 }
 
 /**
@@ -66,199 +279,195 @@ void gen_header() {
  */
 void gen_builtin_functions() {
     // Built-in: ifj.readstr
-    printf("\nLABEL $ifj_readstr\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("READ GF@return string\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_readstr\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("READ GF@return string\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.readi32
-    printf("\nLABEL $ifj_readi32\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("READ GF@return int\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_readi32\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("READ GF@return int\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.readf64
-    printf("\nLABEL $ifj_readf64\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("READ GF@return float\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_readf64\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("READ GF@return float\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.write
-    printf("\nLABEL $ifj_write\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("POPS LF@param1\n");
-    printf("WRITE LF@param1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_write\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("WRITE LF@param1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.i2f
-    printf("\nLABEL $ifj_i2f\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");;
-    printf("POPS LF@param1\n");
-    printf("INT2FLOAT GF@return LF@param1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_i2f\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");;
+    ir_emit("POPS LF@param1\n");
+    ir_emit("INT2FLOAT GF@return LF@param1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.f2i
-    printf("\nLABEL $ifj_f2i\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("POPS LF@param1\n");
-    printf("FLOAT2INT GF@return LF@param1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-
-    printf("\nLABEL $ifj_string\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");  
-    printf("POPS LF@param1\n");    
-    printf("MOVE GF@return LF@param1\n"); 
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_f2i\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("FLOAT2INT GF@return LF@param1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+
+    ir_emit("\nLABEL $ifj_string\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");  
+    ir_emit("POPS LF@param1\n");    
+    ir_emit("MOVE GF@return LF@param1\n"); 
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.concat
-    printf("\nLABEL $ifj_concat\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("DEFVAR LF@param2\n");
-    printf("POPS LF@param1\n");
-    printf("POPS LF@param2\n");
-    printf("CONCAT GF@return LF@param1 LF@param2\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_concat\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("DEFVAR LF@param2\n");
+    ir_emit("POPS LF@param2\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("CONCAT GF@return LF@param1 LF@param2\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.length
-    printf("\nLABEL $ifj_length\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("POPS LF@param1\n");
-    printf("STRLEN GF@return LF@param1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_length\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("STRLEN GF@return LF@param1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.chr
-    printf("\nLABEL $ifj_chr\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("POPS LF@param1\n");
-    printf("INT2CHAR GF@return LF@param1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_chr\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("INT2CHAR GF@return LF@param1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 
     // Built-in: ifj.ord
-    printf("\nLABEL $ifj_ord\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n"); 
-    printf("DEFVAR LF@param2\n"); 
-    printf("DEFVAR LF@length\n"); 
-    printf("DEFVAR LF@char\n");   
-    printf("DEFVAR LF@result\n"); 
-    printf("DEFVAR LF@type_check\n"); 
-    printf("POPS LF@param1\n");
-    printf("POPS LF@param2\n");
-    printf("TYPE LF@type_check LF@param1\n");
-    printf("JUMPIFNEQ $ord_error LF@type_check string@string\n");
-    printf("STRLEN LF@length LF@param1\n");
-    printf("LT GF@temp LF@param2 int@0\n");
-    printf("JUMPIFEQ $ord_error GF@temp bool@true\n");
-    printf("LT GF@temp LF@param2 LF@length\n");
-    printf("JUMPIFEQ $ord_inbounds GF@temp bool@true\n");
-    printf("LABEL $ord_error\n");
-    printf("MOVE GF@return int@0\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-    printf("LABEL $ord_inbounds\n");
-    printf("STRI2INT LF@result LF@param1 LF@param2\n");
-    printf("MOVE GF@return LF@result\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-
-    // Built-in: ifj.substring !!!!!
-    printf("\nLABEL $ifj_substring\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@param1\n");
-    printf("DEFVAR LF@param2\n");
-    printf("DEFVAR LF@param3\n");
-    printf("DEFVAR LF@result\n");
-    printf("DEFVAR LF@char\n");
-    printf("DEFVAR LF@index\n");
-    printf("DEFVAR LF@end\n");
-    printf("DEFVAR LF@type_check\n");
-    printf("MOVE LF@result string@\n");
-    printf("POPS LF@param1\n");
-    printf("POPS LF@param2\n");
-    printf("POPS LF@param3\n");
-    printf("TYPE LF@type_check LF@param2\n");
-    printf("JUMPIFNEQ $substr_error LF@type_check string@int\n");
-    printf("TYPE LF@type_check LF@param3\n");
-    printf("JUMPIFNEQ $substr_error LF@type_check string@int\n");
-    printf("LT GF@temp LF@param2 int@0\n");
-    printf("JUMPIFEQ $substr_error GF@temp bool@true\n");
-    printf("LT GF@temp LF@param3 int@0\n");
-    printf("JUMPIFEQ $substr_error GF@temp bool@true\n");
-    printf("ADD LF@end LF@param2 LF@param3\n");
-    printf("MOVE LF@index LF@param2\n");
-    printf("LABEL $substr_loop\n");
-    printf("LT GF@temp LF@index LF@end\n");
-    printf("JUMPIFEQ $substr_end GF@temp bool@false\n");
-    printf("STRLEN GF@temp LF@param1\n");
-    printf("LT GF@temp LF@index GF@temp\n");
-    printf("JUMPIFEQ $substr_error GF@temp bool@false\n");
-    printf("STRI2INT LF@char LF@param1 LF@index\n");
-    printf("INT2CHAR LF@char LF@char\n");
-    printf("CONCAT LF@result LF@result LF@char\n");
-    printf("ADD LF@index LF@index int@1\n");
-    printf("JUMP $substr_loop\n");
-    printf("LABEL $substr_end\n");
-    printf("MOVE GF@return LF@result\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-    printf("LABEL $substr_error\n");
-    printf("MOVE GF@return nil@nil\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-
-    // Built-in: ifj.strcmp !!!!!
-    printf("\nLABEL $ifj_strcmp\n");
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");
-    printf("DEFVAR LF@result\n");
-    printf("DEFVAR LF@param1\n");
-    printf("DEFVAR LF@param2\n");
-    printf("POPS LF@param1\n"); 
-    printf("POPS LF@param2\n");
-    printf("GT LF@result LF@param1 LF@param2\n");
-    printf("JUMPIFEQ $strcmp_greater GF@return bool@true\n");
-    printf("LT GF@return LF@param1 LF@param2\n");
-    printf("JUMPIFEQ $strcmp_less GF@return bool@true\n");
-    printf("MOVE GF@return int@0\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-    printf("LABEL $strcmp_greater\n");
-    printf("MOVE GF@return int@1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
-    printf("LABEL $strcmp_less\n");
-    printf("MOVE GF@return int@-1\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("\nLABEL $ifj_ord\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n"); 
+    ir_emit("DEFVAR LF@param2\n"); 
+    ir_emit("DEFVAR LF@length\n"); 
+    ir_emit("DEFVAR LF@char\n");   
+    ir_emit("DEFVAR LF@result\n"); 
+    ir_emit("DEFVAR LF@type_check\n"); 
+    ir_emit("POPS LF@param2\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("TYPE LF@type_check LF@param1\n");
+    ir_emit("JUMPIFNEQ $ord_error LF@type_check string@string\n");
+    ir_emit("STRLEN LF@length LF@param1\n");
+    ir_emit("LT GF@temp LF@param2 int@0\n");
+    ir_emit("JUMPIFEQ $ord_error GF@temp bool@true\n");
+    ir_emit("LT GF@temp LF@param2 LF@length\n");
+    ir_emit("JUMPIFEQ $ord_inbounds GF@temp bool@true\n");
+    ir_emit("LABEL $ord_error\n");
+    ir_emit("MOVE GF@return int@0\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+    ir_emit("LABEL $ord_inbounds\n");
+    ir_emit("STRI2INT LF@result LF@param1 LF@param2\n");
+    ir_emit("MOVE GF@return LF@result\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+
+    // Built-in: ifj.substring, null if the indices are outside the string or reversed
+    ir_emit("\nLABEL $ifj_substring\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("DEFVAR LF@param2\n");
+    ir_emit("DEFVAR LF@param3\n");
+    ir_emit("DEFVAR LF@result\n");
+    ir_emit("DEFVAR LF@char\n");
+    ir_emit("DEFVAR LF@index\n");
+    ir_emit("DEFVAR LF@length\n");
+    ir_emit("MOVE LF@result string@\n");
+    ir_emit("POPS LF@param3\n");
+    ir_emit("POPS LF@param2\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("STRLEN LF@length LF@param1\n");
+    ir_emit("LT GF@temp LF@param2 int@0\n");
+    ir_emit("JUMPIFEQ $substr_error GF@temp bool@true\n");
+    ir_emit("LT GF@temp LF@param3 int@0\n");
+    ir_emit("JUMPIFEQ $substr_error GF@temp bool@true\n");
+    ir_emit("GT GF@temp LF@param2 LF@param3\n");
+    ir_emit("JUMPIFEQ $substr_error GF@temp bool@true\n");
+    ir_emit("LT GF@temp LF@param2 LF@length\n");
+    ir_emit("JUMPIFEQ $substr_error GF@temp bool@false\n");
+    ir_emit("GT GF@temp LF@param3 LF@length\n");
+    ir_emit("JUMPIFEQ $substr_error GF@temp bool@true\n");
+    ir_emit("MOVE LF@index LF@param2\n");
+    ir_emit("LABEL $substr_loop\n");
+    ir_emit("JUMPIFEQ $substr_end LF@index LF@param3\n");
+    ir_emit("GETCHAR LF@char LF@param1 LF@index\n");
+    ir_emit("CONCAT LF@result LF@result LF@char\n");
+    ir_emit("ADD LF@index LF@index int@1\n");
+    ir_emit("JUMP $substr_loop\n");
+    ir_emit("LABEL $substr_end\n");
+    ir_emit("MOVE GF@return LF@result\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+    ir_emit("LABEL $substr_error\n");
+    ir_emit("MOVE GF@return nil@nil\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+
+    // Built-in: ifj.strcmp
+    ir_emit("\nLABEL $ifj_strcmp\n");
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");
+    ir_emit("DEFVAR LF@result\n");
+    ir_emit("DEFVAR LF@param1\n");
+    ir_emit("DEFVAR LF@param2\n");
+    ir_emit("POPS LF@param2\n");
+    ir_emit("POPS LF@param1\n");
+    ir_emit("GT LF@result LF@param1 LF@param2\n");
+    ir_emit("JUMPIFEQ $strcmp_greater LF@result bool@true\n");
+    ir_emit("LT GF@return LF@param1 LF@param2\n");
+    ir_emit("JUMPIFEQ $strcmp_less GF@return bool@true\n");
+    ir_emit("MOVE GF@return int@0\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+    ir_emit("LABEL $strcmp_greater\n");
+    ir_emit("MOVE GF@return int@1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
+    ir_emit("LABEL $strcmp_less\n");
+    ir_emit("MOVE GF@return int@-1\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 }
 
 /**
@@ -270,13 +479,13 @@ void gen_builtin_functions() {
  */
 void gen_arithmetic(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2) {
     if (strcmp(operator, "+") == 0) {
-        printf("ADD LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("ADD LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "-") == 0) {
-        printf("SUB LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("SUB LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "*") == 0) {
-        printf("MUL LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("MUL LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "/") == 0) {
-        printf("DIV LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("DIV LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else {
         fprintf(stderr, "Unsupported arithmetic operator: %s\n", operator);
         exit(EXIT_FAILURE);
@@ -292,20 +501,20 @@ void gen_arithmetic(const char *operator, dstring_t *dest, dstring_t *op1, dstri
  */
 void gen_relational(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2) {
     if (strcmp(operator, "==") == 0) {
-        printf("EQ LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("EQ LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "!=") == 0) {
-        printf("EQ LF@temp LF@%s LF@%s\n", op1->data, op2->data);
-        printf("NOT LF@%s LF@temp\n", dest->data);
+        ir_emit("EQ LF@temp LF@%s LF@%s\n", op1->data, op2->data);
+        ir_emit("NOT LF@%s LF@temp\n", dest->data);
     } else if (strcmp(operator, "<") == 0) {
-        printf("LT LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("LT LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, ">") == 0) {
-        printf("GT LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("GT LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "<=") == 0) {
-        printf("GT LF@temp LF@%s LF@%s\n", op1->data, op2->data);
-        printf("NOT LF@%s LF@temp\n", dest->data);
+        ir_emit("GT LF@temp LF@%s LF@%s\n", op1->data, op2->data);
+        ir_emit("NOT LF@%s LF@temp\n", dest->data);
     } else if (strcmp(operator, ">=") == 0) {
-        printf("LT LF@temp LF@%s LF@%s\n", op1->data, op2->data);
-        printf("NOT LF@%s LF@temp\n", dest->data);
+        ir_emit("LT LF@temp LF@%s LF@%s\n", op1->data, op2->data);
+        ir_emit("NOT LF@%s LF@temp\n", dest->data);
     } else {
         fprintf(stderr, "Unsupported relational operator: %s\n", operator);
         exit(EXIT_FAILURE);
@@ -321,36 +530,139 @@ void gen_relational(const char *operator, dstring_t *dest, dstring_t *op1, dstri
  */
 void gen_logical(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2) {
     if (strcmp(operator, "AND") == 0) {
-        printf("AND LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("AND LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "OR") == 0) {
-        printf("OR LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
+        ir_emit("OR LF@%s LF@%s LF@%s\n", dest->data, op1->data, op2->data);
     } else if (strcmp(operator, "NOT") == 0) {
-        printf("NOT LF@%s LF@%s\n", dest->data, op1->data);
+        ir_emit("NOT LF@%s LF@%s\n", dest->data, op1->data);
     } else {
         fprintf(stderr, "Unsupported logical operator: %s\n", operator);
         exit(EXIT_FAILURE);
     }
 }
 
+/**
+ * @brief Checks whether a label ends the value tail of a short-circuit operator.
+ * @param label Label operand.
+ * @return True for labels created by gen_short_circuit as the join point.
+ */
+static bool gen_is_short_circuit_end(const char *label) {
+    return strncmp(label, "$and_end_", 9) == 0 || strncmp(label, "$or_end_", 8) == 0;
+}
+
+/**
+ * @brief Threads the jumps of short-circuit operators into a consuming branch.
+ * @details A short-circuit operator materializes its result in a tail of the form
+ *          JUMP $end; LABEL $short; PUSHS bool@K; LABEL $end. When the result is
+ *          only compared against a constant by the consumer, the tail is dropped
+ *          and the short path jumps straight to the consumer's target, or past
+ *          the consumer if it would not branch on K. Nested operators whose tails
+ *          become adjacent to the consumer are threaded as well.
+ * @param push The PUSHS bool@V instruction of the consumer, followed by its JUMPIFEQS.
+ */
+static void gen_thread_short_circuit(ir_instr_t *push) {
+    ir_list_t *code = ir_current();
+    ir_instr_t *branch = push->next;
+    bool value = strcmp(push->operands[0], "bool@true") == 0;
+
+    while (true) {
+        ir_instr_t *end = push->prev;
+        ir_instr_t *constant = end ? end->prev : NULL;
+        ir_instr_t *short_label = constant ? constant->prev : NULL;
+        ir_instr_t *skip = short_label ? short_label->prev : NULL;
+        if (!ir_is(end, "LABEL") || !ir_is(constant, "PUSHS") || !ir_is(short_label, "LABEL") ||
+            !ir_is(skip, "JUMP") || !gen_is_short_circuit_end(end->operands[0]) ||
+            strcmp(skip->operands[0], end->operands[0]) != 0) {
+            return;
+        }
+
+        bool constant_value = strcmp(constant->operands[0], "bool@true") == 0;
+        ir_remove(code, skip);
+        ir_remove(code, constant);
+        ir_remove(code, end);
+
+        if (constant_value == value) {
+            // The short path always takes the branch, jump to its target directly
+            for (ir_instr_t *instr = short_label->prev; instr; instr = instr->prev) {
+                if (strncmp(instr->opcode, "JUMP", 4) == 0 &&
+                    strcmp(instr->operands[0], short_label->operands[0]) == 0) {
+                    ir_set_operand(instr, 0, branch->operands[0]);
+                }
+            }
+        } else {
+            // The short path never takes the branch, continue right after it
+            ir_insert_after(code, branch, ir_instr_create("LABEL", 1, short_label->operands[0]));
+        }
+        ir_remove(code, short_label);
+    }
+}
+
+/**
+ * @brief Jumps to a label if the boolean on top of the data stack has the given value.
+ * @param value Value that takes the jump.
+ * @param label Target label.
+ */
+static void gen_jump_if_bool(bool value, const char *label) {
+    ir_emit("PUSHS bool@%s\n", value ? "true" : "false");
+    ir_emit("JUMPIFEQS %s\n", label);
+    if (ir_current() != NULL) {
+        gen_thread_short_circuit(ir_last()->prev);
+    }
+}
+
+/**
+ * @brief Generates a short-circuit logical AND or OR of two stack operands.
+ * @details The right operand is only evaluated when the left one does not decide
+ *          the result. Its code has already been emitted, so the test of the left
+ *          operand is inserted between the two.
+ * @param is_and True for AND, false for OR.
+ * @param lhs_end Last instruction of the left operand.
+ */
+void gen_short_circuit(bool is_and, ir_instr_t *lhs_end) {
+    ir_list_t *code = ir_current();
+    if (code == NULL) {
+        ir_emit(is_and ? "ANDS\n" : "ORS\n");
+        return;
+    }
+
+    int label = label_counter++;
+    const char *value = is_and ? "bool@false" : "bool@true";
+    char short_label[64];
+    char end_label[64];
+    snprintf(short_label, sizeof(short_label), is_and ? "$and_false_%d" : "$or_true_%d", label);
+    snprintf(end_label, sizeof(end_label), is_and ? "$and_end_%d" : "$or_end_%d", label);
+
+    ir_instr_t *push = ir_instr_create("PUSHS", 1, value);
+    ir_insert_after(code, lhs_end, push);
+    ir_insert_after(code, push, ir_instr_create("JUMPIFEQS", 1, short_label));
+    gen_thread_short_circuit(push);
+
+    ir_emit("JUMP %s\n", end_label);
+    ir_emit("LABEL %s\n", short_label);
+    ir_emit("PUSHS %s\n", value);
+    ir_emit("LABEL %s\n", end_label);
+}
+
 /**
  * @brief Generates an assignment operation.
  * @param dest Destination variable.
  * @param source Source variable or value.
  */
 void gen_assignment(dstring_t *dest, dstring_t *source) {
-    printf("MOVE LF@%s LF@%s\n", dest->data, source->data);
+    ir_emit("MOVE LF@%s LF@%s\n", dest->data, source->data);
 }
 
 /**
  * @brief Starts an if block.
- * @details Sets up the condition check and jumps to the else block if false.
+ * @details Jumps to the else block if the condition on the data stack is false.
  */
 void gen_if_start() {
     int label = label_counter++;
-    printf("DEFVAR LF@if_cond_%d\n", label); 
-    printf("POPS LF@if_cond_%d\n", label);  
-    printf("JUMPIFEQ $if_else_%d LF@if_cond_%d bool@false\n", label, label);
+    char else_label[64];
+    snprintf(else_label, sizeof(else_label), "$if_else_%d", label);
+    gen_jump_if_bool(false, else_label);
     gen_stack_push(if_stack, label);  
+    gen_count_block("then");
 }
 
 /**
@@ -363,8 +675,9 @@ void gen_if_else() {
         exit(EXIT_FAILURE);
     }
     int current_label = gen_stack_top(if_stack);
-    printf("JUMP $if_end_%d\n", current_label);
-    printf("LABEL $if_else_%d\n", current_label);
+    ir_emit("JUMP $if_end_%d\n", current_label);
+    ir_emit("LABEL $if_else_%d\n", current_label);
+    gen_count_block("else");
 }
 
 /**
@@ -377,7 +690,27 @@ void gen_if_end() {
         exit(EXIT_FAILURE);
     }
     int current_label = gen_stack_pop(if_stack);
-    printf("LABEL $if_end_%d\n", current_label);
+    ir_emit("LABEL $if_end_%d\n", current_label);
+    gen_count_block("join");
+}
+
+/**
+ * @brief Takes over a nullable condition consisting of a single local variable.
+ * @details If the condition just pushed the variable, the push is dropped so the
+ *          variable can be tested directly instead of a popped copy.
+ * @param name Buffer for the name of the variable.
+ * @param size Size of the buffer.
+ * @return True if the condition was taken over.
+ */
+static bool gen_take_nullable_variable(char *name, size_t size) {
+    ir_instr_t *last = ir_last();
+    if (!ir_is(last, "PUSHS") || strncmp(last->operands[0], "LF@", 3) != 0 ||
+        strlen(last->operands[0]) >= size) {
+        return false;
+    }
+    strcpy(name, last->operands[0]);
+    ir_remove(ir_current(), last);
+    return true;
 }
 
 /**
@@ -386,12 +719,17 @@ void gen_if_end() {
  */
 void gen_if_nullable_start(dstring_t *non_null_id) {
     int current_label = label_counter++;
-    printf("DEFVAR LF@nullable_check_%d\n", current_label); 
-    printf("POPS LF@nullable_check_%d\n", current_label);  
-    printf("JUMPIFEQ $if_nullable_else_%d LF@nullable_check_%d nil@nil\n", current_label, current_label);
-    printf("DEFVAR LF@%s\n", non_null_id->data);
-    printf("MOVE LF@%s LF@nullable_check_%d\n", dstring_get(non_null_id), current_label); 
+    char checked[256];
+    if (!gen_take_nullable_variable(checked, sizeof(checked))) {
+        snprintf(checked, sizeof(checked), "LF@nullable_check_%d", current_label);
+        ir_emit("DEFVAR %s\n", checked); 
+        ir_emit("POPS %s\n", checked);  
+    }
+    ir_emit("JUMPIFEQ $if_nullable_else_%d %s nil@nil\n", current_label, checked);
+    ir_emit("DEFVAR LF@%s\n", non_null_id->data);
+    ir_emit("MOVE LF@%s %s\n", dstring_get(non_null_id), checked); 
     gen_stack_push(if_stack, current_label);
+    gen_count_block("then");
 }
 
 /**
@@ -404,9 +742,10 @@ void gen_if_nullable_else() {
         exit(EXIT_FAILURE);
     }
     int label = gen_stack_pop(if_stack);
-    printf("JUMP $if_nullable_end_%d\n", label);
-    printf("LABEL $if_nullable_else_%d\n", label);
+    ir_emit("JUMP $if_nullable_end_%d\n", label);
+    ir_emit("LABEL $if_nullable_else_%d\n", label);
     gen_stack_push(if_stack, label);
+    gen_count_block("else");
 }
 
 /**
@@ -419,7 +758,8 @@ void gen_if_nullable_end() {
         exit(EXIT_FAILURE);
     }
     int label = gen_stack_pop(if_stack);
-    printf("LABEL $if_nullable_end_%d\n", label);
+    ir_emit("LABEL $if_nullable_end_%d\n", label);
+    gen_count_block("join");
 }
 
 /**
@@ -428,8 +768,7 @@ void gen_if_nullable_end() {
  */
 void gen_while_start() {
     int label = label_counter++;
-    printf("DEFVAR LF@while_cond_%d\n", label);
-    printf("LABEL $while_start_%d\n", label);
+    ir_emit("LABEL $while_start_%d\n", label);
     gen_stack_push(while_stack, label);
 }
 
@@ -443,13 +782,296 @@ void gen_while_cond() {
         exit(EXIT_FAILURE);
     }
     int current_label = gen_stack_top(while_stack); 
-    printf("POPS LF@while_cond_%d\n", current_label);  
-    printf("JUMPIFEQ $while_end_%d LF@while_cond_%d bool@false\n", current_label, current_label);
+    char end_label[64];
+    snprintf(end_label, sizeof(end_label), "$while_end_%d", current_label);
+    gen_jump_if_bool(false, end_label);
+    gen_count_block("loop");
+}
+
+#define WHILE_ROTATE_MAX 64 // Largest loop condition that is repeated at the bottom
+
+/**
+ * @brief Rotates a loop so each iteration takes a single conditional jump.
+ * @details The condition at the top becomes the entry guard. A copy of it is
+ *          appended after the body with its final branch inverted to jump back
+ *          to a new $while_body_N label placed after the guard. Labels inside
+ *          the copy get a "$r" suffix, and labels that followed the guard's
+ *          branch, where short-circuit operators continue into the body, are
+ *          replaced by the body label. The body never jumps to the end label, so
+ *          the last jump to it is the final branch of the condition.
+ * @param label Number of the loop.
+ * @param end_label Label after the loop, targeted by the condition.
+ * @return False if the loop was not rotated and still needs its back jump.
+ */
+static bool gen_rotate_loop(int label, const char *end_label) {
+    ir_list_t *code = ir_current();
+    if (code == NULL) return false;
+
+    char start_label[64];
+    snprintf(start_label, sizeof(start_label), "$while_start_%d", label);
+    ir_instr_t *start = NULL, *branch = NULL;
+    int size = 0;
+    for (ir_instr_t *instr = ir_last(); instr; instr = instr->prev) {
+        if (ir_is(instr, "LABEL") && strcmp(instr->operands[0], start_label) == 0) {
+            start = instr;
+            break;
+        }
+        if (!branch && strncmp(instr->opcode, "JUMPIF", 6) == 0 && strcmp(instr->operands[0], end_label) == 0) {
+            branch = instr;
+        }
+        if (branch) size++;
+    }
+    if (!start || !branch || size > WHILE_ROTATE_MAX) return false;
+
+    char body_label[64];
+    snprintf(body_label, sizeof(body_label), "$while_body_%d", label);
+    ir_insert_after(code, branch, ir_instr_create("LABEL", 1, body_label));
+
+    for (ir_instr_t *instr = start->next; instr != branch->next; instr = instr->next) {
+        ir_instr_t *copy = ir_instr_copy(instr);
+        const char *target = instr->operand_count > 0 ? instr->operands[0] : "";
+        char renamed[80];
+        snprintf(renamed, sizeof(renamed), "%.64s$r", target);
+
+        if (instr == branch) {
+            ir_set_opcode(copy, strncmp(instr->opcode, "JUMPIFEQ", 8) == 0 ?
+                                (ir_is(instr, "JUMPIFEQS") ? "JUMPIFNEQS" : "JUMPIFNEQ") :
+                                (ir_is(instr, "JUMPIFNEQS") ? "JUMPIFEQS" : "JUMPIFEQ"));
+            ir_set_operand(copy, 0, body_label);
+        } else if (ir_is(instr, "LABEL")) {
+            ir_set_operand(copy, 0, renamed);
+        } else if (strncmp(instr->opcode, "JUMP", 4) == 0) {
+            // Targets are labels of the condition, labels entering the body or the end label
+            const char *mapped = target;
+            for (ir_instr_t *other = start->next; other != branch; other = other->next) {
+                if (ir_is(other, "LABEL") && strcmp(other->operands[0], target) == 0) mapped = renamed;
+            }
+            for (ir_instr_t *other = branch->next->next; other && ir_is(other, "LABEL"); other = other->next) {
+                if (strcmp(other->operands[0], target) == 0) mapped = body_label;
+            }
+            ir_set_operand(copy, 0, mapped);
+        }
+        ir_append(code, copy);
+    }
+    return true;
+}
+
+#define UNROLL_BUDGET 192 // Most instructions an unrolled loop may add to the function
+
+/**
+ * @brief Reads an integer literal operand.
+ * @param operand Operand such as "int@-3".
+ * @param value Receives the value.
+ * @return True if the operand is an i32 literal.
+ */
+static bool gen_int_literal(const char *operand, long long *value) {
+    if (strncmp(operand, "int@", 4) != 0) return false;
+    char *end;
+    *value = strtoll(operand + 4, &end, 10);
+    return end != operand + 4 && *end == '\0' && *value >= INT32_MIN && *value <= INT32_MAX;
+}
+
+/**
+ * @brief Checks whether an instruction is a stack push of the given operand.
+ */
+static bool gen_is_push(const ir_instr_t *instr, const char *operand) {
+    return instr && ir_is(instr, "PUSHS") && strcmp(instr->operands[0], operand) == 0;
+}
+
+/**
+ * @brief Copies a range of instructions, giving the labels defined in it a suffix.
+ * @param first First instruction of the range.
+ * @param last Last instruction of the range.
+ * @param suffix Suffix of the copied labels, e.g. "$u2".
+ * @param pos Instruction the copy is inserted before, or NULL to append it.
+ */
+static void gen_copy_range(ir_instr_t *first, ir_instr_t *last, const char *suffix, ir_instr_t *pos) {
+    ir_list_t *code = ir_current();
+    for (ir_instr_t *instr = first; instr != last->next; instr = instr->next) {
+        ir_instr_t *copy = ir_instr_copy(instr);
+        if (ir_is(instr, "LABEL") || strncmp(instr->opcode, "JUMP", 4) == 0) {
+            bool local = false;
+            for (ir_instr_t *other = first; other != last->next && !local; other = other->next) {
+                local = ir_is(other, "LABEL") && strcmp(other->operands[0], instr->operands[0]) == 0;
+            }
+            if (local) {
+                char renamed[96];
+                snprintf(renamed, sizeof(renamed), "%.64s%s", instr->operands[0], suffix);
+                ir_set_operand(copy, 0, renamed);
+            }
+        }
+        if (pos) {
+            ir_insert_before(code, pos, copy);
+        } else {
+            ir_append(code, copy);
+        }
+    }
+}
+
+/**
+ * @brief Emits the test "var < bound" that jumps to a label.
+ * @param var Induction variable.
+ * @param bound Exclusive upper bound.
+ * @param opcode JUMPIFEQS to leave when the test fails, JUMPIFNEQS to jump while it holds.
+ * @param label Target label.
+ * @param pos Instruction the test is inserted before.
+ */
+static void gen_insert_bound_test(const char *var, long long bound, const char *opcode, const char *label, ir_instr_t *pos) {
+    ir_list_t *code = ir_current();
+    char literal[32];
+    snprintf(literal, sizeof(literal), "int@%lld", bound);
+    ir_insert_before(code, pos, ir_instr_create("PUSHS", 1, var));
+    ir_insert_before(code, pos, ir_instr_create("PUSHS", 1, literal));
+    ir_insert_before(code, pos, ir_instr_create("LTS", 0));
+    ir_insert_before(code, pos, ir_instr_create("PUSHS", 1, "bool@false"));
+    ir_insert_before(code, pos, ir_instr_create(opcode, 1, label));
+}
+
+/**
+ * @brief Unrolls a counted loop.
+ * @details Recognizes loops of the form "while (i < K) { ...; i = i + S; }"
+ *          with a constant bound K, a positive constant step S and no other
+ *          write of i in the body; "i <= K" and "K > i" are accepted too. When
+ *          i is set to a constant right before the loop, all iterations fit in
+ *          UNROLL_BUDGET and the body has no jump out of the loop, the loop is
+ *          replaced by that many copies of the body without the step, each
+ *          reading i as a literal, and one store of the final value of i.
+ *          Otherwise a loop running unroll_factor copies of the body per test
+ *          while i < K - (unroll_factor - 1) * S is placed in front of the
+ *          original loop, which then runs the remaining iterations.
+ * @param label Number of the loop.
+ * @param end_label Label after the loop, targeted by the condition.
+ * @return True if the loop was fully unrolled and needs no back jump.
+ */
+static bool gen_unroll_loop(int label, const char *end_label) {
+    ir_list_t *code = ir_current();
+    if (code == NULL) return false;
+
+    char start_label[64];
+    snprintf(start_label, sizeof(start_label), "$while_start_%d", label);
+    ir_instr_t *start = ir_last();
+    int size = 0;
+    while (start && !(ir_is(start, "LABEL") && strcmp(start->operands[0], start_label) == 0)) {
+        start = start->prev;
+        size++;
+    }
+    if (!start) return false;
+
+    // Condition: i < K, i <= K or K > i, followed by the exit branch
+    ir_instr_t *first = start->next, *second = first ? first->next : NULL;
+    ir_instr_t *compare = second ? second->next : NULL;
+    if (!first || !second || !compare || !ir_is(first, "PUSHS") || !ir_is(second, "PUSHS")) return false;
+    const char *var = NULL;
+    long long bound;
+    ir_instr_t *branch_push = compare->next;
+    if (strncmp(first->operands[0], "LF@", 3) == 0 && gen_int_literal(second->operands[0], &bound)) {
+        var = first->operands[0];
+        if (ir_is(compare, "GTS") && branch_push && ir_is(branch_push, "NOTS")) {
+            bound++;
+            branch_push = branch_push->next;
+        } else if (!ir_is(compare, "LTS")) {
+            return false;
+        }
+    } else if (strncmp(second->operands[0], "LF@", 3) == 0 && gen_int_literal(first->operands[0], &bound) && ir_is(compare, "GTS")) {
+        var = second->operands[0];
+    } else {
+        return false;
+    }
+    ir_instr_t *branch = branch_push ? branch_push->next : NULL;
+    if (!gen_is_push(branch_push, "bool@false") || !branch || !ir_is(branch, "JUMPIFEQS") ||
+        strcmp(branch->operands[0], end_label) != 0 || branch == ir_last()) {
+        return false;
+    }
+
+    // Body ends with i = i + S and does not write i elsewhere
+    ir_instr_t *last = ir_last(), *add = last->prev;
+    ir_instr_t *step_push = add ? add->prev : NULL, *var_push = step_push ? step_push->prev : NULL;
+    long long step;
+    if (!ir_is(last, "POPS") || strcmp(last->operands[0], var) != 0 || !add || !ir_is(add, "ADDS") ||
+        !step_push || !ir_is(step_push, "PUSHS") || !gen_int_literal(step_push->operands[0], &step) || step <= 0 ||
+        !gen_is_push(var_push, var)) {
+        return false;
+    }
+    int body_size = 0;
+    bool exits = false;     // The body leaves the loop, e.g. the right operand of && in the condition
+    for (ir_instr_t *instr = branch->next; instr != last; instr = instr->next) {
+        if (instr->operand_count > 0 && strcmp(instr->operands[0], var) == 0 &&
+            !ir_is(instr, "PUSHS") && !ir_is(instr, "WRITE")) {
+            return false;
+        }
+        if (strncmp(instr->opcode, "JUMP", 4) == 0) {
+            bool local = false;
+            for (ir_instr_t *other = branch->next; other != last && !local; other = other->next) {
+                local = ir_is(other, "LABEL") && strcmp(other->operands[0], instr->operands[0]) == 0;
+            }
+            exits |= !local;
+        }
+        body_size++;
+    }
+    body_size++;
+
+    // Full unrolling needs the value of i on entry, and stores i only after the last copy
+    ir_instr_t *init = start->prev, *init_push = init ? init->prev : NULL;
+    long long initial;
+    if (!exits && init && ir_is(init, "POPS") && strcmp(init->operands[0], var) == 0 && init_push &&
+        ir_is(init_push, "PUSHS") && gen_int_literal(init_push->operands[0], &initial) && initial < bound) {
+        long long trips = (bound - initial + step - 1) / step;
+        if (trips * body_size <= UNROLL_BUDGET) {
+            // Each copy reads i as a literal, a single store after the copies leaves i as the loop would
+            char value[32];
+            for (long long trip = 0; trip < trips; trip++) {
+                char suffix[32];
+                snprintf(suffix, sizeof(suffix), "$u%lld", trip);
+                snprintf(value, sizeof(value), "int@%lld", initial + trip * step);
+                ir_instr_t *copied = ir_last();
+                if (branch->next != var_push) {
+                    gen_copy_range(branch->next, var_push->prev, suffix, NULL);
+                }
+                for (ir_instr_t *instr = copied->next; instr; instr = instr->next) {
+                    for (int i = 0; i < instr->operand_count; i++) {
+                        if (strcmp(instr->operands[i], var) == 0) ir_set_operand(instr, i, value);
+                    }
+                }
+            }
+            snprintf(value, sizeof(value), "int@%lld", initial + trips * step);
+            ir_emit("PUSHS %s\n", value);
+            ir_emit("POPS %s\n", var);
+            ir_instr_t *instr = start;
+            while (instr != last) {
+                ir_instr_t *next = instr->next;
+                ir_remove(code, instr);
+                instr = next;
+            }
+            ir_remove(code, last);
+            return true;
+        }
+    }
+
+    long long unrolled_bound = bound - (long long)(unroll_factor - 1) * step;
+    if (unroll_factor < 2 || (long long)unroll_factor * body_size + 12 > UNROLL_BUDGET ||
+        unrolled_bound < INT32_MIN) {
+        return false;
+    }
+    char unrolled_label[64], rest_label[64];
+    snprintf(unrolled_label, sizeof(unrolled_label), "$while_unrolled_%d", label);
+    snprintf(rest_label, sizeof(rest_label), "$while_rest_%d", label);
+    gen_insert_bound_test(var, unrolled_bound, "JUMPIFEQS", rest_label, start);
+    ir_insert_before(code, start, ir_instr_create("LABEL", 1, unrolled_label));
+    for (int copy = 0; copy < unroll_factor; copy++) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "$u%d", copy);
+        gen_copy_range(branch->next, last, suffix, start);
+    }
+    gen_insert_bound_test(var, unrolled_bound, "JUMPIFNEQS", unrolled_label, start);
+    ir_insert_before(code, start, ir_instr_create("LABEL", 1, rest_label));
+    return false;
 }
 
 /**
  * @brief Ends a while loop.
- * @details Outputs the end label and jumps back to the start label.
+ * @details Unrolls a counted loop, then repeats the condition at the bottom
+ *          of the loop, or jumps back to the start label if it cannot, and
+ *          outputs the end label.
  */
 void gen_while_end() {
     if (gen_stack_is_empty(while_stack)) {
@@ -457,8 +1079,30 @@ void gen_while_end() {
         exit(EXIT_FAILURE);
     }
     int current_label = gen_stack_pop(while_stack);
-    printf("JUMP $while_start_%d\n", current_label);
-    printf("LABEL $while_end_%d\n", current_label);
+    char end_label[64];
+    snprintf(end_label, sizeof(end_label), "$while_end_%d", current_label);
+    if (!gen_unroll_loop(current_label, end_label) && !gen_rotate_loop(current_label, end_label)) {
+        ir_emit("JUMP $while_start_%d\n", current_label);
+    }
+    ir_emit("LABEL %s\n", end_label);
+    gen_count_block("exit");
+}
+
+/**
+ * @brief Defines a loop variable in front of the loop so it is not redefined on each iteration.
+ * @param name Full name of the variable, e.g. "LF@while_cond_3".
+ * @param label Number of the loop.
+ */
+static void gen_defvar_before_label(const char *name, int label) {
+    char start_label[64];
+    snprintf(start_label, sizeof(start_label), "$while_start_%d", label);
+    for (ir_instr_t *instr = ir_last(); instr; instr = instr->prev) {
+        if (ir_is(instr, "LABEL") && strcmp(instr->operands[0], start_label) == 0) {
+            ir_insert_before(ir_current(), instr, ir_instr_create("DEFVAR", 1, name));
+            return;
+        }
+    }
+    ir_emit("DEFVAR %s\n", name);
 }
 
 /**
@@ -467,19 +1111,23 @@ void gen_while_end() {
  */
 void gen_while_nullable_cond(dstring_t *non_null_id) {
     int current_label = gen_stack_pop(while_stack);
-    // printf("DEFVAR LF@nullable_check\n"); 
-    // printf("LABEL $while_nullable_start_%d\n", current_label);                     
-    //printf("POPS LF@nullable_check\n");  
-    printf("POPS LF@while_cond_%d\n", current_label);                     
-    printf("JUMPIFEQ $while_nullable_end_%d LF@while_cond_%d nil@nil\n", current_label, current_label);
-    printf("DEFVAR LF@%s\n", non_null_id->data);
-    printf("MOVE LF@%s LF@while_cond_%d\n", dstring_get(non_null_id), current_label); 
+    char checked[256];
+    if (!gen_take_nullable_variable(checked, sizeof(checked))) {
+        snprintf(checked, sizeof(checked), "LF@while_cond_%d", current_label);
+        gen_defvar_before_label(checked, current_label);
+        ir_emit("POPS %s\n", checked);                     
+    }
+    ir_emit("JUMPIFEQ $while_nullable_end_%d %s nil@nil\n", current_label, checked);
+    ir_emit("DEFVAR LF@%s\n", non_null_id->data);
+    ir_emit("MOVE LF@%s %s\n", dstring_get(non_null_id), checked); 
     gen_stack_push(while_stack, current_label);
+    gen_count_block("loop");
 }
 
 /**
  * @brief Ends a nullable while loop.
- * @details Outputs the end label and jumps back to the start label.
+ * @details Repeats the condition at the bottom of the loop, or jumps back to
+ *          the start label if it cannot, and outputs the end label.
  */
 void gen_while_nullable_end() {
     if (gen_stack_is_empty(while_stack)) {
@@ -487,8 +1135,13 @@ void gen_while_nullable_end() {
         exit(EXIT_FAILURE);
     }
     int label = gen_stack_pop(while_stack);
-    printf("JUMP $while_start_%d\n", label);
-    printf("LABEL $while_nullable_end_%d\n", label);
+    char end_label[64];
+    snprintf(end_label, sizeof(end_label), "$while_nullable_end_%d", label);
+    if (!gen_rotate_loop(label, end_label)) {
+        ir_emit("JUMP $while_start_%d\n", label);
+    }
+    ir_emit("LABEL %s\n", end_label);
+    gen_count_block("exit");
 }
 
 /**
@@ -496,9 +1149,13 @@ void gen_while_nullable_end() {
  * @param func_name Name of the function.
  */
 void gen_func_start(dstring_t *func_name) {
-    printf("\nLABEL $%s\n", func_name->data); 
-    printf("CREATEFRAME\n");
-    printf("PUSHFRAME\n");            
+    ir_begin(ir_list_create());
+    first_param_pop = NULL;
+    ir_emit("\nLABEL $%s\n", func_name->data); 
+    ir_emit("CREATEFRAME\n");
+    ir_emit("PUSHFRAME\n");            
+    snprintf(current_function_name, sizeof(current_function_name), "%s", func_name->data);
+    gen_count_block("function");
 }
 
 /**
@@ -507,8 +1164,77 @@ void gen_func_start(dstring_t *func_name) {
  */
 
 void gen_func_end() {
-    printf("POPFRAME\n");              
-    printf("RETURN\n");
+    ir_emit("POPFRAME\n");              
+    ir_emit("RETURN\n");
+}
+
+/**
+ * @brief Finishes the code of a function definition.
+ * @details The code is kept until the whole program is parsed, so the optimizer
+ *          can look into functions defined later.
+ */
+void gen_func_finish() {
+    ir_list_t *code = ir_end();
+    if (code == NULL) return;
+    if (function_count == function_capacity) {
+        function_capacity = function_capacity ? function_capacity * 2 : 16;
+        ir_list_t **grown = realloc(functions, function_capacity * sizeof(ir_list_t *));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for function code.\n");
+            exit(EXIT_FAILURE);
+        }
+        functions = grown;
+    }
+    functions[function_count++] = code;
+}
+
+/**
+ * @brief Optimizes and prints the header and the code of all function definitions.
+ * @details With gen_set_run() the program is run in the virtual machine instead,
+ *          and gen_set_emit() selects C source instead of IFJcode24.
+ */
+void gen_program_finish() {
+    optimize_program(header, &functions, &function_count);
+    gen_finish_counters();
+    if (header && string_pool) {
+        long saved = opt_string_pool(functions, function_count, header, header_entry);
+        fprintf(stderr, "String pool: %ld bytes saved\n", saved);
+    }
+    bool print = !run_program && emit_target == EMIT_IFJCODE;
+    if (run_program) {
+        run_status = vm_run(header, functions, function_count, stdin, stdout);
+    } else if (emit_target == EMIT_C) {
+        emit_c(header, functions, function_count, stdout);
+    } else if (emit_target == EMIT_X86_64) {
+        emit_x86(header, functions, function_count, stdout);
+    }
+    if (header) {
+        if (print) {
+            ir_print(header, stdout);
+        }
+        ir_list_free(header);
+        header = NULL;
+        header_entry = NULL;
+    }
+    for (int i = 0; i < function_count; i++) {
+        ir_list_t *code = functions[i];
+        if (compact_names) {
+            opt_compact_names(code, name_map);
+        }
+        if (cfg_dump && ir_is(code->head, "LABEL")) {
+            cfg_t *cfg = cfg_build(code);
+            cfg_dump_dot(cfg, code->head->operands[0] + 1, cfg_dump);
+            cfg_free(cfg);
+        }
+        if (print) {
+            ir_print(code, stdout);
+        }
+        ir_list_free(code);
+    }
+    free(functions);
+    functions = NULL;
+    function_count = function_capacity = 0;
+    gen_free_counters();
 }
 
 /**
@@ -516,7 +1242,38 @@ void gen_func_end() {
  * @param var_name Name of the variable to define.
  */
 void gen_defvar(dstring_t *var_name) {
-    printf("DEFVAR LF@%s\n", var_name->data);
+    ir_emit("DEFVAR LF@%s\n", var_name->data);
+}
+
+/**
+ * @brief Declares a parameter of the current function and pops its argument.
+ * @details The caller pushes the arguments in order, so the last parameter is
+ *          popped first and the pops of later parameters go before earlier ones.
+ * @param param_name Name of the parameter.
+ * @param type Static type of the parameter.
+ */
+void gen_param(dstring_t *param_name, ir_type_t type) {
+    if (first_param_pop == NULL) {
+        gen_defvar(param_name);
+        ir_last()->type = type;
+        gen_pop_operand(param_name);
+        first_param_pop = ir_last();
+        return;
+    }
+    size_t size = strlen(param_name->data) + 4;
+    char *operand = malloc(size);
+    if (!operand) {
+        fprintf(stderr, "Error: Could not allocate memory for a parameter.\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(operand, size, "LF@%s", param_name->data);
+    ir_instr_t *defvar = ir_instr_create("DEFVAR", 1, operand);
+    defvar->type = type;
+    ir_insert_before(ir_current(), first_param_pop, defvar);
+    ir_instr_t *pop = ir_instr_create("POPS", 1, operand);
+    ir_insert_before(ir_current(), first_param_pop, pop);
+    first_param_pop = pop;
+    free(operand);
 }
 
 /**
@@ -525,33 +1282,33 @@ void gen_defvar(dstring_t *var_name) {
  */
 void gen_function_call(dstring_t *func_name) {
     if (dstring_compare_charstr(func_name, "ifj.string") == 0) {
-        printf("CALL $ifj_string\n");
+        ir_emit("CALL $ifj_string\n");
     } else if (dstring_compare_charstr(func_name, "ifj.write") == 0) {
-        printf("CALL $ifj_write\n");
+        ir_emit("CALL $ifj_write\n");
     } else if (dstring_compare_charstr(func_name, "ifj.readi32") == 0) {
-        printf("CALL $ifj_readi32\n");
+        ir_emit("CALL $ifj_readi32\n");
     } else if (dstring_compare_charstr(func_name, "ifj.readstr") == 0) {
-        printf("CALL $ifj_readstr\n");
+        ir_emit("CALL $ifj_readstr\n");
     } else if (dstring_compare_charstr(func_name, "ifj.readf64") == 0) {
-        printf("CALL $ifj_readf64\n");
+        ir_emit("CALL $ifj_readf64\n");
     } else if (dstring_compare_charstr(func_name, "ifj.i2f") == 0) {
-        printf("CALL $ifj_i2f\n");
+        ir_emit("CALL $ifj_i2f\n");
     } else if (dstring_compare_charstr(func_name, "ifj.f2i") == 0) {
-        printf("CALL $ifj_f2i\n");
+        ir_emit("CALL $ifj_f2i\n");
     } else if (dstring_compare_charstr(func_name, "ifj.concat") == 0) {
-        printf("CALL $ifj_concat\n");
+        ir_emit("CALL $ifj_concat\n");
     } else if (dstring_compare_charstr(func_name, "ifj.length") == 0) {
-        printf("CALL $ifj_length\n");
+        ir_emit("CALL $ifj_length\n");
     } else if (dstring_compare_charstr(func_name, "ifj.substring") == 0) {
-        printf("CALL $ifj_substring\n");
+        ir_emit("CALL $ifj_substring\n");
     } else if (dstring_compare_charstr(func_name, "ifj.strcmp") == 0) {
-        printf("CALL $ifj_strcmp\n");
+        ir_emit("CALL $ifj_strcmp\n");
     } else if (dstring_compare_charstr(func_name, "ifj.ord") == 0) {
-        printf("CALL $ifj_ord\n");
+        ir_emit("CALL $ifj_ord\n");
     } else if (dstring_compare_charstr(func_name, "ifj.chr") == 0) {
-        printf("CALL $ifj_chr\n");
+        ir_emit("CALL $ifj_chr\n");
     } else {
-        printf("CALL $%s\n", func_name->data);
+        ir_emit("CALL $%s\n", func_name->data);
     }
 }
 
@@ -560,7 +1317,7 @@ void gen_function_call(dstring_t *func_name) {
  * @param label_name Label to jump to.
  */
 void gen_jump(const char *label_name) {
-    printf("JUMP %s\n", label_name);
+    ir_emit("JUMP %s\n", label_name);
 }
 
 /**
@@ -570,7 +1327,7 @@ void gen_jump(const char *label_name) {
  * @param symb2 Second operand.
  */
 void gen_jumpifeq(const char *label_name, dstring_t *symb1, dstring_t *symb2) {
-    printf("JUMPIFEQ %s %s %s\n", label_name, symb1->data, symb2->data);
+    ir_emit("JUMPIFEQ %s %s %s\n", label_name, symb1->data, symb2->data);
 }
 
 /**
@@ -580,7 +1337,7 @@ void gen_jumpifeq(const char *label_name, dstring_t *symb1, dstring_t *symb2) {
  * @param symb2 Second operand.
  */
 void gen_jumpifneq(const char *label_name, dstring_t *symb1, dstring_t *symb2) {
-    printf("JUMPIFNEQ %s %s %s\n", label_name, symb1->data, symb2->data);
+    ir_emit("JUMPIFNEQ %s %s %s\n", label_name, symb1->data, symb2->data);
 }
 
 /**
@@ -588,7 +1345,7 @@ void gen_jumpifneq(const char *label_name, dstring_t *symb1, dstring_t *symb2) {
  * @param symbol Symbol to push.
  */
 void gen_push_operand(dstring_t *symbol) {
-    printf("PUSHS LF@%s\n", symbol->data);
+    ir_emit("PUSHS LF@%s\n", symbol->data);
 }
 
 /**
@@ -597,9 +1354,9 @@ void gen_push_operand(dstring_t *symbol) {
  */
 void gen_pop_operand(dstring_t *var_name) {
     if (var_name) {
-        printf("POPS LF@%s\n", var_name->data);  
+        ir_emit("POPS LF@%s\n", var_name->data);  
     } else {
-        printf("POPS GF@_discard\n");  
+        ir_emit("POPS GF@_discard\n");  
     }
 }
 
@@ -608,7 +1365,7 @@ void gen_pop_operand(dstring_t *var_name) {
  * @details Pops the frame and returns to the caller.
  */
 void gen_return() {
-    printf("POPS GF@return\n");
-    printf("POPFRAME\n");
-    printf("RETURN\n");
+    ir_emit("POPS GF@return\n");
+    ir_emit("POPFRAME\n");
+    ir_emit("RETURN\n");
 }
\ No newline at end of file
@@ -8,16 +8,34 @@
 
 #include "stack.h"
 #include"dstring.h"
+#include "ir.h"
+#include "file.h"
 
+typedef enum {
+    EMIT_IFJCODE,       // IFJcode24 for the interpreter
+    EMIT_C,             // C99 source including its runtime
+    EMIT_X86_64,        // GNU assembler for x86-64 Linux, linked with the runtime
+} emit_target_t;
 
 
 void generator_init();
 void generator_cleanup();
+void gen_set_compact_names(bool enabled, FILE *map);
+void gen_set_cfg_dump(FILE *out);
+void gen_set_unroll_factor(int factor);
+void gen_set_string_pool(bool enabled);
+void gen_set_run(bool enabled);
+void gen_set_emit(emit_target_t target);
+void gen_set_instrument(source_t *source);
+int gen_run_status();
 void gen_header();
 void gen_builtin_functions();
 void gen_func_start(dstring_t *name);
 void gen_func_end();
+void gen_func_finish();
+void gen_program_finish();
 void gen_defvar(dstring_t *var_name);
+void gen_param(dstring_t *param_name, ir_type_t type);
 void gen_if_start();
 void gen_if_else();
 void gen_if_end();
@@ -32,6 +50,7 @@ void gen_while_nullable_end();
 void gen_arithmetic(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2);
 void gen_relational(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2);
 void gen_logical(const char *operator, dstring_t *dest, dstring_t *op1, dstring_t *op2);
+void gen_short_circuit(bool is_and, ir_instr_t *lhs_end);
 void gen_assignment(dstring_t *dest, dstring_t *source);
 void gen_return();
 void gen_push_operand(dstring_t *symbol);
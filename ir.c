@@ -0,0 +1,399 @@
+/**
+ * IFJ24
+ * @brief Buffered instruction list (IR) of generated IFJcode24 code.
+ * @details While a list is active, emitted instructions are parsed and buffered
+ *          so optimization passes can rewrite them before they are printed.
+ *          Without an active list the code is printed directly.
+ */
+
+#include "ir.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ir_list_t *active_list = NULL;
+static bool pending_space = false;
+
+/**
+ * @brief Duplicates a string, exiting on allocation failure.
+ * @param str String to duplicate.
+ * @return Newly allocated copy.
+ */
+static char *ir_strdup(const char *str) {
+    size_t length = strlen(str);
+    char *copy = malloc(length + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for instruction.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, str, length + 1);
+    return copy;
+}
+
+/**
+ * @brief Creates an empty instruction list.
+ * @return Pointer to the new list.
+ */
+ir_list_t *ir_list_create() {
+    ir_list_t *list = malloc(sizeof(ir_list_t));
+    if (list == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for instruction list.\n");
+        exit(EXIT_FAILURE);
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+    return list;
+}
+
+/**
+ * @brief Frees an instruction list including all of its instructions.
+ * @param list List to free.
+ */
+void ir_list_free(ir_list_t *list) {
+    if (!list) return;
+    ir_instr_t *instr = list->head;
+    while (instr) {
+        ir_instr_t *next = instr->next;
+        ir_instr_free(instr);
+        instr = next;
+    }
+    free(list);
+}
+
+/**
+ * @brief Starts buffering emitted instructions into the given list.
+ * @param list Target list.
+ */
+void ir_begin(ir_list_t *list) {
+    active_list = list;
+    pending_space = false;
+}
+
+/**
+ * @brief Stops buffering and returns the list that was active.
+ * @return Previously active list, or NULL.
+ */
+ir_list_t *ir_end() {
+    ir_list_t *list = active_list;
+    active_list = NULL;
+    return list;
+}
+
+/**
+ * @brief Returns the currently active list.
+ * @return Active list, or NULL when the code is printed directly.
+ */
+ir_list_t *ir_current() {
+    return active_list;
+}
+
+/**
+ * @brief Creates an instruction.
+ * @param opcode Instruction name.
+ * @param operand_count Number of operands that follow as const char *.
+ * @return Pointer to the new instruction.
+ */
+ir_instr_t *ir_instr_create(const char *opcode, int operand_count, ...) {
+    ir_instr_t *instr = calloc(1, sizeof(ir_instr_t));
+    if (instr == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for instruction.\n");
+        exit(EXIT_FAILURE);
+    }
+    instr->opcode = ir_strdup(opcode);
+
+    va_list args;
+    va_start(args, operand_count);
+    for (int i = 0; i < operand_count && i < IR_MAX_OPERANDS; i++) {
+        instr->operands[i] = ir_strdup(va_arg(args, const char *));
+    }
+    va_end(args);
+    instr->operand_count = operand_count < IR_MAX_OPERANDS ? operand_count : IR_MAX_OPERANDS;
+    return instr;
+}
+
+/**
+ * @brief Creates a copy of an instruction that is not linked into any list.
+ * @param instr Instruction to copy.
+ * @return Pointer to the new instruction.
+ */
+ir_instr_t *ir_instr_copy(const ir_instr_t *instr) {
+    ir_instr_t *copy = ir_instr_create(instr->opcode, 0);
+    for (int i = 0; i < instr->operand_count; i++) {
+        copy->operands[i] = ir_strdup(instr->operands[i]);
+    }
+    copy->operand_count = instr->operand_count;
+    copy->spaced = instr->spaced;
+    copy->dead = instr->dead;
+    copy->type = instr->type;
+    return copy;
+}
+
+/**
+ * @brief Frees a single instruction.
+ * @param instr Instruction to free.
+ */
+void ir_instr_free(ir_instr_t *instr) {
+    if (!instr) return;
+    free(instr->opcode);
+    for (int i = 0; i < instr->operand_count; i++) {
+        free(instr->operands[i]);
+    }
+    free(instr);
+}
+
+/**
+ * @brief Replaces one operand of an instruction.
+ * @param instr Instruction to modify.
+ * @param index Operand index.
+ * @param operand New operand text.
+ */
+void ir_set_operand(ir_instr_t *instr, int index, const char *operand) {
+    char *copy = ir_strdup(operand);
+    if (index < instr->operand_count) {
+        free(instr->operands[index]);
+    } else {
+        instr->operand_count = index + 1;
+    }
+    instr->operands[index] = copy;
+}
+
+/**
+ * @brief Replaces the opcode of an instruction.
+ * @param instr Instruction to modify.
+ * @param opcode New instruction name.
+ */
+void ir_set_opcode(ir_instr_t *instr, const char *opcode) {
+    char *copy = ir_strdup(opcode);
+    free(instr->opcode);
+    instr->opcode = copy;
+}
+
+/**
+ * @brief Appends an instruction at the end of the list.
+ * @param list Target list.
+ * @param instr Instruction to append.
+ */
+void ir_append(ir_list_t *list, ir_instr_t *instr) {
+    instr->next = NULL;
+    instr->prev = list->tail;
+    if (list->tail) {
+        list->tail->next = instr;
+    } else {
+        list->head = instr;
+    }
+    list->tail = instr;
+    list->count++;
+}
+
+/**
+ * @brief Inserts an instruction after the given position.
+ * @param list Target list.
+ * @param pos Position, NULL inserts at the beginning.
+ * @param instr Instruction to insert.
+ */
+void ir_insert_after(ir_list_t *list, ir_instr_t *pos, ir_instr_t *instr) {
+    if (pos == NULL) {
+        instr->prev = NULL;
+        instr->next = list->head;
+        if (list->head) {
+            list->head->prev = instr;
+        } else {
+            list->tail = instr;
+        }
+        list->head = instr;
+    } else {
+        instr->prev = pos;
+        instr->next = pos->next;
+        if (pos->next) {
+            pos->next->prev = instr;
+        } else {
+            list->tail = instr;
+        }
+        pos->next = instr;
+    }
+    list->count++;
+}
+
+/**
+ * @brief Inserts an instruction before the given position.
+ * @param list Target list.
+ * @param pos Position, NULL appends at the end.
+ * @param instr Instruction to insert.
+ */
+void ir_insert_before(ir_list_t *list, ir_instr_t *pos, ir_instr_t *instr) {
+    if (pos == NULL) {
+        ir_append(list, instr);
+    } else {
+        ir_insert_after(list, pos->prev, instr);
+    }
+}
+
+/**
+ * @brief Unlinks and frees an instruction.
+ * @param list List containing the instruction.
+ * @param instr Instruction to remove.
+ */
+void ir_remove(ir_list_t *list, ir_instr_t *instr) {
+    if (instr->prev) {
+        instr->prev->next = instr->next;
+    } else {
+        list->head = instr->next;
+    }
+    if (instr->next) {
+        instr->next->prev = instr->prev;
+    } else {
+        list->tail = instr->prev;
+    }
+    if (instr->spaced && instr->next) {
+        instr->next->spaced = true;
+    }
+    list->count--;
+    ir_instr_free(instr);
+}
+
+/**
+ * @brief Removes all instructions marked as dead.
+ * @param list List to clean up.
+ */
+void ir_sweep(ir_list_t *list) {
+    ir_instr_t *instr = list->head;
+    while (instr) {
+        ir_instr_t *next = instr->next;
+        if (instr->dead) {
+            ir_remove(list, instr);
+        }
+        instr = next;
+    }
+}
+
+/**
+ * @brief Checks the opcode of an instruction.
+ * @param instr Instruction to check, may be NULL.
+ * @param opcode Expected instruction name.
+ * @return True if the instruction has the given opcode.
+ */
+bool ir_is(const ir_instr_t *instr, const char *opcode) {
+    return instr != NULL && strcmp(instr->opcode, opcode) == 0;
+}
+
+/**
+ * @brief Returns the last buffered instruction.
+ * @return Last instruction of the active list, or NULL.
+ */
+ir_instr_t *ir_last() {
+    return active_list ? active_list->tail : NULL;
+}
+
+/**
+ * @brief Parses one line of code and appends it to the active list.
+ * @param line Line without the trailing newline.
+ */
+static void ir_parse_line(char *line) {
+    char *words[IR_MAX_OPERANDS + 1];
+    int word_count = 0;
+    char *cursor = line;
+
+    while (*cursor && word_count < IR_MAX_OPERANDS + 1) {
+        while (*cursor == ' ') cursor++;
+        if (!*cursor) break;
+        words[word_count++] = cursor;
+        while (*cursor && *cursor != ' ') cursor++;
+        if (*cursor) *cursor++ = '\0';
+    }
+
+    if (word_count == 0) {
+        pending_space = true;
+        return;
+    }
+
+    ir_instr_t *instr = ir_instr_create(words[0], 0);
+    for (int i = 1; i < word_count; i++) {
+        instr->operands[instr->operand_count++] = ir_strdup(words[i]);
+    }
+    instr->spaced = pending_space;
+    pending_space = false;
+    ir_append(active_list, instr);
+}
+
+/**
+ * @brief Emits generated code with printf-style formatting.
+ * @details The text may contain several newline-terminated instructions.
+ * @param format Format string.
+ */
+void ir_emit(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (active_list == NULL) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int length = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+
+    char *text = malloc(length + 1);
+    if (text == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for instruction.\n");
+        exit(EXIT_FAILURE);
+    }
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+
+    char *line = text;
+    while (*line) {
+        char *newline = strchr(line, '\n');
+        if (newline) {
+            *newline = '\0';
+        }
+        ir_parse_line(line);
+        if (!newline) break;
+        line = newline + 1;
+    }
+    free(text);
+}
+
+/**
+ * @brief Emits an instruction with a single operand without any formatting.
+ * @details The operand has to be in its final IFJcode24 form already. It is not copied,
+ *          the instruction takes ownership of it.
+ * @param opcode Instruction name, e.g. "PUSHS".
+ * @param operand Heap-allocated operand, e.g. "string@abc".
+ */
+void ir_emit_owned(const char *opcode, char *operand) {
+    if (active_list == NULL) {
+        printf("%s %s\n", opcode, operand);
+        free(operand);
+        return;
+    }
+
+    ir_instr_t *instr = ir_instr_create(opcode, 0);
+    instr->operands[0] = operand;
+    instr->operand_count = 1;
+    instr->spaced = pending_space;
+    pending_space = false;
+    ir_append(active_list, instr);
+}
+
+/**
+ * @brief Prints all instructions of the list.
+ * @param list List to print.
+ * @param out Output stream.
+ */
+void ir_print(ir_list_t *list, FILE *out) {
+    for (ir_instr_t *instr = list->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        if (instr->spaced) {
+            fputc('\n', out);
+        }
+        fputs(instr->opcode, out);
+        for (int i = 0; i < instr->operand_count; i++) {
+            fputc(' ', out);
+            fputs(instr->operands[i], out);
+        }
+        fputc('\n', out);
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * IFJ24
+ * @brief Header for the buffered instruction list (IR) of generated IFJcode24 code.
+ */
+
+#ifndef IR_H
+#define IR_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define IR_MAX_OPERANDS 3
+
+// Static type of a local variable, as declared in the source
+typedef enum {
+    IR_TYPE_UNKNOWN,                        // Any value, its tag is checked at run time
+    IR_TYPE_INT,                            // Always an int, the variable is never nil
+    IR_TYPE_FLOAT,                          // Always a float, the variable is never nil
+} ir_type_t;
+
+typedef struct ir_instr {
+    char *opcode;                           // Instruction name, e.g. "PUSHS"
+    char *operands[IR_MAX_OPERANDS];        // Operands in textual form, e.g. "LF@x", "int@1"
+    int operand_count;
+    bool spaced;                            // Print an empty line before the instruction
+    bool dead;                              // Marked for removal by an optimization pass
+    ir_type_t type;                         // Type of the variable a DEFVAR defines
+    struct ir_instr *prev;
+    struct ir_instr *next;
+} ir_instr_t;
+
+typedef struct {
+    ir_instr_t *head;
+    ir_instr_t *tail;
+    int count;
+} ir_list_t;
+
+ir_list_t *ir_list_create();
+void ir_list_free(ir_list_t *list);
+void ir_begin(ir_list_t *list);
+ir_list_t *ir_end();
+ir_list_t *ir_current();
+void ir_emit(const char *format, ...);
+void ir_emit_owned(const char *opcode, char *operand);
+ir_instr_t *ir_last();
+ir_instr_t *ir_instr_create(const char *opcode, int operand_count, ...);
+ir_instr_t *ir_instr_copy(const ir_instr_t *instr);
+void ir_instr_free(ir_instr_t *instr);
+void ir_set_operand(ir_instr_t *instr, int index, const char *operand);
+void ir_set_opcode(ir_instr_t *instr, const char *opcode);
+void ir_append(ir_list_t *list, ir_instr_t *instr);
+void ir_insert_after(ir_list_t *list, ir_instr_t *pos, ir_instr_t *instr);
+void ir_insert_before(ir_list_t *list, ir_instr_t *pos, ir_instr_t *instr);
+void ir_remove(ir_list_t *list, ir_instr_t *instr);
+void ir_sweep(ir_list_t *list);
+bool ir_is(const ir_instr_t *instr, const char *opcode);
+void ir_print(ir_list_t *list, FILE *out);
+
+#endif
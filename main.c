@@ -2,10 +2,12 @@
 /// @brief Main function that accepts arguments from the command line
 
 #include <stdio.h>
+#include <string.h>
 #include "scanner.h"
 #include "error_codes.h"
 #include "parser.h"
 #include "file.h"
+#include "emit_c.h"
 
 /**
  * @brief Main program functions
@@ -14,13 +16,67 @@
  * @return Program return code (0 for success, otherwise error code)
  */
 int main(int argc, char *argv[]) {
+    bool compact_names = false;
+    FILE *name_map = NULL;
+    FILE *cfg_dump = NULL;
+    FILE *input = stdin;
+    bool instrument = false;
 
-    save_input_to_file();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compact-names") == 0) {
+            compact_names = true;
+        } else if (strcmp(argv[i], "--name-map") == 0 && i + 1 < argc) {
+            compact_names = true;
+            name_map = fopen(argv[++i], "w");
+            if (name_map == NULL) {
+                fprintf(stderr, "Error: Could not open name map %s\n", argv[i]);
+                return ERROR_INTERNAL_COMPILER_ERROR;
+            }
+        } else if (strcmp(argv[i], "--dump-cfg") == 0 && i + 1 < argc) {
+            cfg_dump = fopen(argv[++i], "w");
+            if (cfg_dump == NULL) {
+                fprintf(stderr, "Error: Could not open CFG dump %s\n", argv[i]);
+                return ERROR_INTERNAL_COMPILER_ERROR;
+            }
+        } else if (strcmp(argv[i], "--string-pool") == 0) {
+            gen_set_string_pool(true);
+        } else if (strcmp(argv[i], "--instrument") == 0) {
+            instrument = true;
+        } else if (strcmp(argv[i], "--run") == 0 && i + 1 < argc) {
+            // The program reads its input from stdin, so the source comes from a file
+            input = fopen(argv[++i], "r");
+            if (input == NULL) {
+                fprintf(stderr, "Error: Could not open source %s\n", argv[i]);
+                return ERROR_INTERNAL_COMPILER_ERROR;
+            }
+            gen_set_run(true);
+        } else if (strcmp(argv[i], "--emit=ifjcode") == 0) {
+            gen_set_emit(EMIT_IFJCODE);
+        } else if (strcmp(argv[i], "--emit=c") == 0) {
+            gen_set_emit(EMIT_C);
+        } else if (strcmp(argv[i], "--emit=x86-64") == 0) {
+            gen_set_emit(EMIT_X86_64);
+        } else if (strcmp(argv[i], "--emit=runtime") == 0) {
+            // C source of the runtime that assembly from --emit=x86-64 is linked with
+            emit_c_runtime(stdout);
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--unroll") == 0 && i + 1 < argc) {
+            gen_set_unroll_factor(atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "Usage: %s [--compact-names] [--name-map FILE] [--dump-cfg FILE] [--unroll FACTOR] [--string-pool] [--instrument] [--emit=ifjcode|c|x86-64|runtime] < source | --run SOURCE\n", argv[0]);
+            return ERROR_INTERNAL_COMPILER_ERROR;
+        }
+    }
+    gen_set_compact_names(compact_names, name_map);
+    gen_set_cfg_dump(cfg_dump);
 
-    FILE *source = open_temp_file();
-    if (!source) {
-        fprintf(stderr, "Failed to open temporary file\n");
-        return EXIT_FAILURE;
+    source_t *source = source_load(input);
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (instrument) {
+        // Counters report the lines the parser has reached in the source
+        gen_set_instrument(source);
     }
 
     parser_init(source);
@@ -29,8 +85,13 @@ int main(int argc, char *argv[]) {
         error_exit(ERROR_SYNTAX_ANALYSIS, "Parsing failed");
     }
 
-    fclose(source);
-    cleanup_temp_file();
+    source_free(source);
+    if (name_map) {
+        fclose(name_map);
+    }
+    if (cfg_dump) {
+        fclose(cfg_dump);
+    }
 
-    return EXIT_SUCCESS;  
+    return gen_run_status();
 }
@@ -0,0 +1,3044 @@
+/**
+ * IFJ24
+ * @brief Optimization passes over the generated IFJcode24 code.
+ * @details Passes work on the buffered instruction list of one function
+ *          before it is printed.
+ */
+
+#include "optimizer.h"
+#include "cfg.h"
+#include "ctfe.h"
+#include "symtable.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern symtable_t *symbol_table;
+
+// Built-in functions generated by gen_builtin_functions()
+static const builtin_info_t builtin_table[] = {
+    { "$ifj_readstr",   0, false },
+    { "$ifj_readi32",   0, false },
+    { "$ifj_readf64",   0, false },
+    { "$ifj_write",     1, false },
+    { "$ifj_i2f",       1, true  },
+    { "$ifj_f2i",       1, true  },
+    { "$ifj_string",    1, true  },
+    { "$ifj_concat",    2, true  },
+    { "$ifj_length",    1, true  },
+    { "$ifj_chr",       1, true  },
+    { "$ifj_ord",       2, true  },
+    { "$ifj_substring", 3, true  },
+    { "$ifj_strcmp",    2, true  },
+};
+
+#define BUILTIN_COUNT (sizeof(builtin_table) / sizeof(builtin_table[0]))
+
+typedef struct {
+    char *label;            // Label of the clone, e.g. "$pad$spec0"
+    char *signature;        // Callee label and the constant arguments it was cloned for
+    int arity;              // Arguments still passed on the data stack
+} spec_clone_t;
+
+// Specialized clones of user functions, see opt_specialize()
+static spec_clone_t *spec_clones = NULL;
+static int spec_clone_count = 0, spec_clone_capacity = 0;
+
+/**
+ * @brief Finds a built-in function by the label of its implementation.
+ * @param label Label including the '$' prefix.
+ * @return Pointer to the table entry, or NULL for user functions.
+ */
+const builtin_info_t *builtin_lookup(const char *label) {
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        if (strcmp(builtin_table[i].label, label) == 0) {
+            return &builtin_table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of arguments a called function pops from the data stack.
+ * @param label Label of the called function including the '$' prefix.
+ * @return Number of arguments, or -1 if the function is unknown.
+ */
+int call_arity(const char *label) {
+    const builtin_info_t *builtin = builtin_lookup(label);
+    if (builtin) {
+        return builtin->arity;
+    }
+    for (int i = 0; i < spec_clone_count; i++) {
+        if (strcmp(spec_clones[i].label, label) == 0) {
+            return spec_clones[i].arity;
+        }
+    }
+    if (symbol_table == NULL || label[0] != '$') {
+        return -1;
+    }
+
+    dstring_t *name = dstring_init();
+    if (!name) return -1;
+    dstring_add_str(name, (char *)label + 1);
+    symtable_data_t *entry = symtable_find(symbol_table, name);
+    dstring_free(name);
+
+    if (!entry || entry->type != fn_t || !entry->funcData) {
+        return -1;
+    }
+    return entry->funcData->paramCount;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Local value numbering                                                     */
+/* ------------------------------------------------------------------------ */
+
+typedef enum {
+    LVN_STACK,          // Result left on the data stack by a stack instruction
+    LVN_CALL,           // Result stored in GF@return by a pure built-in call
+    LVN_THREE,          // Result stored in the destination of a three-address instruction
+} lvn_kind_t;
+
+typedef struct {
+    char *name;         // Variable or literal operand text
+    int vn;
+} lvn_name_t;
+
+typedef struct {
+    char *op;
+    int args[3];
+    int arg_count;
+    int vn;
+    lvn_kind_t kind;
+    ir_instr_t *def;    // Instruction after which the value is available
+    ir_instr_t *operand_instr[3];
+} lvn_expr_t;
+
+typedef struct {
+    int vn;
+    ir_instr_t *start;  // First instruction computing the value, NULL if unknown
+} lvn_slot_t;
+
+typedef struct {
+    lvn_name_t *names;
+    int name_count, name_capacity;
+    lvn_expr_t *exprs;
+    int expr_count, expr_capacity;
+    lvn_slot_t *stack;
+    int stack_count, stack_capacity;
+    int next_vn;
+    int temp_count;
+    ir_list_t *code;
+    // Pending pure call whose result is pushed by the following PUSHS GF@return
+    ir_instr_t *call_instr;
+    ir_instr_t *call_start;
+    int call_expr;
+    bool call_recomputed;
+    int return_vn_before_call;
+} lvn_state_t;
+
+static void *lvn_grow(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, *capacity * item_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Could not allocate memory for value numbering.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static void lvn_reset(lvn_state_t *state) {
+    for (int i = 0; i < state->name_count; i++) {
+        free(state->names[i].name);
+    }
+    for (int i = 0; i < state->expr_count; i++) {
+        free(state->exprs[i].op);
+    }
+    state->name_count = 0;
+    state->expr_count = 0;
+    state->stack_count = 0;
+    state->call_instr = NULL;
+}
+
+static int lvn_fresh(lvn_state_t *state) {
+    return state->next_vn++;
+}
+
+static bool lvn_is_variable(const char *operand) {
+    return strncmp(operand, "LF@", 3) == 0 || strncmp(operand, "GF@", 3) == 0 || strncmp(operand, "TF@", 3) == 0;
+}
+
+/**
+ * @brief Returns the value number of a variable or literal, creating one if needed.
+ */
+static int lvn_name(lvn_state_t *state, const char *name) {
+    for (int i = 0; i < state->name_count; i++) {
+        if (strcmp(state->names[i].name, name) == 0) {
+            return state->names[i].vn;
+        }
+    }
+    if (state->name_count == state->name_capacity) {
+        state->names = lvn_grow(state->names, &state->name_capacity, sizeof(lvn_name_t));
+    }
+    state->names[state->name_count].name = malloc(strlen(name) + 1);
+    if (!state->names[state->name_count].name) {
+        fprintf(stderr, "Error: Could not allocate memory for value numbering.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(state->names[state->name_count].name, name);
+    state->names[state->name_count].vn = lvn_fresh(state);
+    return state->names[state->name_count++].vn;
+}
+
+/**
+ * @brief Records that a variable now holds the given value.
+ */
+static void lvn_assign(lvn_state_t *state, const char *name, int vn) {
+    lvn_name(state, name);
+    for (int i = 0; i < state->name_count; i++) {
+        if (strcmp(state->names[i].name, name) == 0) {
+            state->names[i].vn = vn;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Invalidates all global variables, which any call may overwrite.
+ */
+static void lvn_clobber_globals(lvn_state_t *state) {
+    for (int i = 0; i < state->name_count; i++) {
+        if (strncmp(state->names[i].name, "GF@", 3) == 0) {
+            state->names[i].vn = lvn_fresh(state);
+        }
+    }
+}
+
+/**
+ * @brief Finds a local variable currently holding the given value.
+ * @return Variable name, or NULL.
+ */
+static const char *lvn_holder(lvn_state_t *state, int vn) {
+    for (int i = 0; i < state->name_count; i++) {
+        if (state->names[i].vn == vn && strncmp(state->names[i].name, "LF@", 3) == 0) {
+            return state->names[i].name;
+        }
+    }
+    return NULL;
+}
+
+static bool lvn_is_commutative(const char *op) {
+    return strcmp(op, "ADD") == 0 || strcmp(op, "MUL") == 0 || strcmp(op, "EQ") == 0 ||
+           strcmp(op, "AND") == 0 || strcmp(op, "OR") == 0;
+}
+
+/**
+ * @brief Looks up an expression by operator and operand value numbers.
+ * @return Index into the expression table, or -1.
+ */
+static int lvn_find_expr(lvn_state_t *state, const char *op, int *args, int arg_count) {
+    for (int i = 0; i < state->expr_count; i++) {
+        lvn_expr_t *expr = &state->exprs[i];
+        if (expr->arg_count != arg_count || strcmp(expr->op, op) != 0) continue;
+        bool same = true;
+        for (int j = 0; j < arg_count; j++) {
+            if (expr->args[j] != args[j]) same = false;
+        }
+        if (same) return i;
+    }
+    return -1;
+}
+
+static int lvn_add_expr(lvn_state_t *state, const char *op, int *args, int arg_count, lvn_kind_t kind, ir_instr_t *def) {
+    if (state->expr_count == state->expr_capacity) {
+        state->exprs = lvn_grow(state->exprs, &state->expr_capacity, sizeof(lvn_expr_t));
+    }
+    lvn_expr_t *expr = &state->exprs[state->expr_count];
+    expr->op = malloc(strlen(op) + 1);
+    if (!expr->op) {
+        fprintf(stderr, "Error: Could not allocate memory for value numbering.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(expr->op, op);
+    for (int j = 0; j < arg_count; j++) {
+        expr->args[j] = args[j];
+        expr->operand_instr[j] = NULL;
+    }
+    expr->arg_count = arg_count;
+    expr->vn = lvn_fresh(state);
+    expr->kind = kind;
+    expr->def = def;
+    return state->expr_count++;
+}
+
+static void lvn_push(lvn_state_t *state, int vn, ir_instr_t *start) {
+    if (state->stack_count == state->stack_capacity) {
+        state->stack = lvn_grow(state->stack, &state->stack_capacity, sizeof(lvn_slot_t));
+    }
+    state->stack[state->stack_count].vn = vn;
+    state->stack[state->stack_count].start = start;
+    state->stack_count++;
+}
+
+static lvn_slot_t lvn_pop(lvn_state_t *state) {
+    if (state->stack_count == 0) {
+        lvn_slot_t unknown = { lvn_fresh(state), NULL };
+        return unknown;
+    }
+    return state->stack[--state->stack_count];
+}
+
+/**
+ * @brief Returns the name of the three-address form of a stack instruction.
+ * @return Instruction name, or NULL if the stack instruction has none.
+ */
+static const char *lvn_three_address_op(const char *stack_op) {
+    static const char *pairs[][2] = {
+        { "ADDS", "ADD" }, { "SUBS", "SUB" }, { "MULS", "MUL" }, { "DIVS", "DIV" }, { "IDIVS", "IDIV" },
+        { "LTS", "LT" }, { "GTS", "GT" }, { "EQS", "EQ" }, { "ANDS", "AND" }, { "ORS", "OR" },
+        { "NOTS", "NOT" }, { "INT2FLOATS", "INT2FLOAT" }, { "FLOAT2INTS", "FLOAT2INT" },
+        { "INT2CHARS", "INT2CHAR" }, { "STRI2INTS", "STRI2INT" },
+    };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        if (strcmp(pairs[i][0], stack_op) == 0) return pairs[i][1];
+    }
+    return NULL;
+}
+
+static int lvn_stack_arity(const char *op) {
+    const char *unary[] = { "NOTS", "INT2FLOATS", "FLOAT2INTS", "INT2CHARS" };
+    for (size_t i = 0; i < sizeof(unary) / sizeof(unary[0]); i++) {
+        if (strcmp(op, unary[i]) == 0) return 1;
+    }
+    return lvn_three_address_op(op) ? 2 : 0;
+}
+
+/**
+ * @brief Checks whether an instruction may be dropped when its result is reused.
+ */
+static bool lvn_is_removable(const ir_instr_t *instr) {
+    if (ir_is(instr, "PUSHS")) return true;
+    if (ir_is(instr, "POPS")) return strcmp(instr->operands[0], "GF@temp") == 0;
+    if (ir_is(instr, "CALL")) {
+        const builtin_info_t *builtin = builtin_lookup(instr->operands[0]);
+        return builtin && builtin->pure;
+    }
+    return lvn_stack_arity(instr->opcode) > 0;
+}
+
+/**
+ * @brief Counts instructions of a range, or returns -1 if the range is not removable.
+ */
+static int lvn_range_cost(ir_instr_t *start, ir_instr_t *end) {
+    int count = 0;
+    for (ir_instr_t *instr = start; instr; instr = instr->next) {
+        if (!instr->dead) {
+            if (!lvn_is_removable(instr)) return -1;
+            count++;
+        }
+        if (instr == end) return count;
+    }
+    return -1;
+}
+
+/**
+ * @brief Checks whether the first computation of an expression is a plain push of each operand.
+ */
+static bool lvn_is_simple(lvn_expr_t *expr) {
+    if (expr->kind != LVN_STACK || expr->def == NULL || expr->def->dead) return false;
+    ir_instr_t *expected = expr->def;
+    for (int j = expr->arg_count - 1; j >= 0; j--) {
+        ir_instr_t *operand = expr->operand_instr[j];
+        if (!operand || operand->dead || operand->next != expected || !ir_is(operand, "PUSHS")) {
+            return false;
+        }
+        expected = operand;
+    }
+    return true;
+}
+
+/**
+ * @brief Computes how many instructions materializing an expression adds.
+ * @param cost Output, may be negative when the rewrite saves instructions.
+ * @return False if the expression cannot be materialized.
+ */
+static bool lvn_materialize_cost(lvn_expr_t *expr, int *cost) {
+    if (expr->def == NULL || expr->def->dead) return false;
+    switch (expr->kind) {
+        case LVN_STACK: *cost = lvn_is_simple(expr) ? 1 - expr->arg_count : 2; return true;
+        case LVN_CALL: *cost = 1; return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Stores the first computation of an expression into a fresh local variable.
+ * @param temps List collecting DEFVAR instructions of the new variables.
+ * @return Name of the variable holding the value.
+ */
+static const char *lvn_materialize(lvn_state_t *state, lvn_expr_t *expr, ir_list_t *temps) {
+    char temp[32];
+    snprintf(temp, sizeof(temp), "LF@%%cse_%d", state->temp_count++);
+    ir_append(temps, ir_instr_create("DEFVAR", 1, temp));
+
+    if (expr->kind == LVN_CALL) {
+        ir_insert_after(state->code, expr->def, ir_instr_create("MOVE", 2, temp, "GF@return"));
+        expr->def = expr->def->next;
+    } else if (lvn_is_simple(expr)) {
+        // PUSHS a; PUSHS b; OPS  ->  OP tmp a b; PUSHS tmp
+        ir_instr_t *op = ir_instr_create(lvn_three_address_op(expr->def->opcode), 1, temp);
+        for (int j = 0; j < expr->arg_count; j++) {
+            ir_set_operand(op, j + 1, expr->operand_instr[j]->operands[0]);
+        }
+        ir_instr_t *first = expr->operand_instr[0];
+        ir_set_opcode(first, op->opcode);
+        for (int j = 0; j < op->operand_count; j++) {
+            ir_set_operand(first, j, op->operands[j]);
+        }
+        ir_instr_free(op);
+        for (int j = 1; j < expr->arg_count; j++) {
+            expr->operand_instr[j]->dead = true;
+        }
+        ir_set_opcode(expr->def, "PUSHS");
+        ir_set_operand(expr->def, 0, temp);
+    } else {
+        ir_insert_after(state->code, expr->def, ir_instr_create("PUSHS", 1, temp));
+        ir_insert_after(state->code, expr->def, ir_instr_create("POPS", 1, temp));
+        expr->def = expr->def->next->next;
+    }
+
+    lvn_assign(state, temp, expr->vn);
+    return lvn_holder(state, expr->vn);
+}
+
+/**
+ * @brief Replaces a recomputation of an already known value by a push of its holder.
+ * @param start First instruction of the recomputation.
+ * @param end Last instruction of the recomputation.
+ * @param holder Variable holding the value, or NULL to materialize it.
+ * @return Instruction pushing the reused value, or NULL if the reuse did not pay off.
+ */
+static ir_instr_t *lvn_reuse(lvn_state_t *state, lvn_expr_t *expr, ir_instr_t *start, ir_instr_t *end, const char *holder, ir_list_t *temps) {
+    if (start == NULL) return NULL;
+    int range = lvn_range_cost(start, end);
+    if (range < 0) return NULL;
+
+    if (holder == NULL) {
+        int cost;
+        if (!lvn_materialize_cost(expr, &cost) || range - 1 <= cost) return NULL;
+        holder = lvn_materialize(state, expr, temps);
+    } else if (range <= 1) {
+        return NULL;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s", holder);
+    for (ir_instr_t *instr = start; instr; instr = instr->next) {
+        instr->dead = true;
+        if (instr == end) break;
+    }
+    ir_instr_t *push = ir_instr_create("PUSHS", 1, name);
+    push->spaced = start->spaced;
+    ir_insert_after(state->code, end, push);
+    if (strcmp(name, "GF@return") != 0) {
+        lvn_assign(state, "GF@return", lvn_fresh(state));
+    }
+    lvn_assign(state, "GF@temp", lvn_fresh(state));
+    return push;
+}
+
+/**
+ * @brief Processes a stack instruction computing a value from its operands.
+ */
+static void lvn_stack_op(lvn_state_t *state, ir_instr_t *instr, int arity, ir_list_t *temps) {
+    lvn_slot_t operands[2];
+    for (int j = arity - 1; j >= 0; j--) {
+        operands[j] = lvn_pop(state);
+    }
+    int args[2];
+    for (int j = 0; j < arity; j++) {
+        args[j] = operands[j].vn;
+    }
+    const char *three = lvn_three_address_op(instr->opcode);
+    if (arity == 2 && lvn_is_commutative(three) && args[0] > args[1]) {
+        int swap = args[0];
+        args[0] = args[1];
+        args[1] = swap;
+    }
+
+    ir_instr_t *start = operands[0].start;
+    for (int j = 1; j < arity; j++) {
+        if (operands[j].start == NULL) start = NULL;
+    }
+
+    int index = lvn_find_expr(state, three, args, arity);
+    if (index >= 0) {
+        lvn_expr_t *expr = &state->exprs[index];
+        ir_instr_t *push = lvn_reuse(state, expr, start, instr, lvn_holder(state, expr->vn), temps);
+        lvn_push(state, state->exprs[index].vn, push ? push : start);
+        return;
+    }
+
+    index = lvn_add_expr(state, three, args, arity, LVN_STACK, instr);
+    for (int j = 0; j < arity; j++) {
+        state->exprs[index].operand_instr[j] = operands[j].start;
+    }
+    lvn_push(state, state->exprs[index].vn, start);
+}
+
+/**
+ * @brief Processes a call instruction.
+ * @return False if the block state had to be discarded.
+ */
+static bool lvn_call(lvn_state_t *state, ir_instr_t *instr) {
+    int arity = call_arity(instr->operands[0]);
+    if (arity < 0) return false;
+
+    const builtin_info_t *builtin = builtin_lookup(instr->operands[0]);
+    int args[3];
+    ir_instr_t *start = instr;
+    for (int j = arity - 1; j >= 0; j--) {
+        lvn_slot_t slot = lvn_pop(state);
+        if (j < 3) args[j] = slot.vn;
+        start = slot.start;
+    }
+
+    int return_vn = lvn_name(state, "GF@return");
+    lvn_clobber_globals(state);
+    state->call_instr = NULL;
+
+    if (builtin && builtin->pure && arity <= 3) {
+        int index = lvn_find_expr(state, instr->operands[0], args, arity);
+        state->call_recomputed = index >= 0;
+        if (index < 0) {
+            index = lvn_add_expr(state, instr->operands[0], args, arity, LVN_CALL, instr);
+        }
+        state->call_instr = instr;
+        state->call_start = start;
+        state->call_expr = index;
+        state->return_vn_before_call = return_vn;
+        lvn_assign(state, "GF@return", state->exprs[index].vn);
+    }
+    return true;
+}
+
+/**
+ * @brief Reuses results of pure expressions and built-in calls within basic blocks.
+ * @details Simulates the data stack symbolically and numbers values by operator,
+ *          operand variables and literals. A recomputed value is replaced by a push
+ *          of a local variable that already holds it; the first computation is
+ *          stored into a fresh temporary when that is cheaper than recomputing.
+ * @param code Instruction list of one function.
+ */
+void opt_local_value_numbering(ir_list_t *code) {
+    lvn_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.code = code;
+    ir_list_t *temps = ir_list_create();
+
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        const char *op = instr->opcode;
+        int arity;
+
+        if (ir_is(instr, "LABEL") || ir_is(instr, "CREATEFRAME") || ir_is(instr, "PUSHFRAME") || ir_is(instr, "POPFRAME")) {
+            lvn_reset(&state);
+        } else if (ir_is(instr, "PUSHS")) {
+            if (state.call_instr && strcmp(instr->operands[0], "GF@return") == 0) {
+                // Result of a pure call, the pushed value starts with the pushes of its arguments
+                if (!state.call_recomputed) {
+                    lvn_push(&state, state.exprs[state.call_expr].vn, state.call_start);
+                    state.call_instr = NULL;
+                    continue;
+                }
+                lvn_expr_t *expr = &state.exprs[state.call_expr];
+                const char *holder = lvn_holder(&state, expr->vn);
+                if (!holder && state.return_vn_before_call == expr->vn) {
+                    holder = "GF@return";
+                }
+                ir_instr_t *start = state.call_start;
+                state.call_instr = NULL;
+                ir_instr_t *push = lvn_reuse(&state, expr, start, instr, holder, temps);
+                if (push) {
+                    if (holder && strcmp(holder, "GF@return") == 0) {
+                        lvn_assign(&state, "GF@return", expr->vn);
+                    }
+                    lvn_push(&state, expr->vn, push);
+                    instr = push;
+                    continue;
+                }
+                lvn_push(&state, expr->vn, start);
+                continue;
+            }
+            lvn_push(&state, lvn_name(&state, instr->operands[0]), instr);
+        } else if (ir_is(instr, "POPS")) {
+            lvn_slot_t slot = lvn_pop(&state);
+            lvn_assign(&state, instr->operands[0], slot.vn);
+        } else if ((arity = lvn_stack_arity(op)) > 0) {
+            lvn_stack_op(&state, instr, arity, temps);
+        } else if (ir_is(instr, "CALL")) {
+            if (!lvn_call(&state, instr)) {
+                lvn_reset(&state);
+            }
+            continue;
+        } else if (ir_is(instr, "MOVE")) {
+            lvn_assign(&state, instr->operands[0], lvn_name(&state, instr->operands[1]));
+        } else if (lvn_stack_arity(op) == 0 && instr->operand_count == 3 && lvn_is_variable(instr->operands[0]) &&
+                   !ir_is(instr, "SETCHAR") && strncmp(op, "JUMP", 4) != 0) {
+            // Three-address instruction: ADD, CONCAT, STRI2INT, GETCHAR, ...
+            int args[2] = { lvn_name(&state, instr->operands[1]), lvn_name(&state, instr->operands[2]) };
+            if (lvn_is_commutative(op) && args[0] > args[1]) {
+                int swap = args[0];
+                args[0] = args[1];
+                args[1] = swap;
+            }
+            int index = lvn_find_expr(&state, op, args, 2);
+            if (index >= 0) {
+                const char *holder = lvn_holder(&state, state.exprs[index].vn);
+                if (holder && strcmp(holder, instr->operands[0]) != 0) {
+                    char name[64];
+                    snprintf(name, sizeof(name), "%s", holder);
+                    ir_set_opcode(instr, "MOVE");
+                    ir_set_operand(instr, 1, name);
+                    free(instr->operands[2]);
+                    instr->operands[2] = NULL;
+                    instr->operand_count = 2;
+                }
+            } else {
+                index = lvn_add_expr(&state, op, args, 2, LVN_THREE, instr);
+            }
+            lvn_assign(&state, instr->operands[0], state.exprs[index].vn);
+        } else if (ir_is(instr, "CLEARS")) {
+            state.stack_count = 0;
+        } else if (ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+            lvn_reset(&state);
+        } else if (strncmp(op, "JUMP", 4) == 0 || ir_is(instr, "RETURN") || ir_is(instr, "EXIT")) {
+            lvn_reset(&state);
+        } else if (instr->operand_count > 0 && lvn_is_variable(instr->operands[0]) &&
+                   (ir_is(instr, "DEFVAR") || ir_is(instr, "READ") || ir_is(instr, "TYPE") ||
+                    ir_is(instr, "SETCHAR") || ir_is(instr, "NOT") || ir_is(instr, "INT2FLOAT") ||
+                    ir_is(instr, "FLOAT2INT") || ir_is(instr, "INT2CHAR") || ir_is(instr, "STRLEN"))) {
+            lvn_assign(&state, instr->operands[0], lvn_fresh(&state));
+        } else if (!ir_is(instr, "WRITE") && !ir_is(instr, "DPRINT") && !ir_is(instr, "BREAK")) {
+            lvn_reset(&state);
+        }
+        state.call_instr = NULL;
+    }
+
+    lvn_reset(&state);
+    free(state.names);
+    free(state.exprs);
+    free(state.stack);
+    ir_sweep(code);
+
+    // Temporaries are defined once in the function prologue
+    ir_instr_t *prologue = code->head;
+    while (prologue && !ir_is(prologue, "PUSHFRAME")) {
+        prologue = prologue->next;
+    }
+    while (temps->head) {
+        ir_instr_t *defvar = temps->tail;
+        temps->tail = defvar->prev;
+        if (temps->tail) temps->tail->next = NULL; else temps->head = NULL;
+        ir_insert_after(code, prologue, defvar);
+    }
+    free(temps);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Local variable table                                                      */
+/* ------------------------------------------------------------------------ */
+
+// Local variables of a function numbered for the data-flow analyses
+typedef struct {
+    char **names;
+    int count, capacity;
+} var_table_t;
+
+/**
+ * @brief Returns the index of a local variable, or -1 for other operands.
+ *
+ * A local variable seen for the first time is added to the table when add is set.
+ */
+static int var_index(var_table_t *table, const char *operand, bool add) {
+    if (strncmp(operand, "LF@", 3) != 0) return -1;
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i], operand) == 0) return i;
+    }
+    if (!add) return -1;
+    if (table->count == table->capacity) {
+        table->names = lvn_grow(table->names, &table->capacity, sizeof(char *));
+    }
+    table->names[table->count] = malloc(strlen(operand) + 1);
+    if (!table->names[table->count]) {
+        fprintf(stderr, "Error: Could not allocate memory for local variables.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(table->names[table->count], operand);
+    return table->count++;
+}
+
+static void var_free(var_table_t *table) {
+    for (int i = 0; i < table->count; i++) {
+        free(table->names[i]);
+    }
+    free(table->names);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Nullability analysis                                                      */
+/* ------------------------------------------------------------------------ */
+
+typedef enum {
+    NULL_STATE_UNDEF,   // No path reaching this point assigns the variable yet
+    NULL_STATE_NIL,
+    NULL_STATE_NON_NIL,
+    NULL_STATE_UNKNOWN,
+} null_state_t;
+
+typedef struct {
+    var_table_t vars;   // Local variables of the function
+    cfg_t *cfg;
+    bool *reached;      // Block is reached by some feasible path
+    null_state_t *in;   // State of each variable at the entry of each block
+    null_state_t *stack;
+    int stack_count, stack_capacity;
+} null_analysis_t;
+
+static null_state_t null_join(null_state_t a, null_state_t b) {
+    if (a == NULL_STATE_UNDEF) return b;
+    if (b == NULL_STATE_UNDEF || a == b) return a;
+    return NULL_STATE_UNKNOWN;
+}
+
+/**
+ * @brief Returns what is known about an operand being nil.
+ */
+static null_state_t null_operand(null_analysis_t *analysis, const null_state_t *state, const char *operand) {
+    if (strcmp(operand, "nil@nil") == 0) return NULL_STATE_NIL;
+    if (!lvn_is_variable(operand)) return NULL_STATE_NON_NIL;
+    int var = var_index(&analysis->vars, operand, false);
+    return var >= 0 && state[var] != NULL_STATE_UNDEF ? state[var] : NULL_STATE_UNKNOWN;
+}
+
+static void null_push(null_analysis_t *analysis, null_state_t value) {
+    if (analysis->stack_count == analysis->stack_capacity) {
+        analysis->stack = lvn_grow(analysis->stack, &analysis->stack_capacity, sizeof(null_state_t));
+    }
+    analysis->stack[analysis->stack_count++] = value;
+}
+
+static null_state_t null_pop(null_analysis_t *analysis) {
+    return analysis->stack_count > 0 ? analysis->stack[--analysis->stack_count] : NULL_STATE_UNKNOWN;
+}
+
+/**
+ * @brief Updates the state of variables and of the data stack by one instruction.
+ */
+static void null_transfer(null_analysis_t *analysis, null_state_t *state, const ir_instr_t *instr) {
+    const char *op = instr->opcode;
+    int arity;
+
+    if (ir_is(instr, "PUSHS")) {
+        null_push(analysis, null_operand(analysis, state, instr->operands[0]));
+        return;
+    }
+    if ((arity = lvn_stack_arity(op)) > 0) {
+        for (int j = 0; j < arity; j++) null_pop(analysis);
+        null_push(analysis, NULL_STATE_NON_NIL);
+        return;
+    }
+    if (ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+        null_pop(analysis);
+        null_pop(analysis);
+        return;
+    }
+    if (ir_is(instr, "CLEARS")) {
+        analysis->stack_count = 0;
+        return;
+    }
+    if (ir_is(instr, "CALL")) {
+        arity = call_arity(instr->operands[0]);
+        if (arity < 0) {
+            analysis->stack_count = 0;
+        }
+        for (int j = 0; j < arity; j++) null_pop(analysis);
+        return;
+    }
+    if (instr->operand_count == 0 || cfg_is_jump(instr) || ir_is(instr, "WRITE") ||
+        ir_is(instr, "DPRINT") || ir_is(instr, "EXIT")) {
+        return;
+    }
+
+    int var = var_index(&analysis->vars, instr->operands[0], false);
+    if (var < 0) return;
+    if (ir_is(instr, "POPS")) {
+        state[var] = null_pop(analysis);
+    } else if (ir_is(instr, "MOVE")) {
+        state[var] = null_operand(analysis, state, instr->operands[1]);
+    } else if (ir_is(instr, "DEFVAR") || ir_is(instr, "READ")) {
+        state[var] = NULL_STATE_UNKNOWN;
+    } else {
+        // Arithmetic, string and conversion instructions never produce nil
+        state[var] = NULL_STATE_NON_NIL;
+    }
+}
+
+/**
+ * @brief Recognizes a comparison of a local variable with nil in a conditional jump.
+ * @param jumps_if_nil Set to true if the jump is taken when the variable is nil.
+ * @return Index of the tested variable, or -1.
+ */
+static int null_tested_var(null_analysis_t *analysis, const ir_instr_t *instr, bool *jumps_if_nil) {
+    if ((!ir_is(instr, "JUMPIFEQ") && !ir_is(instr, "JUMPIFNEQ")) || instr->operand_count != 3) return -1;
+    const char *tested;
+    if (strcmp(instr->operands[2], "nil@nil") == 0) {
+        tested = instr->operands[1];
+    } else if (strcmp(instr->operands[1], "nil@nil") == 0) {
+        tested = instr->operands[2];
+    } else {
+        return -1;
+    }
+    *jumps_if_nil = ir_is(instr, "JUMPIFEQ");
+    return var_index(&analysis->vars, tested, false);
+}
+
+/**
+ * @brief Collects the local variables and builds the control-flow graph.
+ */
+static void null_build_blocks(null_analysis_t *analysis, ir_list_t *code) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        for (int i = 0; i < instr->operand_count; i++) {
+            var_index(&analysis->vars, instr->operands[i], true);
+        }
+    }
+    analysis->cfg = cfg_build(code);
+    analysis->reached = calloc(analysis->cfg->block_count ? analysis->cfg->block_count : 1, sizeof(bool));
+    if (!analysis->reached) {
+        fprintf(stderr, "Error: Could not allocate memory for nullability analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Merges a state into the entry state of a block.
+ * @return True if the entry state changed.
+ */
+static bool null_merge(null_analysis_t *analysis, int block, const null_state_t *state) {
+    null_state_t *in = &analysis->in[block * analysis->vars.count];
+    bool changed = !analysis->reached[block];
+    analysis->reached[block] = true;
+    for (int i = 0; i < analysis->vars.count; i++) {
+        null_state_t joined = null_join(in[i], state[i]);
+        if (joined != in[i]) {
+            in[i] = joined;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Computes the state at the end of a block and propagates it to its successors.
+ * @return True if the entry state of any successor changed.
+ */
+static bool null_propagate(null_analysis_t *analysis, int b, null_state_t *state) {
+    cfg_block_t *block = &analysis->cfg->blocks[b];
+    memcpy(state, &analysis->in[b * analysis->vars.count], analysis->vars.count * sizeof(null_state_t));
+    analysis->stack_count = 0;
+    for (ir_instr_t *instr = block->first; instr; instr = instr->next) {
+        if (!instr->dead && instr != block->last) null_transfer(analysis, state, instr);
+        if (instr == block->last) break;
+    }
+
+    bool jumps_if_nil;
+    int tested = null_tested_var(analysis, block->last, &jumps_if_nil);
+    if (tested < 0) {
+        null_transfer(analysis, state, block->last);
+    }
+
+    bool changed = false;
+    for (int edge = 0; edge < 2; edge++) {
+        int target = block->successors[edge];
+        if (target < 0) continue;
+        if (tested < 0) {
+            changed |= null_merge(analysis, target, state);
+            continue;
+        }
+        // The tested variable is nil on the jump edge of JUMPIFEQ and on the fallthrough of JUMPIFNEQ
+        bool nil_edge = (edge == 1) == jumps_if_nil;
+        null_state_t required = nil_edge ? NULL_STATE_NIL : NULL_STATE_NON_NIL;
+        null_state_t saved = state[tested];
+        if (saved == NULL_STATE_NIL || saved == NULL_STATE_NON_NIL) {
+            if (saved != required) continue;   // Infeasible edge
+        }
+        state[tested] = required;
+        changed |= null_merge(analysis, target, state);
+        state[tested] = saved;
+    }
+    return changed;
+}
+
+static void null_free(null_analysis_t *analysis) {
+    var_free(&analysis->vars);
+    cfg_free(analysis->cfg);
+    free(analysis->reached);
+    free(analysis->in);
+    free(analysis->stack);
+}
+
+/**
+ * @brief Removes nil tests with a known outcome and code that became unreachable.
+ * @details A flow-sensitive analysis tracks for each local variable whether it is
+ *          nil, non-nil or unknown. Assignments of literals and results of operations
+ *          make variables non-nil and a comparison with nil refines the tested variable
+ *          on both outgoing edges. A test that always fails is dropped, one that always
+ *          succeeds becomes an unconditional jump and the branch it skips is removed
+ *          as dead code.
+ * @param code Instruction list of one function.
+ */
+void opt_nullability(ir_list_t *code) {
+    null_analysis_t analysis;
+    memset(&analysis, 0, sizeof(analysis));
+    null_build_blocks(&analysis, code);
+    int block_count = analysis.cfg->block_count;
+    if (block_count == 0 || analysis.vars.count == 0) {
+        null_free(&analysis);
+        return;
+    }
+
+    size_t state_size = analysis.vars.count * sizeof(null_state_t);
+    analysis.in = calloc(block_count, state_size);
+    null_state_t *state = malloc(state_size);
+    if (!analysis.in || !state) {
+        fprintf(stderr, "Error: Could not allocate memory for nullability analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Nothing is known about variables at the function entry
+    for (int i = 0; i < analysis.vars.count; i++) {
+        state[i] = NULL_STATE_UNKNOWN;
+    }
+    null_merge(&analysis, 0, state);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = 0; b < block_count; b++) {
+            if (analysis.reached[b]) {
+                changed |= null_propagate(&analysis, b, state);
+            }
+        }
+    }
+
+    for (int b = 0; b < block_count; b++) {
+        cfg_block_t *block = &analysis.cfg->blocks[b];
+        if (!analysis.reached[b]) {
+            // Dead code, labels are kept for jumps from other dead blocks
+            for (ir_instr_t *instr = block->first; instr; instr = instr->next) {
+                if (!ir_is(instr, "LABEL")) instr->dead = true;
+                if (instr == block->last) break;
+            }
+            continue;
+        }
+
+        bool jumps_if_nil;
+        int tested = null_tested_var(&analysis, block->last, &jumps_if_nil);
+        if (tested < 0) continue;
+        memcpy(state, &analysis.in[b * analysis.vars.count], state_size);
+        analysis.stack_count = 0;
+        for (ir_instr_t *instr = block->first; instr != block->last; instr = instr->next) {
+            if (!instr->dead) null_transfer(&analysis, state, instr);
+        }
+        if (state[tested] != NULL_STATE_NIL && state[tested] != NULL_STATE_NON_NIL) continue;
+
+        if ((state[tested] == NULL_STATE_NIL) == jumps_if_nil) {
+            ir_set_opcode(block->last, "JUMP");
+            free(block->last->operands[1]);
+            free(block->last->operands[2]);
+            block->last->operands[1] = block->last->operands[2] = NULL;
+            block->last->operand_count = 1;
+        } else {
+            block->last->dead = true;
+        }
+    }
+
+    free(state);
+    null_free(&analysis);
+    ir_sweep(code);
+}
+
+/**
+ * @brief Runs the optimization passes over all functions of the program.
+ * @details Functions are first specialized for constant arguments, then
+ *          optimized in order. Calls of pure functions with constant arguments
+ *          may be evaluated on the code of any other function. Functions left
+ *          without a chain of calls from main are removed at the end.
+ * @param header Header and built-in functions, the evaluated calls run them.
+ * @param functions Instruction lists of the user functions, clones are appended.
+ * @param count Number of functions, updated with the clones.
+ */
+void optimize_program(ir_list_t *header, ir_list_t ***functions, int *count) {
+    opt_specialize(functions, count);
+    ctfe_set_program(header, *functions, *count);
+    for (int i = 0; i < *count; i++) {
+        optimize_function((*functions)[i]);
+    }
+    ctfe_set_program(NULL, NULL, 0);
+    opt_merge_functions(functions, count);
+    opt_remove_unreachable_functions(functions, count);
+    for (int i = 0; i < spec_clone_count; i++) {
+        free(spec_clones[i].label);
+        free(spec_clones[i].signature);
+    }
+    free(spec_clones);
+    spec_clones = NULL;
+    spec_clone_count = spec_clone_capacity = 0;
+}
+
+/**
+ * @brief Runs all enabled optimization passes over one function.
+ * @param code Instruction list of the function.
+ */
+void optimize_function(ir_list_t *code) {
+    opt_nullability(code);
+    opt_constant_propagation(code);
+    opt_dead_stores(code);
+    opt_writes(code);
+    opt_dispatch_trees(code);
+    opt_jump_threading(code);
+    opt_local_value_numbering(code);
+    opt_allocate_frame_variables(code);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Conditional constant propagation                                          */
+/* ------------------------------------------------------------------------ */
+
+#define CCP_TOP     -2  // No definition reaches the point yet
+#define CCP_BOTTOM  -1  // Value is not a known constant
+
+typedef enum {
+    CCP_INT,
+    CCP_FLOAT,
+    CCP_BOOL,
+    CCP_NIL,
+    CCP_STRING,
+} ccp_kind_t;
+
+typedef struct {
+    ccp_kind_t kind;
+    long long i;
+    double f;
+    bool b;
+    const char *text;   // Whole operand, e.g. "string@abc"
+} ccp_value_t;
+
+typedef struct {
+    int value;          // CCP_TOP, CCP_BOTTOM or index of a constant
+    ir_instr_t *start;  // First instruction of a side-effect free computation of the value, or NULL
+} ccp_slot_t;
+
+typedef struct {
+    ir_list_t *code;
+    var_table_t vars;   // Local variables of the function
+    char **constants;   // Constant operands, values refer to them by index
+    int constant_count, constant_capacity;
+    cfg_t *cfg;
+    bool *executable;   // Block is reached by an edge that may be taken
+    int *in;            // Value of each variable at the entry of each block
+    ccp_slot_t *stack;
+    int stack_count, stack_capacity;
+} ccp_analysis_t;
+
+/**
+ * @brief Returns the index of a constant operand, adding it if needed.
+ */
+static int ccp_constant(ccp_analysis_t *analysis, const char *text) {
+    for (int i = 0; i < analysis->constant_count; i++) {
+        if (strcmp(analysis->constants[i], text) == 0) return i;
+    }
+    if (analysis->constant_count == analysis->constant_capacity) {
+        analysis->constants = lvn_grow(analysis->constants, &analysis->constant_capacity, sizeof(char *));
+    }
+    analysis->constants[analysis->constant_count] = malloc(strlen(text) + 1);
+    if (!analysis->constants[analysis->constant_count]) {
+        fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(analysis->constants[analysis->constant_count], text);
+    return analysis->constant_count++;
+}
+
+/**
+ * @brief Parses a literal operand.
+ * @return True if the operand is a literal of a supported type.
+ */
+static bool ccp_parse(const char *text, ccp_value_t *value) {
+    value->text = text;
+    if (strncmp(text, "int@", 4) == 0) {
+        value->kind = CCP_INT;
+        value->i = strtoll(text + 4, NULL, 10);
+    } else if (strncmp(text, "float@", 6) == 0) {
+        value->kind = CCP_FLOAT;
+        value->f = strtod(text + 6, NULL);
+    } else if (strncmp(text, "bool@", 5) == 0) {
+        value->kind = CCP_BOOL;
+        value->b = strcmp(text + 5, "true") == 0;
+    } else if (strcmp(text, "nil@nil") == 0) {
+        value->kind = CCP_NIL;
+    } else if (strncmp(text, "string@", 7) == 0) {
+        value->kind = CCP_STRING;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int ccp_int(ccp_analysis_t *analysis, long long number) {
+    if (number < INT_MIN || number > INT_MAX) return CCP_BOTTOM;
+    char text[32];
+    snprintf(text, sizeof(text), "int@%lld", number);
+    return ccp_constant(analysis, text);
+}
+
+static int ccp_float(ccp_analysis_t *analysis, double number) {
+    char text[64];
+    snprintf(text, sizeof(text), "float@%a", number);
+    return ccp_constant(analysis, text);
+}
+
+static int ccp_bool(ccp_analysis_t *analysis, bool value) {
+    return ccp_constant(analysis, value ? "bool@true" : "bool@false");
+}
+
+/**
+ * @brief Evaluates a stack instruction on constant arguments.
+ * @details Operations that would fail at run time, e.g. on mismatched types or
+ *          a division by zero, are not evaluated so the error is kept.
+ * @param op Stack instruction, e.g. "ADDS".
+ * @param args Arguments in the order they were pushed.
+ * @param arg_count Number of arguments.
+ * @return Index of the resulting constant, or CCP_BOTTOM.
+ */
+static int ccp_evaluate(ccp_analysis_t *analysis, const char *op, const int *args, int arg_count) {
+    ccp_value_t a, b;
+    for (int i = 0; i < arg_count; i++) {
+        if (args[i] < 0) return CCP_BOTTOM;
+    }
+    if (!ccp_parse(analysis->constants[args[0]], &a)) return CCP_BOTTOM;
+    if (arg_count == 1) {
+        if (strcmp(op, "NOTS") == 0 && a.kind == CCP_BOOL) return ccp_bool(analysis, !a.b);
+        if (strcmp(op, "INT2FLOATS") == 0 && a.kind == CCP_INT) return ccp_float(analysis, (double)a.i);
+        if (strcmp(op, "FLOAT2INTS") == 0 && a.kind == CCP_FLOAT && a.f > INT_MIN - 1.0 && a.f < INT_MAX + 1.0) {
+            return ccp_int(analysis, (long long)a.f);
+        }
+        return CCP_BOTTOM;
+    }
+    if (arg_count != 2 || !ccp_parse(analysis->constants[args[1]], &b)) return CCP_BOTTOM;
+
+    if (strcmp(op, "EQS") == 0) {
+        if (a.kind == CCP_NIL || b.kind == CCP_NIL) return ccp_bool(analysis, a.kind == b.kind);
+        if (a.kind != b.kind) return CCP_BOTTOM;
+        if (a.kind == CCP_FLOAT) return ccp_bool(analysis, a.f == b.f);
+        // Integers, booleans and encoded strings have a single spelling
+        return ccp_bool(analysis, strcmp(a.text, b.text) == 0);
+    }
+    if (a.kind != b.kind) return CCP_BOTTOM;
+
+    if (a.kind == CCP_INT) {
+        if (strcmp(op, "ADDS") == 0) return ccp_int(analysis, a.i + b.i);
+        if (strcmp(op, "SUBS") == 0) return ccp_int(analysis, a.i - b.i);
+        if (strcmp(op, "MULS") == 0) return ccp_int(analysis, a.i * b.i);
+        // Rounding of negative quotients is left to the interpreter
+        if (strcmp(op, "IDIVS") == 0 && a.i >= 0 && b.i > 0) return ccp_int(analysis, a.i / b.i);
+        if (strcmp(op, "LTS") == 0) return ccp_bool(analysis, a.i < b.i);
+        if (strcmp(op, "GTS") == 0) return ccp_bool(analysis, a.i > b.i);
+    } else if (a.kind == CCP_FLOAT) {
+        if (strcmp(op, "ADDS") == 0) return ccp_float(analysis, a.f + b.f);
+        if (strcmp(op, "SUBS") == 0) return ccp_float(analysis, a.f - b.f);
+        if (strcmp(op, "MULS") == 0) return ccp_float(analysis, a.f * b.f);
+        if (strcmp(op, "DIVS") == 0 && b.f != 0.0) return ccp_float(analysis, a.f / b.f);
+        if (strcmp(op, "LTS") == 0) return ccp_bool(analysis, a.f < b.f);
+        if (strcmp(op, "GTS") == 0) return ccp_bool(analysis, a.f > b.f);
+    } else if (a.kind == CCP_BOOL) {
+        if (strcmp(op, "ANDS") == 0) return ccp_bool(analysis, a.b && b.b);
+        if (strcmp(op, "ORS") == 0) return ccp_bool(analysis, a.b || b.b);
+        if (strcmp(op, "LTS") == 0) return ccp_bool(analysis, !a.b && b.b);
+        if (strcmp(op, "GTS") == 0) return ccp_bool(analysis, a.b && !b.b);
+    }
+    return CCP_BOTTOM;
+}
+
+/**
+ * @brief Decodes a string constant to its bytes.
+ * @details Only ASCII strings are decoded, the interpreter may count and index
+ *          other characters differently than bytes.
+ * @param text Operand "string@..." with \\ddd escape sequences.
+ * @param length Receives the number of bytes.
+ * @return Newly allocated bytes terminated by '\\0', or NULL.
+ */
+static char *ccp_decode_string(const char *text, size_t *length) {
+    text += strlen("string@");
+    char *bytes = malloc(strlen(text) + 1);
+    if (!bytes) {
+        fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n = 0;
+    while (*text) {
+        int c = (unsigned char)*text++;
+        if (c == '\\') {
+            if (!isdigit((unsigned char)text[0]) || !isdigit((unsigned char)text[1]) || !isdigit((unsigned char)text[2])) {
+                c = -1;
+            } else {
+                c = (text[0] - '0') * 100 + (text[1] - '0') * 10 + (text[2] - '0');
+                text += 3;
+            }
+        }
+        if (c < 0 || c > 127) {
+            free(bytes);
+            return NULL;
+        }
+        bytes[n++] = (char)c;
+    }
+    bytes[n] = '\0';
+    *length = n;
+    return bytes;
+}
+
+/**
+ * @brief Returns the index of a string constant, encoded like the scanner encodes literals.
+ */
+static int ccp_string(ccp_analysis_t *analysis, const char *bytes, size_t length) {
+    char *text = malloc(strlen("string@") + 4 * length + 1);
+    if (!text) {
+        fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *out = text + sprintf(text, "string@");
+    for (size_t i = 0; i < length; i++) {
+        int c = (unsigned char)bytes[i];
+        if (c <= 32 || c == '#' || c == '\\') {
+            out += sprintf(out, "\\%03d", c);
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    *out = '\0';
+    int index = ccp_constant(analysis, text);
+    free(text);
+    return index;
+}
+
+/**
+ * @brief Evaluates a pure built-in function on constant arguments.
+ * @details Follows the IFJ24 specification: ifj.ord gives 0 and ifj.substring
+ *          null for indices outside the string. Calls that fail at run time,
+ *          e.g. ifj.chr outside ASCII, are not evaluated.
+ * @param label Label of the built-in implementation, e.g. "$ifj_length".
+ * @param args Arguments in the order they were pushed.
+ * @param arg_count Number of arguments.
+ * @return Index of the returned constant, or CCP_BOTTOM.
+ */
+static int ccp_evaluate_builtin(ccp_analysis_t *analysis, const char *label, const int *args, int arg_count) {
+    ccp_value_t values[3];
+    char *strings[3] = { NULL, NULL, NULL };
+    size_t lengths[3] = { 0, 0, 0 };
+    int result = CCP_BOTTOM;
+
+    bool known = arg_count >= 1 && arg_count <= 3;
+    for (int i = 0; known && i < arg_count; i++) {
+        known = args[i] >= 0 && ccp_parse(analysis->constants[args[i]], &values[i]);
+        if (known && values[i].kind == CCP_STRING) {
+            strings[i] = ccp_decode_string(values[i].text, &lengths[i]);
+            known = strings[i] != NULL;
+        }
+    }
+
+    if (!known) {
+        result = CCP_BOTTOM;
+    } else if (strcmp(label, "$ifj_length") == 0 && strings[0]) {
+        result = ccp_int(analysis, (long long)lengths[0]);
+    } else if (strcmp(label, "$ifj_string") == 0 && strings[0]) {
+        result = args[0];
+    } else if (strcmp(label, "$ifj_i2f") == 0 && values[0].kind == CCP_INT) {
+        result = ccp_float(analysis, (double)values[0].i);
+    } else if (strcmp(label, "$ifj_f2i") == 0 && values[0].kind == CCP_FLOAT &&
+               values[0].f > INT_MIN - 1.0 && values[0].f < INT_MAX + 1.0) {
+        result = ccp_int(analysis, (long long)values[0].f);
+    } else if (strcmp(label, "$ifj_chr") == 0 && values[0].kind == CCP_INT &&
+               values[0].i >= 0 && values[0].i <= 127) {
+        char c = (char)values[0].i;
+        result = ccp_string(analysis, &c, 1);
+    } else if (strcmp(label, "$ifj_concat") == 0 && strings[0] && strings[1]) {
+        char *joined = malloc(lengths[0] + lengths[1] + 1);
+        if (!joined) {
+            fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(joined, strings[0], lengths[0]);
+        memcpy(joined + lengths[0], strings[1], lengths[1]);
+        result = ccp_string(analysis, joined, lengths[0] + lengths[1]);
+        free(joined);
+    } else if (strcmp(label, "$ifj_strcmp") == 0 && strings[0] && strings[1]) {
+        size_t common = lengths[0] < lengths[1] ? lengths[0] : lengths[1];
+        int order = memcmp(strings[0], strings[1], common);
+        if (order == 0) order = (lengths[0] > lengths[1]) - (lengths[0] < lengths[1]);
+        result = ccp_int(analysis, order < 0 ? -1 : order > 0);
+    } else if (strcmp(label, "$ifj_ord") == 0 && strings[0] && values[1].kind == CCP_INT) {
+        long long i = values[1].i;
+        bool inside = i >= 0 && i < (long long)lengths[0];
+        result = ccp_int(analysis, inside ? (unsigned char)strings[0][i] : 0);
+    } else if (strcmp(label, "$ifj_substring") == 0 && strings[0] &&
+               values[1].kind == CCP_INT && values[2].kind == CCP_INT) {
+        long long i = values[1].i, j = values[2].i, length = (long long)lengths[0];
+        if (i < 0 || j < 0 || i > j || i >= length || j > length) {
+            result = ccp_constant(analysis, "nil@nil");
+        } else {
+            result = ccp_string(analysis, strings[0] + i, (size_t)(j - i));
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        free(strings[i]);
+    }
+    return result;
+}
+
+/**
+ * @brief Returns what is known about an operand in the given state.
+ */
+static int ccp_operand(ccp_analysis_t *analysis, const int *state, const char *operand) {
+    int var = var_index(&analysis->vars, operand, false);
+    if (var >= 0) {
+        // Reading a variable no definition reaches fails at run time, assume nothing
+        return state[var] == CCP_TOP ? CCP_BOTTOM : state[var];
+    }
+    ccp_value_t value;
+    return ccp_parse(operand, &value) ? ccp_constant(analysis, operand) : CCP_BOTTOM;
+}
+
+static void ccp_push(ccp_analysis_t *analysis, int value, ir_instr_t *start) {
+    if (analysis->stack_count == analysis->stack_capacity) {
+        analysis->stack = lvn_grow(analysis->stack, &analysis->stack_capacity, sizeof(ccp_slot_t));
+    }
+    analysis->stack[analysis->stack_count].value = value;
+    analysis->stack[analysis->stack_count].start = start;
+    analysis->stack_count++;
+}
+
+static ccp_slot_t ccp_pop(ccp_analysis_t *analysis) {
+    if (analysis->stack_count > 0) return analysis->stack[--analysis->stack_count];
+    ccp_slot_t unknown = { CCP_BOTTOM, NULL };
+    return unknown;
+}
+
+/**
+ * @brief Checks that the instructions from start up to end only compute values on the stack.
+ */
+static bool ccp_is_pure_range(ir_instr_t *start, ir_instr_t *end) {
+    if (!start) return false;
+    for (ir_instr_t *instr = start; instr != end; instr = instr->next) {
+        if (!instr) return false;
+        if (!instr->dead && !ir_is(instr, "PUSHS") && lvn_stack_arity(instr->opcode) == 0) return false;
+    }
+    return true;
+}
+
+static void ccp_kill_range(ir_instr_t *start, ir_instr_t *end) {
+    for (ir_instr_t *instr = start; instr != end; instr = instr->next) {
+        instr->dead = true;
+    }
+}
+
+/**
+ * @brief Checks that the result of a call is pushed right after it, the only way generated code reads it.
+ */
+static bool ccp_pushes_return(ir_instr_t *call) {
+    ir_instr_t *next = call->next;
+    while (next && next->dead) next = next->next;
+    return next && ir_is(next, "PUSHS") && strcmp(next->operands[0], "GF@return") == 0;
+}
+
+/**
+ * @brief Evaluates a call of a pure user function whose arguments are constants.
+ * @details With rewrite set, the call and the code pushing its arguments are
+ *          removed if the call was evaluated.
+ * @return Index of the returned constant, or CCP_BOTTOM.
+ */
+static int ccp_call(ccp_analysis_t *analysis, ir_instr_t *call, int arity, bool rewrite) {
+    ccp_slot_t first = { CCP_BOTTOM, call };
+    char **args = malloc((arity ? arity : 1) * sizeof(char *));
+    if (!args) {
+        fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+        exit(EXIT_FAILURE);
+    }
+    bool known = true;
+    for (int j = arity - 1; j >= 0; j--) {
+        first = ccp_pop(analysis);
+        known = known && first.value >= 0;
+        args[j] = known ? analysis->constants[first.value] : NULL;
+    }
+
+    int returned = CCP_BOTTOM;
+    char *literal = known ? ctfe_call(analysis->code, call->operands[0], args, arity) : NULL;
+    ccp_value_t value;
+    if (literal && ccp_parse(literal, &value) && (value.kind != CCP_INT || (value.i >= INT_MIN && value.i <= INT_MAX))) {
+        returned = ccp_constant(analysis, literal);
+        // The call is only dropped together with the code computing its arguments
+        if (rewrite && ccp_is_pure_range(first.start, call)) {
+            ccp_kill_range(first.start, call);
+            call->dead = true;
+        }
+    }
+    free(literal);
+    free(args);
+    return returned;
+}
+
+/**
+ * @brief Turns a conditional jump with a known outcome into a JUMP, or removes it.
+ */
+static void ccp_resolve_branch(ir_instr_t *branch, bool taken) {
+    if (!taken) {
+        branch->dead = true;
+        return;
+    }
+    ir_set_opcode(branch, "JUMP");
+    for (int i = 1; i < branch->operand_count; i++) {
+        free(branch->operands[i]);
+        branch->operands[i] = NULL;
+    }
+    branch->operand_count = 1;
+}
+
+/**
+ * @brief Interprets one block on the abstract state.
+ * @details With rewrite set, constant operands are substituted, constant stack
+ *          computations are replaced by a single push and branches with a known
+ *          outcome are resolved.
+ * @param state Variable values at the entry, updated to the values at the exit.
+ * @param feasible Receives which of the two successor edges may be taken.
+ */
+static void ccp_block(ccp_analysis_t *analysis, int b, int *state, bool rewrite, bool feasible[2]) {
+    cfg_block_t *block = &analysis->cfg->blocks[b];
+    analysis->stack_count = 0;
+    feasible[0] = !ir_is(block->last, "JUMP");
+    feasible[1] = cfg_is_jump(block->last);
+    int returned = CCP_BOTTOM;  // Value of GF@return set by a call folded to a constant
+
+    for (ir_instr_t *instr = block->first; instr; instr = instr->next) {
+        bool is_last = instr == block->last;
+        if (instr->dead) {
+            if (is_last) break;
+            continue;
+        }
+        const char *op = instr->opcode;
+        int arity = lvn_stack_arity(op);
+        int decided = CCP_BOTTOM;
+        int folded_return = returned;
+        returned = CCP_BOTTOM;
+
+        if (ir_is(instr, "PUSHS")) {
+            int value = ccp_operand(analysis, state, instr->operands[0]);
+            if (strcmp(instr->operands[0], "GF@return") == 0) value = folded_return;
+            if (rewrite && value >= 0 && strcmp(instr->operands[0], analysis->constants[value]) != 0) {
+                ir_set_operand(instr, 0, analysis->constants[value]);
+            }
+            ccp_push(analysis, value, instr);
+        } else if (arity > 0) {
+            ccp_slot_t args[2];
+            int values[2];
+            for (int j = arity - 1; j >= 0; j--) {
+                args[j] = ccp_pop(analysis);
+                values[j] = args[j].value;
+            }
+            int result = ccp_evaluate(analysis, op, values, arity);
+            ir_instr_t *start = ccp_is_pure_range(args[0].start, instr) ? args[0].start : NULL;
+            if (rewrite && result >= 0 && start) {
+                ccp_kill_range(start, instr);
+                ir_set_opcode(instr, "PUSHS");
+                ir_set_operand(instr, 0, analysis->constants[result]);
+                for (int i = 1; i < instr->operand_count; i++) free(instr->operands[i]);
+                instr->operand_count = 1;
+                start = instr;
+            }
+            ccp_push(analysis, result, start);
+        } else if (ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+            ccp_slot_t rhs = ccp_pop(analysis);
+            ccp_slot_t lhs = ccp_pop(analysis);
+            int values[2] = { lhs.value, rhs.value };
+            decided = ccp_evaluate(analysis, "EQS", values, 2);
+            // The operands can only be dropped together with the code computing them
+            if (rewrite && decided >= 0 && !ccp_is_pure_range(lhs.start, instr)) decided = CCP_BOTTOM;
+            if (rewrite && decided >= 0) ccp_kill_range(lhs.start, instr);
+        } else if (ir_is(instr, "JUMPIFEQ") || ir_is(instr, "JUMPIFNEQ")) {
+            int values[2] = {
+                ccp_operand(analysis, state, instr->operands[1]),
+                ccp_operand(analysis, state, instr->operands[2]),
+            };
+            decided = ccp_evaluate(analysis, "EQS", values, 2);
+        } else if (ir_is(instr, "CLEARS")) {
+            analysis->stack_count = 0;
+        } else if (ir_is(instr, "CALL")) {
+            const builtin_info_t *builtin = builtin_lookup(instr->operands[0]);
+            if (builtin && builtin->pure && ccp_pushes_return(instr)) {
+                ccp_slot_t args[3];
+                int values[3];
+                for (int j = builtin->arity - 1; j >= 0; j--) {
+                    args[j] = ccp_pop(analysis);
+                    values[j] = args[j].value;
+                }
+                returned = ccp_evaluate_builtin(analysis, builtin->label, values, builtin->arity);
+                // The call is only dropped together with the code computing its arguments
+                if (rewrite && returned >= 0 && ccp_is_pure_range(args[0].start, instr)) {
+                    ccp_kill_range(args[0].start, instr);
+                    instr->dead = true;
+                }
+            } else {
+                arity = call_arity(instr->operands[0]);
+                if (arity < 0) analysis->stack_count = 0;
+                if (arity >= 0 && !builtin && ccp_pushes_return(instr) && ctfe_is_pure(instr->operands[0])) {
+                    returned = ccp_call(analysis, instr, arity, rewrite);
+                } else {
+                    for (int j = 0; j < arity; j++) ccp_pop(analysis);
+                }
+            }
+        } else if (instr->operand_count > 0 && !cfg_is_jump(instr) && !ir_is(instr, "WRITE") &&
+                   !ir_is(instr, "DPRINT") && !ir_is(instr, "EXIT")) {
+            int var = var_index(&analysis->vars, instr->operands[0], false);
+            int value = CCP_BOTTOM;
+            if (ir_is(instr, "POPS")) {
+                value = ccp_pop(analysis).value;
+            } else if (ir_is(instr, "MOVE")) {
+                value = ccp_operand(analysis, state, instr->operands[1]);
+                if (rewrite && value >= 0 && var_index(&analysis->vars, instr->operands[1], false) >= 0) {
+                    ir_set_operand(instr, 1, analysis->constants[value]);
+                }
+            } else if (ir_is(instr, "DEFVAR")) {
+                value = var >= 0 ? state[var] : CCP_BOTTOM;
+            } else if (instr->operand_count >= 2) {
+                // Three-address form of a stack instruction
+                char stack_op[16];
+                snprintf(stack_op, sizeof(stack_op), "%sS", op);
+                int stack_arity = lvn_stack_arity(stack_op);
+                if (stack_arity > 0 && stack_arity == instr->operand_count - 1) {
+                    int values[2];
+                    for (int j = 0; j < stack_arity; j++) {
+                        values[j] = ccp_operand(analysis, state, instr->operands[j + 1]);
+                    }
+                    value = ccp_evaluate(analysis, stack_op, values, stack_arity);
+                    if (rewrite && value >= 0) {
+                        ir_set_opcode(instr, "MOVE");
+                        ir_set_operand(instr, 1, analysis->constants[value]);
+                        if (instr->operand_count == 3) free(instr->operands[2]);
+                        instr->operand_count = 2;
+                    }
+                }
+            }
+            if (var >= 0) state[var] = value;
+        }
+
+        if (is_last && decided >= 0) {
+            bool taken = strcmp(analysis->constants[decided], "bool@true") == 0;
+            if (ir_is(instr, "JUMPIFNEQS") || ir_is(instr, "JUMPIFNEQ")) taken = !taken;
+            feasible[0] = !taken;
+            feasible[1] = taken;
+            if (rewrite) ccp_resolve_branch(instr, taken);
+        }
+        if (is_last) break;
+    }
+}
+
+/**
+ * @brief Merges a state into the entry state of a block and marks it executable.
+ * @return True if the block became executable or its entry state changed.
+ */
+static bool ccp_merge(ccp_analysis_t *analysis, int block, const int *state) {
+    int *in = &analysis->in[block * analysis->vars.count];
+    bool changed = !analysis->executable[block];
+    analysis->executable[block] = true;
+    for (int i = 0; i < analysis->vars.count; i++) {
+        int joined = in[i];
+        if (in[i] == CCP_TOP) {
+            joined = state[i];
+        } else if (state[i] != CCP_TOP && state[i] != in[i]) {
+            joined = CCP_BOTTOM;
+        }
+        if (joined != in[i]) {
+            in[i] = joined;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static void ccp_free(ccp_analysis_t *analysis) {
+    for (int i = 0; i < analysis->constant_count; i++) {
+        free(analysis->constants[i]);
+    }
+    var_free(&analysis->vars);
+    free(analysis->constants);
+    cfg_free(analysis->cfg);
+    free(analysis->executable);
+    free(analysis->in);
+    free(analysis->stack);
+}
+
+/**
+ * @brief Propagates constants through variables and across branches.
+ * @details Conditional constant propagation in the style of Wegman and Zadeck: a
+ *          block is only analysed once an edge that may be taken reaches it, and a
+ *          branch on a constant makes only one of its edges executable. Variables
+ *          assigned different constants on merging paths are not constant. Uses of
+ *          constant variables are replaced by the constants, constant computations
+ *          are folded, decided branches are resolved and blocks that never become
+ *          executable are removed.
+ * @param code Instruction list of one function.
+ */
+void opt_constant_propagation(ir_list_t *code) {
+    ccp_analysis_t analysis;
+    memset(&analysis, 0, sizeof(analysis));
+    analysis.code = code;
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        for (int i = 0; i < instr->operand_count && !instr->dead; i++) {
+            var_index(&analysis.vars, instr->operands[i], true);
+        }
+    }
+    analysis.cfg = cfg_build(code);
+    int block_count = analysis.cfg->block_count;
+    if (block_count == 0) {
+        ccp_free(&analysis);
+        return;
+    }
+
+    size_t state_size = (analysis.vars.count ? analysis.vars.count : 1) * sizeof(int);
+    analysis.in = malloc(block_count * state_size);
+    analysis.executable = calloc(block_count, sizeof(bool));
+    int *state = malloc(state_size);
+    if (!analysis.in || !analysis.executable || !state) {
+        fprintf(stderr, "Error: Could not allocate memory for constant propagation.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < block_count * analysis.vars.count; i++) {
+        analysis.in[i] = CCP_TOP;
+    }
+
+    // Local variables are defined inside the function, nothing reaches the entry
+    for (int i = 0; i < analysis.vars.count; i++) {
+        state[i] = CCP_TOP;
+    }
+    ccp_merge(&analysis, 0, state);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = 0; b < block_count; b++) {
+            if (!analysis.executable[b]) continue;
+            bool feasible[2];
+            memcpy(state, &analysis.in[b * analysis.vars.count], analysis.vars.count * sizeof(int));
+            ccp_block(&analysis, b, state, false, feasible);
+            for (int edge = 0; edge < 2; edge++) {
+                int target = analysis.cfg->blocks[b].successors[edge];
+                if (target >= 0 && feasible[edge]) changed |= ccp_merge(&analysis, target, state);
+            }
+        }
+    }
+
+    for (int b = 0; b < block_count; b++) {
+        cfg_block_t *block = &analysis.cfg->blocks[b];
+        if (!analysis.executable[b]) {
+            // Dead code, labels are kept for jumps from other dead blocks
+            for (ir_instr_t *instr = block->first; instr; instr = instr->next) {
+                if (!ir_is(instr, "LABEL")) instr->dead = true;
+                if (instr == block->last) break;
+            }
+            continue;
+        }
+        bool feasible[2];
+        memcpy(state, &analysis.in[b * analysis.vars.count], analysis.vars.count * sizeof(int));
+        ccp_block(&analysis, b, state, true, feasible);
+    }
+
+    free(state);
+    ccp_free(&analysis);
+    ir_sweep(code);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Jump threading                                                            */
+/* ------------------------------------------------------------------------ */
+
+static ir_instr_t *jump_find_label(ir_list_t *code, const char *label) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (!instr->dead && ir_is(instr, "LABEL") && strcmp(instr->operands[0], label) == 0) return instr;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the first live instruction after a run of labels, starting at the given instruction.
+ */
+static ir_instr_t *jump_skip_labels(ir_instr_t *instr) {
+    while (instr && (instr->dead || ir_is(instr, "LABEL"))) {
+        instr = instr->next;
+    }
+    return instr;
+}
+
+/**
+ * @brief Follows a label through unconditional jumps that directly follow it.
+ * @return Label the jump finally reaches, cycles of jumps stop after code->count hops.
+ */
+static const char *jump_final_target(ir_list_t *code, const char *label) {
+    for (int hops = 0; hops < code->count; hops++) {
+        ir_instr_t *target = jump_find_label(code, label);
+        ir_instr_t *next = target ? jump_skip_labels(target) : NULL;
+        if (!next || !ir_is(next, "JUMP") || strcmp(next->operands[0], label) == 0) break;
+        label = next->operands[0];
+    }
+    return label;
+}
+
+/**
+ * @brief Checks whether a label directly follows an instruction, possibly among other labels.
+ */
+static bool jump_falls_into(ir_instr_t *instr, const char *label) {
+    for (ir_instr_t *next = instr->next; next && (next->dead || ir_is(next, "LABEL")); next = next->next) {
+        if (!next->dead && strcmp(next->operands[0], label) == 0) return true;
+    }
+    return false;
+}
+
+static bool jump_is_referenced(ir_list_t *code, const char *label) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (!instr->dead && cfg_is_jump(instr) && strcmp(instr->operands[0], label) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Removes jumps to jumps, jumps to the next instruction and dead code around them.
+ * @details Jumps are retargeted to the final destination of chains of labels and
+ *          unconditional jumps, e.g. nested if ends. An unconditional jump to a
+ *          label that directly follows it is removed, as is code between an
+ *          unconditional jump, RETURN or EXIT and the next label. Labels no jump
+ *          refers to are removed, which can make more code unreachable, so the
+ *          steps repeat until nothing changes. The entry label is kept.
+ * @param code Instruction list of one function.
+ */
+void opt_jump_threading(ir_list_t *code) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        bool reachable = true;
+        for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+            if (instr->dead) continue;
+            if (ir_is(instr, "LABEL")) {
+                reachable = true;
+                continue;
+            }
+            if (!reachable) {
+                instr->dead = true;
+                changed = true;
+                continue;
+            }
+            if (cfg_is_jump(instr)) {
+                const char *target = jump_final_target(code, instr->operands[0]);
+                if (strcmp(target, instr->operands[0]) != 0) {
+                    ir_set_operand(instr, 0, target);
+                    changed = true;
+                }
+            }
+            if (ir_is(instr, "JUMP") && jump_falls_into(instr, instr->operands[0])) {
+                instr->dead = true;
+                changed = true;
+                continue;
+            }
+            if (ir_is(instr, "JUMP") || ir_is(instr, "RETURN") || ir_is(instr, "EXIT")) {
+                reachable = false;
+            }
+        }
+
+        for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+            if (instr != code->head && !instr->dead && ir_is(instr, "LABEL") && !jump_is_referenced(code, instr->operands[0])) {
+                instr->dead = true;
+                changed = true;
+            }
+        }
+    }
+    ir_sweep(code);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Output writes                                                             */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Returns the text a WRITE of a literal prints, in string literal encoding.
+ * @param operand Literal operand, e.g. "int@42" or "string@a\\032b".
+ * @return Malloc'd encoded text, or NULL for floats and non-literals.
+ */
+static char *write_literal_text(const char *operand) {
+    char number[32];
+    const char *text;
+    if (strncmp(operand, "string@", 7) == 0) {
+        text = operand + 7;
+    } else if (strncmp(operand, "int@", 4) == 0) {
+        snprintf(number, sizeof(number), "%lld", strtoll(operand + 4, NULL, 10));
+        text = number;
+    } else if (strncmp(operand, "bool@", 5) == 0) {
+        text = operand + 5;
+    } else if (strcmp(operand, "nil@nil") == 0) {
+        text = "";
+    } else {
+        return NULL;
+    }
+    char *copy = malloc(strlen(text) + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for a write literal.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(copy, text);
+    return copy;
+}
+
+/**
+ * @brief Replaces calls of ifj.write with WRITE and merges writes of literals.
+ * @details "PUSHS x; CALL $ifj_write" becomes "WRITE x" for a variable or
+ *          literal x, any other argument is popped into GF@temp and written
+ *          from there, so no frame is created per write. Directly following
+ *          writes of string, int, bool and nil literals are then joined into a
+ *          single WRITE of one string literal. Floats are written in the %a
+ *          format of the interpreter and are left alone.
+ * @param code Instruction list of one function.
+ */
+void opt_writes(ir_list_t *code) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (!ir_is(instr, "CALL") || strcmp(instr->operands[0], "$ifj_write") != 0) continue;
+        ir_instr_t *push = instr->prev;
+        ir_instr_t *write;
+        if (push && ir_is(push, "PUSHS")) {
+            write = ir_instr_create("WRITE", 1, push->operands[0]);
+            write->spaced = push->spaced;
+            ir_insert_before(code, push, write);
+            ir_remove(code, push);
+        } else {
+            ir_insert_before(code, instr, ir_instr_create("POPS", 1, "GF@temp"));
+            write = ir_instr_create("WRITE", 1, "GF@temp");
+            ir_insert_before(code, instr, write);
+        }
+        ir_remove(code, instr);
+        instr = write;
+
+        ir_instr_t *previous = write->prev;
+        char *text = write_literal_text(write->operands[0]);
+        char *previous_text = previous && ir_is(previous, "WRITE") ? write_literal_text(previous->operands[0]) : NULL;
+        if (text && previous_text) {
+            char *joined = malloc(strlen("string@") + strlen(previous_text) + strlen(text) + 1);
+            if (joined == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for a write literal.\n");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(joined, "string@%s%s", previous_text, text);
+            ir_set_operand(previous, 0, joined);
+            free(joined);
+            ir_remove(code, write);
+            instr = previous;
+        }
+        free(text);
+        free(previous_text);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Dispatch trees                                                            */
+/* ------------------------------------------------------------------------ */
+
+#define DISPATCH_MIN_CASES 4    // Shortest equality chain that is turned into a tree
+#define DISPATCH_LEAF_CASES 3   // Cases tested one by one at the leaves of the tree
+
+typedef struct {
+    long long value;
+    int order;                  // Position in the chain, the first test of a value wins
+    char target[96];            // Label entering the body of the case
+} dispatch_case_t;
+
+/**
+ * @brief Recognizes the test "if (var == constant)" of a chain.
+ * @details Matches PUSHS var, PUSHS int@c (either order), EQS, PUSHS bool@false,
+ *          JUMPIFEQS label, as generated for if conditions.
+ * @param instr First instruction of the test.
+ * @param var Receives the tested variable.
+ * @param value Receives the constant.
+ * @return Branch of the test, or NULL if the instructions are no such test.
+ */
+static ir_instr_t *dispatch_test(ir_instr_t *instr, const char **var, long long *value) {
+    ir_instr_t *code[5];
+    for (int i = 0; i < 5; i++) {
+        if (!instr) return NULL;
+        code[i] = instr;
+        instr = instr->next;
+    }
+    if (!ir_is(code[0], "PUSHS") || !ir_is(code[1], "PUSHS") || !ir_is(code[2], "EQS") ||
+        !ir_is(code[3], "PUSHS") || strcmp(code[3]->operands[0], "bool@false") != 0 ||
+        !ir_is(code[4], "JUMPIFEQS")) {
+        return NULL;
+    }
+    const char *a = code[0]->operands[0], *b = code[1]->operands[0];
+    const char *literal = strncmp(b, "int@", 4) == 0 ? b : a;
+    *var = literal == b ? a : b;
+    if (strncmp(literal, "int@", 4) != 0 || (strncmp(*var, "LF@", 3) != 0 && strncmp(*var, "GF@", 3) != 0)) {
+        return NULL;
+    }
+    char *end;
+    *value = strtoll(literal + 4, &end, 10);
+    return *end == '\0' ? code[4] : NULL;
+}
+
+static int dispatch_compare(const void *a, const void *b) {
+    const dispatch_case_t *x = a, *y = b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return x->order - y->order;
+}
+
+/**
+ * @brief Emits the comparison tree for a sorted range of cases.
+ * @details Ranges of up to DISPATCH_LEAF_CASES cases are tested one by one and
+ *          fall back to the default label. Larger ranges test the middle case,
+ *          jump to the lower half if the variable is less than it and continue
+ *          with the upper half otherwise.
+ */
+static void dispatch_emit(ir_list_t *code, ir_instr_t *pos, const char *var, dispatch_case_t *cases,
+                          int lo, int hi, const char *fallback, const char *prefix) {
+    char literal[32];
+    if (hi - lo + 1 <= DISPATCH_LEAF_CASES) {
+        for (int i = lo; i <= hi; i++) {
+            snprintf(literal, sizeof(literal), "int@%lld", cases[i].value);
+            ir_insert_before(code, pos, ir_instr_create("JUMPIFEQ", 3, cases[i].target, var, literal));
+        }
+        ir_insert_before(code, pos, ir_instr_create("JUMP", 1, fallback));
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    char lower[96];
+    snprintf(lower, sizeof(lower), "%.64s$lt%d", prefix, mid);
+    snprintf(literal, sizeof(literal), "int@%lld", cases[mid].value);
+    ir_insert_before(code, pos, ir_instr_create("LT", 3, "GF@temp", var, literal));
+    ir_insert_before(code, pos, ir_instr_create("JUMPIFEQ", 3, lower, "GF@temp", "bool@true"));
+    ir_insert_before(code, pos, ir_instr_create("JUMPIFEQ", 3, cases[mid].target, var, literal));
+    dispatch_emit(code, pos, var, cases, mid + 1, hi, fallback, prefix);
+    ir_insert_before(code, pos, ir_instr_create("LABEL", 1, lower));
+    dispatch_emit(code, pos, var, cases, lo, mid - 1, fallback, prefix);
+}
+
+/**
+ * @brief Lowers chains of equality tests on one variable to balanced comparison trees.
+ * @details A chain is a test "var == c1" whose else label leads, past other
+ *          labels only, to a test "var == c2" of the same variable, and so on;
+ *          this is the code of if/else-if chains. Nothing runs between the
+ *          tests, so the variable holds the same value in all of them. The first
+ *          test is replaced by a tree of LT and JUMPIFEQ over the sorted
+ *          constants, which jumps straight to the body of the first matching
+ *          case or to the else label of the last test, taking O(log n) tests
+ *          instead of O(n). A nil variable matches no case and goes to the
+ *          default directly, as LT would fail on it. The remaining tests are
+ *          left in place; jump threading removes them once nothing reaches them.
+ * @param code Instruction list of one function.
+ */
+void opt_dispatch_trees(ir_list_t *code) {
+    ir_instr_t **chained = NULL;
+    int chained_count = 0, chained_capacity = 0;
+
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        const char *var;
+        long long value;
+        ir_instr_t *branch = dispatch_test(instr, &var, &value);
+        bool seen = false;
+        for (int i = 0; i < chained_count && !seen; i++) {
+            seen = chained[i] == instr;
+        }
+        if (!branch || seen) continue;
+
+        dispatch_case_t *cases = NULL;
+        int count = 0;
+        ir_instr_t *test = instr;
+        const char *fallback = NULL;
+        while (true) {
+            const char *next_var;
+            long long next_value;
+            ir_instr_t *next_branch = test ? dispatch_test(test, &next_var, &next_value) : NULL;
+            if (!next_branch || strcmp(next_var, var) != 0) break;
+            bool repeated = false;
+            for (int i = 0; i < count && !repeated; i++) {
+                repeated = strcmp(cases[i].target, next_branch->operands[0]) == 0;
+            }
+            if (repeated) break;
+            cases = realloc(cases, (count + 1) * sizeof(dispatch_case_t));
+            if (cases == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for dispatch cases.\n");
+                exit(EXIT_FAILURE);
+            }
+            // The target temporarily holds the else label, to detect cycles
+            cases[count].value = next_value;
+            cases[count].order = count;
+            snprintf(cases[count].target, sizeof(cases[count].target), "%s", next_branch->operands[0]);
+            count++;
+            if (test != instr) {
+                if (chained_count == chained_capacity) {
+                    chained_capacity = chained_capacity ? 2 * chained_capacity : 16;
+                    chained = realloc(chained, chained_capacity * sizeof(ir_instr_t *));
+                    if (chained == NULL) {
+                        fprintf(stderr, "Error: Could not allocate memory for dispatch chains.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                chained[chained_count++] = test;
+            }
+            fallback = next_branch->operands[0];
+            ir_instr_t *label = jump_find_label(code, fallback);
+            test = label ? jump_skip_labels(label) : NULL;
+        }
+
+        if (count >= DISPATCH_MIN_CASES) {
+            char default_label[96], prefix[96], tested[96];
+            snprintf(default_label, sizeof(default_label), "%s", fallback);
+            snprintf(prefix, sizeof(prefix), "%s", cases[0].target);
+            // Give each case body an entry label right after its test
+            test = instr;
+            for (int i = 0; i < count; i++) {
+                const char *unused;
+                long long unused_value;
+                ir_instr_t *case_branch = dispatch_test(test, &unused, &unused_value);
+                char entry[96];
+                snprintf(entry, sizeof(entry), "%.64s$case%d", prefix, i);
+                ir_insert_after(code, case_branch, ir_instr_create("LABEL", 1, entry));
+                test = jump_skip_labels(jump_find_label(code, cases[i].target));
+                snprintf(cases[i].target, sizeof(cases[i].target), "%s", entry);
+            }
+            qsort(cases, count, sizeof(dispatch_case_t), dispatch_compare);
+            int unique = 0;
+            for (int i = 0; i < count; i++) {
+                if (unique == 0 || cases[unique - 1].value != cases[i].value) {
+                    cases[unique++] = cases[i];
+                }
+            }
+            count = unique;
+
+            ir_instr_t *first_branch = dispatch_test(instr, &var, &value);
+            ir_instr_t *pos = first_branch->next;
+            snprintf(tested, sizeof(tested), "%s", var);
+            ir_insert_before(code, pos, ir_instr_create("JUMPIFEQ", 3, default_label, tested, "nil@nil"));
+            dispatch_emit(code, pos, tested, cases, 0, count - 1, default_label, prefix);
+            ir_instr_t *old = instr;
+            instr = instr->prev;
+            for (int i = 0; i < 5; i++) {
+                ir_instr_t *next = old->next;
+                ir_remove(code, old);
+                old = next;
+            }
+        }
+        free(cases);
+        if (instr == NULL) instr = code->head;
+    }
+    free(chained);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Function specialization                                                   */
+/* ------------------------------------------------------------------------ */
+
+#define SPEC_MAX_INSTRUCTIONS   200     // Largest function that is cloned
+#define SPEC_MAX_CLONES         32      // Clones in the whole program
+
+static bool spec_is_literal(const char *operand) {
+    return strncmp(operand, "GF@", 3) != 0 && strncmp(operand, "LF@", 3) != 0 && strncmp(operand, "TF@", 3) != 0;
+}
+
+static int spec_find_function(ir_list_t **functions, int count, const char *label) {
+    for (int i = 0; i < count; i++) {
+        const ir_instr_t *head = functions[i]->head;
+        if (head && ir_is(head, "LABEL") && strcmp(head->operands[0], label) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds the pops of the parameters at the start of a function.
+ * @param pops Receives the pop of each parameter, the last parameter is popped first.
+ * @return True if the function starts with one pop per parameter.
+ */
+static bool spec_parameter_pops(ir_list_t *code, int arity, ir_instr_t **pops) {
+    int found = 0;
+    ir_instr_t *instr = code->head ? code->head->next : NULL;
+    for (; instr && found < arity; instr = instr->next) {
+        if (instr->dead || ir_is(instr, "CREATEFRAME") || ir_is(instr, "PUSHFRAME") || ir_is(instr, "DEFVAR")) continue;
+        if (!ir_is(instr, "POPS") || strncmp(instr->operands[0], "LF@", 3) != 0) return false;
+        pops[arity - 1 - found++] = instr;
+    }
+    return found == arity;
+}
+
+/**
+ * @brief Copies a function for the given constant arguments.
+ * @details Labels get the suffix of the clone so they stay unique in the program.
+ *          Pops of constant parameters become moves of the constants, the caller
+ *          no longer pushes them.
+ * @param args Literal of each constant argument, NULL for the others.
+ */
+static ir_list_t *spec_clone(ir_list_t *code, const char *label, int arity, char **args, ir_instr_t **pops) {
+    const char *suffix = strrchr(label, '$');
+    ir_list_t *clone = ir_list_create();
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (instr->dead) continue;
+        ir_instr_t *copy = ir_instr_copy(instr);
+        if (instr == code->head) {
+            ir_set_operand(copy, 0, label);
+        } else if (ir_is(instr, "LABEL") || cfg_is_jump(instr)) {
+            char *renamed = malloc(strlen(instr->operands[0]) + strlen(suffix) + 1);
+            if (!renamed) {
+                fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(renamed, "%s%s", instr->operands[0], suffix);
+            ir_set_operand(copy, 0, renamed);
+            free(renamed);
+        }
+        for (int j = 0; j < arity; j++) {
+            if (instr == pops[j] && args[j]) {
+                ir_set_opcode(copy, "MOVE");
+                ir_set_operand(copy, 1, args[j]);
+            }
+        }
+        ir_append(clone, copy);
+    }
+    return clone;
+}
+
+/**
+ * @brief Returns the label of the clone of a function for the given constant arguments, creating it if needed.
+ * @param callee Index of the called function.
+ * @param args Literal of each constant argument, NULL for the others.
+ * @return Label of the clone, or NULL if the function is not cloned.
+ */
+static const char *spec_clone_for(ir_list_t ***functions, int *count, int callee, char **args, int arity) {
+    ir_list_t *code = (*functions)[callee];
+    const char *callee_label = code->head->operands[0];
+    size_t length = strlen(callee_label) + 1;
+    for (int j = 0; j < arity; j++) {
+        length += (args[j] ? strlen(args[j]) : 1) + 1;
+    }
+    char *signature = malloc(length);
+    if (!signature) {
+        fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(signature, callee_label);
+    for (int j = 0; j < arity; j++) {
+        strcat(signature, " ");
+        strcat(signature, args[j] ? args[j] : "_");
+    }
+    for (int i = 0; i < spec_clone_count; i++) {
+        if (strcmp(spec_clones[i].signature, signature) == 0) {
+            free(signature);
+            return spec_clones[i].label;
+        }
+    }
+
+    int size = 0;
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (!instr->dead) size++;
+    }
+    ir_instr_t **pops = malloc((arity ? arity : 1) * sizeof(ir_instr_t *));
+    if (!pops) {
+        fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (spec_clone_count >= SPEC_MAX_CLONES || size > SPEC_MAX_INSTRUCTIONS || !spec_parameter_pops(code, arity, pops)) {
+        free(pops);
+        free(signature);
+        return NULL;
+    }
+
+    char label[64 + 16];
+    snprintf(label, sizeof(label), "%.64s$spec%d", callee_label, spec_clone_count);
+    ir_list_t *clone = spec_clone(code, label, arity, args, pops);
+    free(pops);
+
+    ir_list_t **grown = realloc(*functions, (*count + 1) * sizeof(ir_list_t *));
+    if (!grown) {
+        fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+        exit(EXIT_FAILURE);
+    }
+    *functions = grown;
+    (*functions)[(*count)++] = clone;
+
+    if (spec_clone_count == spec_clone_capacity) {
+        spec_clones = lvn_grow(spec_clones, &spec_clone_capacity, sizeof(spec_clone_t));
+    }
+    spec_clone_t *entry = &spec_clones[spec_clone_count++];
+    entry->label = malloc(strlen(label) + 1);
+    if (!entry->label) {
+        fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(entry->label, label);
+    entry->signature = signature;
+    entry->arity = 0;
+    for (int j = 0; j < arity; j++) {
+        if (!args[j]) entry->arity++;
+    }
+    return entry->label;
+}
+
+/**
+ * @brief Clones user functions for the constant arguments they are called with.
+ * @details A call with some arguments pushed as literals is retargeted to a clone
+ *          of the callee in which those parameters are constants, so constant
+ *          propagation can fold them and remove branches on them. Call sites with
+ *          the same constant arguments share a clone. Clones are appended to the
+ *          functions and their own calls are specialized as well, up to
+ *          SPEC_MAX_CLONES clones of functions of at most SPEC_MAX_INSTRUCTIONS
+ *          instructions.
+ * @param functions Instruction lists of the user functions.
+ * @param count Number of functions.
+ */
+void opt_specialize(ir_list_t ***functions, int *count) {
+    ir_instr_t **stack = NULL;  // Literal push of each stack slot, NULL if the value is not a literal
+    int stack_count = 0, stack_capacity = 0;
+
+    for (int f = 0; f < *count; f++) {
+        stack_count = 0;
+        for (ir_instr_t *instr = (*functions)[f]->head; instr; instr = instr->next) {
+            if (instr->dead) continue;
+            int pops = lvn_stack_arity(instr->opcode);
+            bool pushes = pops > 0;
+            ir_instr_t *pushed = NULL;
+
+            if (ir_is(instr, "LABEL") || ir_is(instr, "CLEARS")) {
+                // Values pushed on other paths are not known
+                stack_count = 0;
+            } else if (ir_is(instr, "PUSHS")) {
+                pushes = true;
+                if (spec_is_literal(instr->operands[0])) pushed = instr;
+            } else if (ir_is(instr, "POPS")) {
+                pops = 1;
+            } else if (ir_is(instr, "JUMPIFEQS") || ir_is(instr, "JUMPIFNEQS")) {
+                pops = 2;
+            } else if (ir_is(instr, "CALL")) {
+                const char *label = instr->operands[0];
+                pops = call_arity(label);
+                int callee = builtin_lookup(label) ? -1 : spec_find_function(*functions, *count, label);
+                if (pops < 0) {
+                    stack_count = 0;
+                } else if (callee >= 0 && pops > 0 && pops <= stack_count) {
+                    char **args = malloc(pops * sizeof(char *));
+                    if (!args) {
+                        fprintf(stderr, "Error: Could not allocate memory for function specialization.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    bool constant = false;
+                    for (int j = 0; j < pops; j++) {
+                        ir_instr_t *push = stack[stack_count - pops + j];
+                        args[j] = push ? push->operands[0] : NULL;
+                        constant |= push != NULL;
+                    }
+                    const char *clone = constant ? spec_clone_for(functions, count, callee, args, pops) : NULL;
+                    if (clone) {
+                        for (int j = 0; j < pops; j++) {
+                            if (args[j]) stack[stack_count - pops + j]->dead = true;
+                        }
+                        ir_set_operand(instr, 0, clone);
+                    }
+                    free(args);
+                }
+            }
+
+            if (pops > 0) stack_count = pops > stack_count ? 0 : stack_count - pops;
+            if (pushes) {
+                if (stack_count == stack_capacity) {
+                    stack = lvn_grow(stack, &stack_capacity, sizeof(ir_instr_t *));
+                }
+                stack[stack_count++] = pushed;
+            }
+        }
+        ir_sweep((*functions)[f]);
+    }
+    free(stack);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Identical function merging                                                */
+/* ------------------------------------------------------------------------ */
+
+typedef struct {
+    char *text;
+    size_t length, capacity;
+} merge_buffer_t;
+
+static void merge_append(merge_buffer_t *buffer, const char *text) {
+    size_t length = strlen(text);
+    if (buffer->length + length + 1 > buffer->capacity) {
+        buffer->capacity = 2 * (buffer->length + length + 1);
+        buffer->text = realloc(buffer->text, buffer->capacity);
+        if (buffer->text == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for function merging.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(buffer->text + buffer->length, text, length + 1);
+    buffer->length += length;
+}
+
+/**
+ * @brief Returns the position of a name in a list, adding it at the end if missing.
+ */
+static int merge_index(const char ***names, int *count, int *capacity, const char *name) {
+    for (int i = 0; i < *count; i++) {
+        if (strcmp((*names)[i], name) == 0) return i;
+    }
+    if (*count == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 16;
+        *names = realloc(*names, *capacity * sizeof(const char *));
+        if (*names == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for function merging.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    (*names)[*count] = name;
+    return (*count)++;
+}
+
+/**
+ * @brief Writes the code of a function without its own names.
+ * @details Local variables become LF@%vN and labels $LN, numbered in order
+ *          of first appearance, and calls of the function itself become
+ *          CALL $self, so functions differing only in these names get the
+ *          same text. Static types of DEFVARs are part of the text, as the
+ *          backends may use them.
+ * @return Malloc'd canonical text.
+ */
+static char *merge_canonical(const ir_list_t *code) {
+    merge_buffer_t buffer = { NULL, 0, 0 };
+    const char **vars = NULL, **labels = NULL;
+    int var_count = 0, var_capacity = 0, label_count = 0, label_capacity = 0;
+    const char *self = code->head->operands[0];
+
+    merge_append(&buffer, "");
+    for (const ir_instr_t *instr = code->head->next; instr; instr = instr->next) {
+        if (ir_is(instr, "LABEL")) {
+            merge_index(&labels, &label_count, &label_capacity, instr->operands[0]);
+        }
+    }
+    for (const ir_instr_t *instr = code->head->next; instr; instr = instr->next) {
+        merge_append(&buffer, instr->opcode);
+        for (int i = 0; i < instr->operand_count; i++) {
+            const char *operand = instr->operands[i];
+            char name[32];
+            if (i == 0 && ir_is(instr, "CALL") && strcmp(operand, self) == 0) {
+                snprintf(name, sizeof(name), "$self");
+                operand = name;
+            } else if (i == 0 && (ir_is(instr, "LABEL") || cfg_is_jump(instr))) {
+                int before = label_count;
+                int index = merge_index(&labels, &label_count, &label_capacity, operand);
+                if (index < before) {
+                    snprintf(name, sizeof(name), "$L%d", index);
+                    operand = name;
+                } else {
+                    label_count--;
+                }
+            } else if (strncmp(operand, "LF@", 3) == 0) {
+                snprintf(name, sizeof(name), "LF@%%v%d", merge_index(&vars, &var_count, &var_capacity, operand));
+                operand = name;
+            }
+            merge_append(&buffer, " ");
+            merge_append(&buffer, operand);
+        }
+        if (ir_is(instr, "DEFVAR") && instr->type != IR_TYPE_UNKNOWN) {
+            merge_append(&buffer, instr->type == IR_TYPE_INT ? " :int" : " :float");
+        }
+        merge_append(&buffer, "\n");
+    }
+    free(vars);
+    free(labels);
+    return buffer.text;
+}
+
+static unsigned long merge_hash(const char *text) {
+    unsigned long hash = 2166136261u;
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Merges functions whose code differs only in local names.
+ * @details Each function is hashed by its canonical text (see
+ *          merge_canonical()). A function equal to an earlier one is removed
+ *          and all calls of it are retargeted to the earlier one. Retargeted
+ *          calls can make callers equal in turn, so this repeats until no more
+ *          functions merge. The main function is always kept.
+ * @param functions Array of function code lists, shrunk in place.
+ * @param count Number of functions, updated.
+ */
+void opt_merge_functions(ir_list_t ***functions, int *count) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        char **texts = malloc(*count * sizeof(char *));
+        unsigned long *hashes = malloc(*count * sizeof(unsigned long));
+        if ((texts == NULL || hashes == NULL) && *count > 0) {
+            fprintf(stderr, "Error: Could not allocate memory for function merging.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < *count; i++) {
+            texts[i] = ir_is((*functions)[i]->head, "LABEL") ? merge_canonical((*functions)[i]) : NULL;
+            hashes[i] = texts[i] ? merge_hash(texts[i]) : 0;
+        }
+
+        for (int i = 0; i < *count; i++) {
+            if (texts[i] == NULL) continue;
+            const char *label = (*functions)[i]->head->operands[0];
+            if (strcmp(label, "$main") == 0) continue;
+            int original = -1;
+            for (int j = 0; j < i && original < 0; j++) {
+                if (texts[j] && hashes[j] == hashes[i] && strcmp(texts[j], texts[i]) == 0) original = j;
+            }
+            if (original < 0) continue;
+
+            const char *target = (*functions)[original]->head->operands[0];
+            for (int f = 0; f < *count; f++) {
+                if ((*functions)[f] == NULL) continue;
+                for (ir_instr_t *instr = (*functions)[f]->head; instr; instr = instr->next) {
+                    if (ir_is(instr, "CALL") && strcmp(instr->operands[0], label) == 0) {
+                        ir_set_operand(instr, 0, target);
+                    }
+                }
+            }
+            free(texts[i]);
+            texts[i] = NULL;
+            ir_list_free((*functions)[i]);
+            (*functions)[i] = NULL;
+            changed = true;
+        }
+
+        int kept = 0;
+        for (int i = 0; i < *count; i++) {
+            free(texts[i]);
+            if ((*functions)[i]) (*functions)[kept++] = (*functions)[i];
+        }
+        *count = kept;
+        free(texts);
+        free(hashes);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Unreachable function removal                                              */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Removes functions that no chain of calls from main reaches.
+ * @details Specialization retargets calls to clones and constant propagation
+ *          and merging remove or retarget more calls, so originals and clones
+ *          may be left without callers. The functions are kept in order.
+ * @param functions Array of function code lists, shrunk in place.
+ * @param count Number of functions, updated.
+ */
+void opt_remove_unreachable_functions(ir_list_t ***functions, int *count) {
+    int main_index = spec_find_function(*functions, *count, "$main");
+    if (main_index < 0) return;
+    bool *reached = calloc(*count ? *count : 1, sizeof(bool));
+    int *worklist = malloc((*count ? *count : 1) * sizeof(int));
+    if (!reached || !worklist) {
+        fprintf(stderr, "Error: Could not allocate memory for function removal.\n");
+        exit(EXIT_FAILURE);
+    }
+    int pending = 0;
+    reached[main_index] = true;
+    worklist[pending++] = main_index;
+    while (pending > 0) {
+        for (ir_instr_t *instr = (*functions)[worklist[--pending]]->head; instr; instr = instr->next) {
+            if (instr->dead || !ir_is(instr, "CALL")) continue;
+            int callee = spec_find_function(*functions, *count, instr->operands[0]);
+            if (callee >= 0 && !reached[callee]) {
+                reached[callee] = true;
+                worklist[pending++] = callee;
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < *count; i++) {
+        if (reached[i]) {
+            (*functions)[kept++] = (*functions)[i];
+        } else {
+            ir_list_free((*functions)[i]);
+        }
+    }
+    *count = kept;
+    free(reached);
+    free(worklist);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Frame variable allocation                                                 */
+/* ------------------------------------------------------------------------ */
+
+typedef uint64_t live_word_t;
+
+#define LIVE_WORD_BITS 64
+
+typedef struct {
+    var_table_t vars;   // Local variables of the function
+    cfg_t *cfg;
+    int words;          // Words of one set of variables
+    live_word_t *use;   // Variables read in a block before being written
+    live_word_t *def;   // Variables written in a block
+    live_word_t *in;    // Variables live at the entry of each block
+    live_word_t *out;   // Variables live at the exit of each block
+    live_word_t *interference;
+} live_analysis_t;
+
+// Instructions that write the variable in their first operand
+static const char *const live_writers[] = {
+    "MOVE", "POPS", "ADD", "SUB", "MUL", "DIV", "IDIV", "LT", "GT", "EQ", "AND", "OR", "NOT",
+    "INT2FLOAT", "FLOAT2INT", "INT2CHAR", "STRI2INT", "READ", "CONCAT", "STRLEN", "GETCHAR",
+    "SETCHAR", "TYPE",
+};
+
+static bool live_test(const live_word_t *set, int index) {
+    return (set[index / LIVE_WORD_BITS] >> (index % LIVE_WORD_BITS)) & 1;
+}
+
+static void live_set(live_word_t *set, int index) {
+    set[index / LIVE_WORD_BITS] |= (live_word_t)1 << (index % LIVE_WORD_BITS);
+}
+
+static void live_clear(live_word_t *set, int index) {
+    set[index / LIVE_WORD_BITS] &= ~((live_word_t)1 << (index % LIVE_WORD_BITS));
+}
+
+static live_word_t *live_alloc(size_t words) {
+    live_word_t *set = calloc(words ? words : 1, sizeof(live_word_t));
+    if (!set) {
+        fprintf(stderr, "Error: Could not allocate memory for liveness analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+    return set;
+}
+
+/**
+ * @brief Returns the local variable written by an instruction, or -1.
+ */
+static int live_written(live_analysis_t *analysis, const ir_instr_t *instr) {
+    if (instr->operand_count == 0) return -1;
+    for (size_t i = 0; i < sizeof(live_writers) / sizeof(live_writers[0]); i++) {
+        if (ir_is(instr, live_writers[i])) return var_index(&analysis->vars, instr->operands[0], false);
+    }
+    return -1;
+}
+
+/**
+ * @brief Adds the local variables read by an instruction to a set.
+ */
+static void live_add_reads(live_analysis_t *analysis, const ir_instr_t *instr, live_word_t *set) {
+    if (ir_is(instr, "DEFVAR")) return;
+    bool writes = live_written(analysis, instr) >= 0;
+    // SETCHAR modifies its destination string, so it reads it as well
+    int first = writes && !ir_is(instr, "SETCHAR") ? 1 : 0;
+    for (int i = first; i < instr->operand_count; i++) {
+        int var = var_index(&analysis->vars, instr->operands[i], false);
+        if (var >= 0) live_set(set, var);
+    }
+}
+
+static void live_build_blocks(live_analysis_t *analysis, ir_list_t *code) {
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        for (int i = 0; i < instr->operand_count; i++) {
+            var_index(&analysis->vars, instr->operands[i], true);
+        }
+    }
+    analysis->cfg = cfg_build(code);
+}
+
+/**
+ * @brief Computes the variables live at the entry and exit of each block.
+ */
+static void live_solve(live_analysis_t *analysis) {
+    int words = analysis->words;
+    analysis->use = live_alloc((size_t)analysis->cfg->block_count * words);
+    analysis->def = live_alloc((size_t)analysis->cfg->block_count * words);
+    analysis->in = live_alloc((size_t)analysis->cfg->block_count * words);
+    analysis->out = live_alloc((size_t)analysis->cfg->block_count * words);
+
+    for (int b = 0; b < analysis->cfg->block_count; b++) {
+        live_word_t *use = &analysis->use[b * words];
+        live_word_t *def = &analysis->def[b * words];
+        cfg_block_t *block = &analysis->cfg->blocks[b];
+        for (ir_instr_t *instr = block->last; ; instr = instr->prev) {
+            int written = live_written(analysis, instr);
+            if (written >= 0) {
+                live_set(def, written);
+                live_clear(use, written);
+            }
+            live_add_reads(analysis, instr, use);
+            if (instr == block->first) break;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = analysis->cfg->block_count - 1; b >= 0; b--) {
+            live_word_t *out = &analysis->out[b * words];
+            live_word_t *in = &analysis->in[b * words];
+            for (int s = 0; s < 2; s++) {
+                int successor = analysis->cfg->blocks[b].successors[s];
+                if (successor < 0) continue;
+                for (int w = 0; w < words; w++) {
+                    out[w] |= analysis->in[successor * words + w];
+                }
+            }
+            for (int w = 0; w < words; w++) {
+                live_word_t updated = analysis->use[b * words + w] | (out[w] & ~analysis->def[b * words + w]);
+                if (updated != in[w]) {
+                    in[w] = updated;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+static void live_interfere(live_analysis_t *analysis, int a, int b) {
+    if (a == b) return;
+    live_set(&analysis->interference[a * analysis->words], b);
+    live_set(&analysis->interference[b * analysis->words], a);
+}
+
+/**
+ * @brief Records which variables hold values at the same time.
+ * @details A written variable interferes with everything live after the write,
+ *          except the source of a MOVE, which may share its slot.
+ */
+static void live_build_interference(live_analysis_t *analysis) {
+    int words = analysis->words;
+    analysis->interference = live_alloc((size_t)analysis->vars.count * words);
+    live_word_t *live = live_alloc(words);
+
+    for (int b = 0; b < analysis->cfg->block_count; b++) {
+        cfg_block_t *block = &analysis->cfg->blocks[b];
+        memcpy(live, &analysis->out[b * words], words * sizeof(live_word_t));
+        for (ir_instr_t *instr = block->last; ; instr = instr->prev) {
+            int written = live_written(analysis, instr);
+            if (written >= 0) {
+                int source = ir_is(instr, "MOVE") ? var_index(&analysis->vars, instr->operands[1], false) : -1;
+                for (int v = 0; v < analysis->vars.count; v++) {
+                    if (v != source && live_test(live, v)) live_interfere(analysis, written, v);
+                }
+                live_clear(live, written);
+            }
+            live_add_reads(analysis, instr, live);
+            if (instr == block->first) break;
+        }
+    }
+
+    // Variables read before any write all hold their initial value at the entry
+    if (analysis->cfg->block_count > 0) {
+        for (int a = 0; a < analysis->vars.count; a++) {
+            if (!live_test(analysis->in, a)) continue;
+            for (int b = a + 1; b < analysis->vars.count; b++) {
+                if (live_test(analysis->in, b)) live_interfere(analysis, a, b);
+            }
+        }
+    }
+    free(live);
+}
+
+static void live_free(live_analysis_t *analysis) {
+    var_free(&analysis->vars);
+    cfg_free(analysis->cfg);
+    free(analysis->use);
+    free(analysis->def);
+    free(analysis->in);
+    free(analysis->out);
+    free(analysis->interference);
+}
+
+/**
+ * @brief Lets local variables with disjoint lifetimes share one frame variable.
+ * @details Computes liveness over the basic blocks of the function, builds the
+ *          interference graph and colors it greedily in the order of first use.
+ *          Every color becomes one frame variable named after its first member,
+ *          defined once after PUSHFRAME instead of by the scattered DEFVARs,
+ *          with the static type its members share, if any.
+ * @param code Instructions of one function.
+ */
+void opt_allocate_frame_variables(ir_list_t *code) {
+    ir_sweep(code);
+    live_analysis_t analysis;
+    memset(&analysis, 0, sizeof(analysis));
+    live_build_blocks(&analysis, code);
+    if (analysis.vars.count == 0) {
+        live_free(&analysis);
+        return;
+    }
+    analysis.words = (analysis.vars.count + LIVE_WORD_BITS - 1) / LIVE_WORD_BITS;
+    live_solve(&analysis);
+    live_build_interference(&analysis);
+
+    int *slot = malloc(analysis.vars.count * sizeof(int));
+    int *representative = malloc(analysis.vars.count * sizeof(int));
+    bool *taken = malloc(analysis.vars.count * sizeof(bool));
+    if (!slot || !representative || !taken) {
+        fprintf(stderr, "Error: Could not allocate memory for frame variables.\n");
+        exit(EXIT_FAILURE);
+    }
+    int slot_count = 0;
+    for (int v = 0; v < analysis.vars.count; v++) {
+        memset(taken, 0, analysis.vars.count * sizeof(bool));
+        for (int u = 0; u < v; u++) {
+            if (live_test(&analysis.interference[v * analysis.words], u)) taken[slot[u]] = true;
+        }
+        slot[v] = 0;
+        while (taken[slot[v]]) slot[v]++;
+        if (slot[v] == slot_count) {
+            representative[slot_count++] = v;
+        }
+    }
+
+    // A variable has the type of its DEFVARs, and a slot keeps it only when
+    // all its members agree. A variable without DEFVAR has no known type.
+    int *var_type = malloc(analysis.vars.count * sizeof(int));
+    ir_type_t *slot_type = malloc(analysis.vars.count * sizeof(ir_type_t));
+    if (!var_type || !slot_type) {
+        fprintf(stderr, "Error: Could not allocate memory for frame variables.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < analysis.vars.count; v++) {
+        var_type[v] = -1;
+    }
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        int var = ir_is(instr, "DEFVAR") ? var_index(&analysis.vars, instr->operands[0], false) : -1;
+        if (var < 0) continue;
+        var_type[var] = var_type[var] < 0 || var_type[var] == (int)instr->type ? (int)instr->type : IR_TYPE_UNKNOWN;
+    }
+    for (int v = 0; v < analysis.vars.count; v++) {
+        ir_type_t type = var_type[v] < 0 ? IR_TYPE_UNKNOWN : (ir_type_t)var_type[v];
+        if (representative[slot[v]] == v) {
+            slot_type[slot[v]] = type;
+        } else if (slot_type[slot[v]] != type) {
+            slot_type[slot[v]] = IR_TYPE_UNKNOWN;
+        }
+    }
+
+    ir_instr_t *prologue = code->head;
+    while (prologue && !ir_is(prologue, "PUSHFRAME")) {
+        prologue = prologue->next;
+    }
+
+    ir_instr_t *instr = code->head;
+    while (instr) {
+        ir_instr_t *next = instr->next;
+        for (int i = 0; i < instr->operand_count; i++) {
+            int var = var_index(&analysis.vars, instr->operands[i], false);
+            if (var >= 0 && representative[slot[var]] != var) {
+                ir_set_operand(instr, i, analysis.vars.names[representative[slot[var]]]);
+            }
+        }
+        bool self_move = ir_is(instr, "MOVE") && strcmp(instr->operands[0], instr->operands[1]) == 0;
+        if ((ir_is(instr, "DEFVAR") && var_index(&analysis.vars, instr->operands[0], false) >= 0) || self_move) {
+            ir_remove(code, instr);
+        }
+        instr = next;
+    }
+
+    for (int s = slot_count - 1; s >= 0; s--) {
+        ir_instr_t *defvar = ir_instr_create("DEFVAR", 1, analysis.vars.names[representative[s]]);
+        defvar->type = slot_type[s];
+        ir_insert_after(code, prologue, defvar);
+    }
+
+    free(var_type);
+    free(slot_type);
+    free(slot);
+    free(representative);
+    free(taken);
+    live_free(&analysis);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Dead store elimination                                                    */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Removes stores to local variables that are never read afterwards.
+ * @details Computes liveness over the basic blocks of the function and walks
+ *          each block backwards. A MOVE to a dead variable is removed, and so
+ *          is a POPS to a dead variable together with the PUSHS right before
+ *          it. Removed stores read nothing, so stores feeding only them die as
+ *          well, and liveness is recomputed until nothing more is removed.
+ *          Other writes may fail at run time and are kept.
+ * @param code Instructions of one function.
+ */
+void opt_dead_stores(ir_list_t *code) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ir_sweep(code);
+        live_analysis_t analysis;
+        memset(&analysis, 0, sizeof(analysis));
+        live_build_blocks(&analysis, code);
+        if (analysis.vars.count == 0) {
+            live_free(&analysis);
+            return;
+        }
+        analysis.words = (analysis.vars.count + LIVE_WORD_BITS - 1) / LIVE_WORD_BITS;
+        live_solve(&analysis);
+
+        live_word_t *live = live_alloc(analysis.words);
+        for (int b = 0; b < analysis.cfg->block_count; b++) {
+            cfg_block_t *block = &analysis.cfg->blocks[b];
+            memcpy(live, &analysis.out[b * analysis.words], analysis.words * sizeof(live_word_t));
+            for (ir_instr_t *instr = block->last; ; instr = instr->prev) {
+                if (!instr->dead) {
+                    int written = live_written(&analysis, instr);
+                    ir_instr_t *push = instr != block->first ? instr->prev : NULL;
+                    bool dead = written >= 0 && !live_test(live, written) &&
+                                (ir_is(instr, "MOVE") || (ir_is(instr, "POPS") && push && ir_is(push, "PUSHS")));
+                    if (dead) {
+                        instr->dead = true;
+                        if (ir_is(instr, "POPS")) push->dead = true;
+                        changed = true;
+                    } else {
+                        if (written >= 0) live_clear(live, written);
+                        live_add_reads(&analysis, instr, live);
+                    }
+                }
+                if (instr == block->first) break;
+            }
+        }
+        free(live);
+        live_free(&analysis);
+    }
+    ir_sweep(code);
+}
+
+/* ------------------------------------------------------------------------ */
+/* String pool                                                               */
+/* ------------------------------------------------------------------------ */
+
+#define POOL_MIN_LENGTH 16  // Encoded length from which a single literal is pooled
+#define POOL_MIN_USES 3     // Uses from which a shorter literal is pooled
+
+typedef struct {
+    ir_instr_t *instr;
+    int index;                  // Operand holding the literal
+} pool_use_t;
+
+static int pool_compare(const void *a, const void *b) {
+    const pool_use_t *x = a, *y = b;
+    return strcmp(x->instr->operands[x->index], y->instr->operands[y->index]);
+}
+
+/**
+ * @brief Moves string literals into global variables defined once at program start.
+ * @details Literals whose encoded text has at least POOL_MIN_LENGTH characters
+ *          or that are used at least POOL_MIN_USES times across all functions
+ *          are defined as GF@_strN by a DEFVAR and MOVE inserted before pos,
+ *          and every use refers to the variable instead. A literal is only
+ *          pooled if that makes the output smaller. String literals only
+ *          appear as source operands, so any use can read the variable.
+ * @param functions Code of all functions.
+ * @param count Number of functions.
+ * @param header List receiving the definitions.
+ * @param pos Instruction of the header the definitions are inserted before.
+ * @return Number of bytes the output shrank by.
+ */
+long opt_string_pool(ir_list_t **functions, int count, ir_list_t *header, ir_instr_t *pos) {
+    pool_use_t *uses = NULL;
+    int use_count = 0, use_capacity = 0;
+    for (int f = 0; f < count; f++) {
+        for (ir_instr_t *instr = functions[f]->head; instr; instr = instr->next) {
+            for (int i = 0; i < instr->operand_count; i++) {
+                if (strncmp(instr->operands[i], "string@", 7) != 0 || instr->operands[i][7] == '\0') continue;
+                if (use_count == use_capacity) {
+                    use_capacity = use_capacity ? 2 * use_capacity : 64;
+                    uses = realloc(uses, use_capacity * sizeof(pool_use_t));
+                    if (uses == NULL) {
+                        fprintf(stderr, "Error: Could not allocate memory for the string pool.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                uses[use_count].instr = instr;
+                uses[use_count].index = i;
+                use_count++;
+            }
+        }
+    }
+    if (use_count > 0) {
+        qsort(uses, use_count, sizeof(pool_use_t), pool_compare);
+    }
+
+    long saved = 0;
+    int pooled = 0;
+    for (int first = 0, last; first < use_count; first = last) {
+        const char *literal = uses[first].instr->operands[uses[first].index];
+        last = first + 1;
+        while (last < use_count && pool_compare(&uses[first], &uses[last]) == 0) {
+            last++;
+        }
+        long literal_length = (long)strlen(literal);
+        long occurrences = last - first;
+        if (literal_length - 7 < POOL_MIN_LENGTH && occurrences < POOL_MIN_USES) continue;
+
+        char name[32];
+        snprintf(name, sizeof(name), "GF@_str%d", pooled);
+        long name_length = (long)strlen(name);
+        // "DEFVAR name\n" and "MOVE name literal\n" against the literals replaced by the name
+        long definition = 7 + name_length + 1 + 5 + name_length + 1 + literal_length + 1;
+        long gain = occurrences * (literal_length - name_length) - definition;
+        if (gain <= 0) continue;
+
+        ir_insert_before(header, pos, ir_instr_create("DEFVAR", 1, name));
+        ir_insert_before(header, pos, ir_instr_create("MOVE", 2, name, literal));
+        for (int i = first; i < last; i++) {
+            ir_set_operand(uses[i].instr, uses[i].index, name);
+        }
+        saved += gain;
+        pooled++;
+    }
+    free(uses);
+    return saved;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Compact names                                                             */
+/* ------------------------------------------------------------------------ */
+
+typedef struct {
+    char *original;
+    char *compact;
+} compact_name_t;
+
+typedef struct {
+    compact_name_t *names;
+    int name_count, name_capacity;
+} compact_table_t;
+
+// Labels are global in IFJcode24, so their numbering continues across functions
+static int compact_label_count = 0;
+
+static const char *compact_find(const compact_table_t *table, const char *original) {
+    for (int i = 0; i < table->name_count; i++) {
+        if (strcmp(table->names[i].original, original) == 0) return table->names[i].compact;
+    }
+    return NULL;
+}
+
+static const char *compact_add(compact_table_t *table, const char *original, const char *compact) {
+    if (table->name_count == table->name_capacity) {
+        table->names = lvn_grow(table->names, &table->name_capacity, sizeof(compact_name_t));
+    }
+    compact_name_t *name = &table->names[table->name_count++];
+    name->original = malloc(strlen(original) + 1);
+    name->compact = malloc(strlen(compact) + 1);
+    if (!name->original || !name->compact) {
+        fprintf(stderr, "Error: Could not allocate memory for compact names.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(name->original, original);
+    strcpy(name->compact, compact);
+    return name->compact;
+}
+
+static void compact_free(compact_table_t *table) {
+    for (int i = 0; i < table->name_count; i++) {
+        free(table->names[i].original);
+        free(table->names[i].compact);
+    }
+    free(table->names);
+}
+
+/**
+ * @brief Writes a number in the base given by the number of digits.
+ * @details A bijective numbering has no zero digit, so with letters as digits
+ *          "z" is followed by "aa".
+ */
+static void compact_encode(int number, const char *digits, bool bijective, char *out) {
+    int base = (int)strlen(digits);
+    char reversed[16];
+    int length = 0;
+    do {
+        reversed[length++] = digits[number % base];
+        number = number / base - (bijective ? 1 : 0);
+    } while (bijective ? number >= 0 : number > 0);
+    for (int i = 0; i < length; i++) {
+        out[i] = reversed[length - 1 - i];
+    }
+    out[length] = '\0';
+}
+
+/**
+ * @brief Renames local variables and labels of a function to short names.
+ * @details Local variables become LF@a, LF@b, ... in order of first use and labels
+ *          inside the function become $% followed by a base-36 number. The function
+ *          label itself and called labels are kept.
+ * @param code Instructions of one function.
+ * @param map Stream for the map of compact names to original names, or NULL.
+ */
+void opt_compact_names(ir_list_t *code, FILE *map) {
+    compact_table_t labels = {0};
+    compact_table_t locals = {0};
+    ir_instr_t *entry = ir_is(code->head, "LABEL") ? code->head : NULL;
+    char compact[32];
+
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        if (instr != entry && ir_is(instr, "LABEL") && !compact_find(&labels, instr->operands[0])) {
+            strcpy(compact, "$%");
+            compact_encode(compact_label_count++, "0123456789abcdefghijklmnopqrstuvwxyz", false, compact + 2);
+            compact_add(&labels, instr->operands[0], compact);
+        }
+    }
+
+    for (ir_instr_t *instr = code->head; instr; instr = instr->next) {
+        bool has_label = instr != entry && (ir_is(instr, "LABEL") || strncmp(instr->opcode, "JUMP", 4) == 0);
+        for (int i = 0; i < instr->operand_count; i++) {
+            const char *operand = instr->operands[i];
+            const char *renamed = NULL;
+            if (i == 0 && has_label) {
+                renamed = compact_find(&labels, operand);
+            } else if (strncmp(operand, "LF@", 3) == 0) {
+                renamed = compact_find(&locals, operand);
+                if (!renamed) {
+                    strcpy(compact, "LF@");
+                    compact_encode(locals.name_count, "abcdefghijklmnopqrstuvwxyz", true, compact + 3);
+                    renamed = compact_add(&locals, operand, compact);
+                }
+            }
+            if (renamed) {
+                ir_set_operand(instr, i, renamed);
+            }
+        }
+    }
+
+    if (map) {
+        const char *function = entry ? entry->operands[0] : "";
+        for (int i = 0; i < locals.name_count; i++) {
+            fprintf(map, "%s %s %s\n", function, locals.names[i].compact, locals.names[i].original);
+        }
+        for (int i = 0; i < labels.name_count; i++) {
+            fprintf(map, "%s %s %s\n", function, labels.names[i].compact, labels.names[i].original);
+        }
+    }
+
+    compact_free(&labels);
+    compact_free(&locals);
+}
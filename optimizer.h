@@ -0,0 +1,37 @@
+/**
+ * IFJ24
+ * @brief Header for optimization passes over the generated IFJcode24 code.
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ir.h"
+
+typedef struct {
+    const char *label;      // Label of the generated implementation, e.g. "$ifj_length"
+    int arity;              // Number of arguments popped from the data stack
+    bool pure;              // No side effects, result depends only on the arguments
+} builtin_info_t;
+
+const builtin_info_t *builtin_lookup(const char *label);
+int call_arity(const char *label);
+void optimize_program(ir_list_t *header, ir_list_t ***functions, int *count);
+void optimize_function(ir_list_t *code);
+void opt_local_value_numbering(ir_list_t *code);
+void opt_nullability(ir_list_t *code);
+void opt_constant_propagation(ir_list_t *code);
+void opt_dead_stores(ir_list_t *code);
+void opt_jump_threading(ir_list_t *code);
+void opt_dispatch_trees(ir_list_t *code);
+void opt_writes(ir_list_t *code);
+void opt_specialize(ir_list_t ***functions, int *count);
+void opt_merge_functions(ir_list_t ***functions, int *count);
+void opt_remove_unreachable_functions(ir_list_t ***functions, int *count);
+void opt_allocate_frame_variables(ir_list_t *code);
+long opt_string_pool(ir_list_t **functions, int count, ir_list_t *header, ir_instr_t *pos);
+void opt_compact_names(ir_list_t *code, FILE *map);
+
+#endif
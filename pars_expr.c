@@ -2,6 +2,8 @@
 /// @brief Parser implementation for expression parsing and reduction in IFJ24.
 
 #include "pars_expr.h"
+#include <limits.h>
+#include <string.h>
 
 extern symtable_t *symbol_table;
 int bracket_count;
@@ -133,43 +135,95 @@ int token_to_prec_symb(StackData *data) {
 }
 
 /**
- * @brief Validates type compatibility for arithmetic operations.
+ * @brief Converts a literal operand to the given numeric type at compile time.
+ * @details Only an operand consisting of a single literal push can be converted, its
+ *          operand is rewritten in place. An f64 literal converts to i32 only if it
+ *          has no fractional part.
+ * @param operand Reduced operand expression.
+ * @param target Type to convert to, int_type or float_type.
+ * @return True if the literal was converted.
+ */
+static bool convert_literal_operand(StackData *operand, data_type target) {
+    ir_instr_t *push = operand->code_end;
+    if (!operand->is_literal || !ir_is(push, "PUSHS")) {
+        return false;
+    }
+
+    const char *value = push->operands[0];
+    char converted[64];
+    if (target == float_type && strncmp(value, "int@", 4) == 0) {
+        snprintf(converted, sizeof(converted), "float@%a", (double)strtol(value + 4, NULL, 10));
+    } else if (target == int_type && strncmp(value, "float@", 6) == 0) {
+        double number = strtod(value + 6, NULL);
+        if (number < INT_MIN || number > INT_MAX || (double)(int)number != number) {
+            return false;
+        }
+        snprintf(converted, sizeof(converted), "int@%d", (int)number);
+    } else {
+        return false;
+    }
+    ir_set_operand(push, 0, converted);
+    return true;
+}
+
+/**
+ * @brief Brings mixed i32 and f64 operands to a common type.
+ * @details Only a literal operand is converted, preferably an i32 literal to f64.
+ *          Literals are converted at compile time, an i32 literal expression that is
+ *          not a single literal is converted at run time.
+ * @param lhs Left-hand operand.
+ * @param rhs Right-hand operand.
+ * @return Common operand type, or void_type if the operands cannot be unified.
+ */
+static data_type unify_numeric_operands(StackData *lhs, StackData *rhs) {
+    bool lhs_is_int = lhs->type == int_type;
+    StackData *int_operand = lhs_is_int ? lhs : rhs;
+    StackData *float_operand = lhs_is_int ? rhs : lhs;
+
+    if (int_operand->is_literal) {
+        if (!convert_literal_operand(int_operand, float_type)) {
+            if (lhs_is_int) {
+                ir_emit("POPS GF@temp\n");
+                ir_emit("INT2FLOATS\n");
+                ir_emit("PUSHS GF@temp\n");
+            } else {
+                ir_emit("INT2FLOATS\n");
+            }
+        }
+        return float_type;
+    }
+    if (convert_literal_operand(float_operand, int_type)) {
+        return int_type;
+    }
+    return void_type;
+}
+
+/**
+ * @brief Checks whether the operands are an i32 and an f64 in any order.
  * @param lhs_type Type of the left-hand operand.
  * @param rhs_type Type of the right-hand operand.
+ * @return True for mixed numeric operands.
+ */
+static bool is_mixed_numeric(data_type lhs_type, data_type rhs_type) {
+    return (lhs_type == int_type && rhs_type == float_type) || (lhs_type == float_type && rhs_type == int_type);
+}
+
+/**
+ * @brief Validates type compatibility for arithmetic operations.
+ * @param lhs Left-hand operand.
+ * @param rhs Right-hand operand.
  * @param result_type Pointer to store the resulting type.
- * @param lhs_is_literal Indicates if the left-hand operand is a literal.
- * @param rhs_is_literal Indicates if the right-hand operand is a literal.
  * @return True if the operation is compatible, false otherwise.
  */
-bool check_arithmetic_compatibility(data_type lhs_type, data_type rhs_type, data_type *result_type, bool lhs_is_literal, bool rhs_is_literal) {
-    if (lhs_type == int_type && rhs_type == int_type) {
-        *result_type = int_type;
+bool check_arithmetic_compatibility(StackData *lhs, StackData *rhs, data_type *result_type) {
+    if ((lhs->type == int_type || lhs->type == float_type) && lhs->type == rhs->type) {
+        *result_type = lhs->type;
         return true;
-    } else if (lhs_type == float_type && rhs_type == float_type) {
-        *result_type = float_type;
-        return true;
-    } else if (lhs_type == int_type && rhs_type == float_type) {
-        if (lhs_is_literal) {
-            printf("POPS GF@temp\n");
-            printf("INT2FLOATS\n"); 
-            printf("PUSHS GF@temp\n");
-        } else {
-            cleanup_stacks();
-            error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Incompatible types for arithmetic operation");
-            return false;
-        }
-        *result_type = float_type;
-        return true;
-    } else if (lhs_type == float_type && rhs_type == int_type) {
-        if (rhs_is_literal) {
-            printf("INT2FLOATS\n"); 
-        } else {
-            cleanup_stacks();
-            error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Incompatible types for arithmetic operation");
-            return false;
+    } else if (is_mixed_numeric(lhs->type, rhs->type)) {
+        *result_type = unify_numeric_operands(lhs, rhs);
+        if (*result_type != void_type) {
+            return true;
         }
-        *result_type = float_type;
-        return true;
     }
     cleanup_stacks();
     error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Incompatible types for arithmetic operation");
@@ -178,25 +232,19 @@ bool check_arithmetic_compatibility(data_type lhs_type, data_type rhs_type, data
 
 /**
  * @brief Validates type compatibility for equality operations (==, !=).
- * @param lhs_type Type of the left-hand operand.
- * @param rhs_type Type of the right-hand operand.
+ * @param lhs Left-hand operand.
+ * @param rhs Right-hand operand.
  * @param result_type Pointer to store the resulting type (boolean).
- * @param lhs_is_literal Indicates if the left-hand operand is a literal.
- * @param rhs_is_literal Indicates if the right-hand operand is a literal.
  * @return True if the operation is compatible, false otherwise.
  */
-bool check_equality_compatibility(data_type lhs_type, data_type rhs_type, data_type *result_type, bool lhs_is_literal, bool rhs_is_literal) {
+bool check_equality_compatibility(StackData *lhs, StackData *rhs, data_type *result_type) {
+    data_type lhs_type = lhs->type;
+    data_type rhs_type = rhs->type;
     if (lhs_type == rhs_type) {
         *result_type = bool_type;
         return true;
-    } else if ((lhs_type == int_type && rhs_type == float_type) || (lhs_type == float_type && rhs_type == int_type)) {
-        if (lhs_type == int_type && (lhs_is_literal || rhs_is_literal)) {
-            printf("POPS GF@temp\n");
-            printf("INT2FLOATS\n"); 
-            printf("PUSHS GF@temp\n");
-        } else if (rhs_type == int_type && (rhs_is_literal || lhs_is_literal)) {
-            printf("INT2FLOATS\n"); 
-        } else {
+    } else if (is_mixed_numeric(lhs_type, rhs_type)) {
+        if (unify_numeric_operands(lhs, rhs) == void_type) {
             cleanup_stacks();
             error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Incompatible types for relational operation");
             return false;
@@ -219,31 +267,23 @@ bool check_equality_compatibility(data_type lhs_type, data_type rhs_type, data_t
 
 /**
  * @brief Validates type compatibility for relational operations (<, >, <=, >=).
- * @param lhs_type Type of the left-hand operand.
- * @param rhs_type Type of the right-hand operand.
+ * @param lhs Left-hand operand.
+ * @param rhs Right-hand operand.
  * @param result_type Pointer to store the resulting type (boolean).
- * @param lhs_is_literal Indicates if the left-hand operand is a literal.
- * @param rhs_is_literal Indicates if the right-hand operand is a literal.
  * @return True if the operation is compatible, false otherwise.
  */
-bool check_relational_compatibility(data_type lhs_type, data_type rhs_type, data_type *result_type, bool lhs_is_literal, bool rhs_is_literal) {
-    if (lhs_type == null_type || rhs_type == null_type) {
+bool check_relational_compatibility(StackData *lhs, StackData *rhs, data_type *result_type) {
+    if (lhs->type == null_type || rhs->type == null_type) {
         cleanup_stacks();
         set_error(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Null values not allowed in relational operation", 0, 0);
         return false;
     }
 
-    if (lhs_type == rhs_type) {
+    if (lhs->type == rhs->type) {
         *result_type = bool_type;
         return true;
-    } else if ((lhs_type == int_type && rhs_type == float_type) || (lhs_type == float_type && rhs_type == int_type)) {
-        if (lhs_type == float_type && !lhs_is_literal) {
-            printf("INT2FLOATS\n"); 
-        } else if (rhs_type == float_type && !rhs_is_literal) {
-            printf("POPS GF@temp\n");
-            printf("INT2FLOATS\n"); 
-            printf("PUSHS GF@temp\n");
-        } else {
+    } else if (is_mixed_numeric(lhs->type, rhs->type)) {
+        if (unify_numeric_operands(lhs, rhs) == void_type) {
             cleanup_stacks();
             error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Incompatible types for relational operation");
             return false;
@@ -276,16 +316,22 @@ int reduce(Stack* stack, data_type* result_type) {
         
         switch (top->type) {
             case int_type:
-                printf("PUSHS int@%d\n", top->token->attribute.i);
+                ir_emit("PUSHS int@%d\n", top->token->attribute.i);
                 break;
             case float_type:
-                printf("PUSHS float@%a\n", top->token->attribute.f);
+                ir_emit("PUSHS float@%a\n", top->token->attribute.f);
                 break;
-            case string_type:
-                printf("PUSHS string@%s\n", top->token->attribute.s->data);
+            case string_type: {
+                char *literal = string_literal_encode(&top->token->attribute.str, "string@");
+                if (!literal) {
+                    cleanup_stacks();
+                    error_exit(ERROR_INTERNAL_COMPILER_ERROR, "Failed to encode string literal");
+                }
+                ir_emit_owned("PUSHS", literal);
                 break;
+            }
             case null_type:
-                printf("PUSHS nil@nil\n");
+                ir_emit("PUSHS nil@nil\n");
                 break;
             default:
                 cleanup_stacks();
@@ -294,7 +340,7 @@ int reduce(Stack* stack, data_type* result_type) {
 
         stack_pop(stack);
 
-        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = true, .token = NULL};
+        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = true, .token = NULL, .code_end = ir_last()};
         stack_push(stack, &exp_data);
         return 0;
     }
@@ -309,11 +355,13 @@ int reduce(Stack* stack, data_type* result_type) {
         }
 
         if (entry->type == fn_t) {
-            printf("PUSHS GF@return\n");
+            ir_emit("PUSHS GF@return\n");
             *result_type = top->type;
         } else if (entry->type == var_t || entry->type == const_t) {
-            if(top->token->attribute.s){
-                printf("PUSHS LF@%s\n", top->token->attribute.s->data); 
+            if (entry->varData->literal) {
+                ir_emit("PUSHS %s\n", entry->varData->literal);
+            } else if(top->token->attribute.s){
+                ir_emit("PUSHS LF@%s\n", top->token->attribute.s->data); 
             }
             *result_type = entry->varData->type;
         } else {
@@ -323,7 +371,7 @@ int reduce(Stack* stack, data_type* result_type) {
 
         stack_pop(stack);
 
-        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = false, .token = NULL};
+        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = false, .token = NULL, .code_end = ir_last()};
         stack_push(stack, &exp_data);
         return 0;
     }
@@ -338,10 +386,10 @@ int reduce(Stack* stack, data_type* result_type) {
     if (rhs && inner && lhs &&
         rhs->symbol == RPAR && inner->symbol == EXP && lhs->symbol == LPAR) {
         *result_type = inner->type;
+        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL, .code_end = ir_last()};
         stack_pop(stack); // Pop '('
         stack_pop(stack); // Pop expression E
         stack_pop(stack); // Pop ')'
-        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL};
         stack_push(stack, &exp_data); // Push reduced expression E
         return 0;
     }
@@ -353,16 +401,16 @@ int reduce(Stack* stack, data_type* result_type) {
         bool compatible = false;
 
         if (op->symbol == ADD || op->symbol == SUB || op->symbol == MUL) {
-            compatible = check_arithmetic_compatibility(lhs->type, rhs->type, result_type, lhs->is_literal, rhs->is_literal);
+            compatible = check_arithmetic_compatibility(lhs, rhs, result_type);
         } else if (op->symbol == DIV) {
-            compatible = check_arithmetic_compatibility(lhs->type, rhs->type, result_type, lhs->is_literal, rhs->is_literal);
+            compatible = check_arithmetic_compatibility(lhs, rhs, result_type);
         } else if (op->symbol == AND || op->symbol == OR) {
             compatible = true;
             *result_type = bool_type;
         } else if (op->symbol == EQ || op->symbol == NEQ){
-            compatible = check_equality_compatibility(lhs->type, rhs->type, result_type, lhs->is_literal, rhs->is_literal);
+            compatible = check_equality_compatibility(lhs, rhs, result_type);
         }else if(op->symbol == LT || op->symbol == GT || op->symbol == LE || op->symbol == GE) {
-            compatible = check_relational_compatibility(lhs->type, rhs->type, result_type, lhs->is_literal, rhs->is_literal);
+            compatible = check_relational_compatibility(lhs, rhs, result_type);
         }
 
         if (!compatible) {
@@ -371,24 +419,24 @@ int reduce(Stack* stack, data_type* result_type) {
         }
 
         switch (op->symbol) {
-            case ADD: printf("ADDS\n"); break;
-            case SUB: printf("SUBS\n"); break;
-            case MUL: printf("MULS\n"); break;
-            case DIV: printf("DIVS\n"); break;
-            case AND: printf("ANDS\n"); break;
-            case OR:  printf("ORS\n"); break;
-            case EQ:  printf("EQS\n"); break;
-            case NEQ: printf("EQS\nNOTS\n"); break;
-            case LT:  printf("LTS\n"); break;
-            case GT:  printf("GTS\n"); break;
-            case GE:  printf("LTS\nNOTS\n"); break;
-            case LE:  printf("GTS\nNOTS\n"); break;
+            case ADD: ir_emit("ADDS\n"); break;
+            case SUB: ir_emit("SUBS\n"); break;
+            case MUL: ir_emit("MULS\n"); break;
+            case DIV: ir_emit(*result_type == int_type ? "IDIVS\n" : "DIVS\n"); break;
+            case AND: gen_short_circuit(true, lhs->code_end); break;
+            case OR:  gen_short_circuit(false, lhs->code_end); break;
+            case EQ:  ir_emit("EQS\n"); break;
+            case NEQ: ir_emit("EQS\nNOTS\n"); break;
+            case LT:  ir_emit("LTS\n"); break;
+            case GT:  ir_emit("GTS\n"); break;
+            case GE:  ir_emit("LTS\nNOTS\n"); break;
+            case LE:  ir_emit("GTS\nNOTS\n"); break;
         }
 
+        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL, .code_end = ir_last()};
         stack_pop(stack); // Pop rhs (E)
         stack_pop(stack); // Pop op
         stack_pop(stack); // Pop lhs (E)
-        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL};
         stack_push(stack, &exp_data); // Push reduced expression E
         return 0;
     }
@@ -400,11 +448,11 @@ int reduce(Stack* stack, data_type* result_type) {
     if (not_op && exp && not_op->symbol == NOT && exp->symbol == EXP) {
         *result_type = bool_type;
 
-        printf("NOTS\n");
+        ir_emit("NOTS\n");
 
+        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL, .code_end = ir_last()};
         stack_pop(stack); // Pop E
         stack_pop(stack); // Pop NOT
-        StackData exp_data = {.symbol = EXP, .type = *result_type, .is_literal = (rhs->is_literal && lhs->is_literal), .token = NULL};
         stack_push(stack, &exp_data); // Push reduced expression E
         return 0;
     }
@@ -6,7 +6,7 @@
 symtable_t *symbol_table;
 token_t *current_token;
 func_data_t *current_function;
-FILE *file;
+source_t *file;
 bool first_control = true;
 bool has_return = false;
 
@@ -41,8 +41,7 @@ void error_exit(int exit_code, char *message) {
 
     set_error(exit_code, message, 0, 0);
 
-    fclose(file);
-    cleanup_temp_file();
+    source_free(file);
 
     exit(exit_code);
 }
@@ -73,11 +72,23 @@ bool is_type_compatible(data_type first_type, data_type second_type) {
     return false;
 }
 
+/**
+ * @brief Returns the type a variable of a data type keeps in the generated code.
+ * @details Only non-nullable numbers get a type, any other variable stays tagged.
+ */
+static ir_type_t var_ir_type(data_type type) {
+    switch (type) {
+        case int_type:      return IR_TYPE_INT;
+        case float_type:    return IR_TYPE_FLOAT;
+        default:            return IR_TYPE_UNKNOWN;
+    }
+}
+
 /**
  * @brief Initializes the parser.
- * @param source Pointer to the input file to parse.
+ * @param source Pointer to the source code to parse.
  */
-void parser_init(FILE *source) {
+void parser_init(source_t *source) {
     symbol_table = symtable_create(TABLE_SIZE);
     if (!symbol_table) {
         error_exit(ERROR_INTERNAL_COMPILER_ERROR, "Failed to create symbol table");
@@ -132,9 +143,8 @@ int parse_program() {
         error_exit(ERROR_SEMANTIC_UNDEFINED_FUNCTION_OR_VARIABLE, "Program should has main function"); 
     }
 
-    //debug_temp_file();
     //debug_symtable(symbol_table);
-    rewind_file(file); 
+    source_rewind(file); 
     first_control = false;
     fetch_next_token();
 
@@ -158,6 +168,7 @@ int parse_program() {
         }
     }
 
+    gen_program_finish();
     parser_cleanup();
     return 0;
 }
@@ -191,7 +202,7 @@ int parse_prologue() {
     }
     if (fetch_next_token() != 0) return -1;
 
-    if (current_token->type != TOKEN_STRING || dstring_compare_charstr(current_token->attribute.s, "ifj24.zig") != 0) {
+    if (current_token->type != TOKEN_STRING || !string_literal_equals(&current_token->attribute.str, "ifj24.zig")) {
         error_exit(ERROR_SYNTAX_ANALYSIS, "Expected 'ifj24.zig'");
     }
 
@@ -352,15 +363,19 @@ int parse_function_definition() {
         if(!has_return){
             error_exit(ERROR_SEMANTIC_MISSING_OR_ABSENT_EXPRESSION_IN_RETURN, "Function should has return statement");
         }
-    } else if (entry->funcData->returnType == void_type) {
+    } else if (dstring_compare_charstr(entry->funcData->name, "main") == 0) {
         if(!has_return){
-            printf("POPFRAME\n");
+            ir_emit("POPFRAME\n");
         }
+    } else {
+        // The end of a void function is reachable even after a return in a branch
+        gen_func_end();
     }
 
     if(dstring_compare_charstr(entry->funcData->name, "main") == 0){
-        printf("EXIT int@0\n");
+        ir_emit("EXIT int@0\n");
     }
+    gen_func_finish();
 
     if (check_unused_variables_in_scope(symbol_table) != 0){
         error_exit(ERROR_SEMANTIC_UNUSED_VARIABLE, " Variable declared at scope level was not used.\n");
@@ -478,6 +493,7 @@ int parse_parameter(func_data_t *func_data) {
             param_data->name = param_name;
             param_data->type = param_type;
             param_data->isUsed = false;
+            param_data->literal = NULL;
 
             if (symtable_insert_variable(symbol_table, param_name, param_data, symbol_table->scope_level, true) != 0) {
                 dstring_free(param_name);
@@ -485,8 +501,7 @@ int parse_parameter(func_data_t *func_data) {
                 error_exit(ERROR_INTERNAL_COMPILER_ERROR, "Failed to insert parameter into symbol table");
             }
             
-            gen_defvar(param_name);  
-            gen_pop_operand(param_name);
+            gen_param(param_name, var_ir_type(param_type));
         }
 
         if (fetch_next_token() != 0) {
@@ -695,6 +710,7 @@ int parse_var_decl() {
     }
 
     gen_defvar(var_name);
+    ir_instr_t *defvar = ir_last();
 
     data_type expr_type;
     if (parse_expression(&expr_type) != 0) {
@@ -719,6 +735,7 @@ int parse_var_decl() {
         error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Type mismatch in variable declaration");
     }
 
+    defvar->type = var_ir_type(var_type);
     gen_pop_operand(var_name);
 
     if (current_token->type != TOKEN_SEMICOLON) {
@@ -734,6 +751,7 @@ int parse_var_decl() {
     var_data->name = var_name;
     var_data->type = var_type;
     var_data->isUsed = false;
+    var_data->literal = NULL;
 
     if (symtable_insert_variable(symbol_table, var_name, var_data, symbol_table->scope_level, false) != 0) {
         dstring_free(var_name);
@@ -746,6 +764,44 @@ int parse_var_decl() {
     return 0;
 }
 
+/**
+ * @brief Returns the literal a constant with the given initializer can be replaced with.
+ * @param operand Operand pushed by the initializer.
+ * @param type Type of the constant.
+ * @return Newly allocated literal operand, or NULL if the initializer is not a literal of the type.
+ */
+static char *const_literal(const char *operand, data_type type) {
+    bool matches = false;
+    switch (type) {
+        case int_type:
+        case null_int_type:
+            matches = strncmp(operand, "int@", 4) == 0;
+            break;
+        case float_type:
+        case null_float_type:
+            matches = strncmp(operand, "float@", 6) == 0;
+            break;
+        case string_type:
+        case null_string_type:
+            matches = strncmp(operand, "string@", 7) == 0;
+            break;
+        default:
+            break;
+    }
+    if ((type == null_int_type || type == null_float_type || type == null_string_type) &&
+        strcmp(operand, "nil@nil") == 0) {
+        matches = true;
+    }
+    if (!matches) return NULL;
+
+    char *literal = malloc(strlen(operand) + 1);
+    if (!literal) {
+        error_exit(ERROR_INTERNAL_COMPILER_ERROR, "Memory allocation failed for constant");
+    }
+    strcpy(literal, operand);
+    return literal;
+}
+
 /**
  * @brief Parses a constant declaration.
  * @return 0 on successful parsing, -1 on failure.
@@ -829,6 +885,7 @@ int parse_const_decl() {
     }
 
     gen_defvar(const_name);
+    ir_instr_t *defvar = ir_last();
 
     data_type expr_type;
     if (parse_expression(&expr_type) != 0) {
@@ -853,21 +910,36 @@ int parse_const_decl() {
         error_exit(ERROR_SEMANTIC_TYPE_INCOMPATIBILITY, "Type mismatch in constant declaration");
     }
 
-    gen_pop_operand(const_name);
+    // A constant initialized by a literal is replaced by the literal at every use
+    char *literal = NULL;
+    ir_instr_t *push = defvar ? defvar->next : NULL;
+    if (push && push == ir_last() && ir_is(push, "PUSHS")) {
+        literal = const_literal(push->operands[0], const_type);
+    }
+    if (literal) {
+        ir_remove(ir_current(), push);
+        ir_remove(ir_current(), defvar);
+    } else {
+        if (defvar) defvar->type = var_ir_type(const_type);
+        gen_pop_operand(const_name);
+    }
 
     if (current_token->type != TOKEN_SEMICOLON) {
+        free(literal);
         dstring_free(const_name);
         error_exit(ERROR_SYNTAX_ANALYSIS, "Expected ';' at the end of constant declaration");
     }
 
     var_data_t *const_data = (var_data_t *)malloc(sizeof(var_data_t));
     if (!const_data) {
+        free(literal);
         dstring_free(const_name);
         error_exit(ERROR_INTERNAL_COMPILER_ERROR, "Memory allocation failed for constant");
     }
     const_data->name = const_name;
     const_data->type = const_type;
     const_data->isUsed = false;
+    const_data->literal = literal;
 
     if (symtable_insert_variable(symbol_table, const_name, const_data, symbol_table->scope_level, true) != 0) {
         dstring_free(const_name);
@@ -1122,6 +1194,7 @@ int parse_if_nullable_statement(data_type cond_type){
                         (cond_type == null_float_type) ? float_type :
                         (cond_type == null_string_type) ? string_type : cond_type;
         var_data->isUsed = false;
+        var_data->literal = NULL;
 
         if (symtable_insert_variable(symbol_table, id_name, var_data, symbol_table->scope_level, false) != 0) {
             dstring_free(id_name);
@@ -1329,6 +1402,7 @@ int parse_while_nullable_statement(data_type cond_type){
                         (cond_type == null_float_type) ? float_type :
                         (cond_type == null_string_type) ? string_type : cond_type;
         var_data->isUsed = false;
+        var_data->literal = NULL;
 
         if (symtable_insert_variable(symbol_table, id_name, var_data, symbol_table->scope_level, false) != 0) {
             dstring_free(id_name);
@@ -20,7 +20,7 @@ extern symtable_t *symbol_table;
 extern token_t *current_token;
 
 int fetch_next_token();
-void parser_init(FILE *source);
+void parser_init(source_t *source);
 void error_exit(int exit_code, char *message);
 void parser_cleanup();
 int parse_program();
@@ -54,17 +54,6 @@ bool stack_push(Stack *stack, StackData *data) {
         }
 
         *(new_element->data->token) = *(data->token); 
-
-        if (data->token->type == TOKEN_STRING && data->token->attribute.s) {
-            new_element->data->token->attribute.s = dstring_copy(data->token->attribute.s);
-            if (!new_element->data->token->attribute.s) {
-                free(new_element->data->token);
-                free(new_element->data);
-                free(new_element);
-                set_error(ERROR_INTERNAL_COMPILER_ERROR, "Failed to copy string attribute in token", 0, 0);
-                return false;
-            }
-        }
     } else {
         new_element->data->token = NULL; 
     }
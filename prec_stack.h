@@ -9,6 +9,7 @@
 #include <stdbool.h> 
 #include "symtable.h"
 #include "prec_sym_types.h"
+#include "ir.h"
 
 #define STACK_SIZE 100
 
@@ -18,6 +19,7 @@ typedef struct StackData {
     data_type type;          
     bool is_literal;    
     token_t *token;            
+    ir_instr_t *code_end;    // Last instruction computing a reduced expression
 } StackData;
 
 typedef struct StackElement {
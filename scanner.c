@@ -76,117 +76,176 @@ int is_built_in(dstring_t *lexeme)
 }
 
 /**
- * @brief Processes a string literal by handling escape sequences and removing quotes.
- * @param lexeme Tthe string literal.
- * @return The processed string.
+ * @brief Returns the value of a hexadecimal digit.
+ * @param c The hexadecimal digit.
+ * @return Value of the digit.
  */
-dstring_t *process_str(dstring_t *lexeme)
+static int hex_digit_value(char c)
 {
-    dstring_t *new_lex = dstring_init();
-    if (new_lex == NULL)
-    {
-        set_error(ERROR_INTERNAL_COMPILER_ERROR, "Memory allocation failed", -1, -1);
-        return NULL;
-    }
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+/**
+ * @brief Creates a string token referencing the literal in the source buffer.
+ * @param source The source code.
+ * @param start Index of the first character of the literal.
+ * @param end Index after the last character of the literal.
+ * @param multiline True for multi-line string literals.
+ * @return The string token.
+ */
+static token_t *string_token(source_t *source, size_t start, size_t end, bool multiline)
+{
+    token_attribute attribute;
+    attribute.str.data = source->data + start;
+    attribute.str.length = end - start;
+    attribute.str.multiline = multiline;
+    return token_init(TOKEN_STRING, &attribute);
+}
 
-    // Determine if it's a multiline string or a regular string
-    bool is_multiline = (lexeme->length > 1 && lexeme->data[0] == '\\' && lexeme->data[1] == '\\');
-    size_t start = 0;
-    size_t end = lexeme->length;
+/**
+ * @brief Decodes the next character of a string literal.
+ * @details The literal was validated by the scanner, so escape sequences are well-formed.
+ * @param literal The string literal.
+ * @param position Index into the literal, moved past the decoded character.
+ * @return The decoded character, or EOF at the end of the literal.
+ */
+int string_literal_next(const token_slice_t *literal, size_t *position)
+{
+    const char *data = literal->data;
+    size_t i = *position;
 
-    if (!is_multiline && lexeme->data[0] == '"' && lexeme->data[lexeme->length - 1] == '"')
+    if (literal->multiline)
     {
-        start = 1;
-        end = lexeme->length - 1;
+        if (i == 0)
+            i = 2; // '\\' of the first line
+        if (i >= literal->length)
+        {
+            *position = i;
+            return EOF;
+        }
+        char c = data[i++];
+        if (c == '\n')
+        {
+            // Skip the indentation and '\\' of the next line
+            while (data[i] == ' ' || data[i] == '\t')
+                i++;
+            i += 2;
+        }
+        *position = i;
+        return (unsigned char)c;
     }
 
-    for (size_t i = start; i < end; i++)
+    if (i >= literal->length)
+        return EOF;
+    char c = data[i++];
+    if (c == '\\')
     {
-        char current = lexeme->data[i];
-
-        if (current == '\\')
+        c = data[i++];
+        switch (c)
         {
-            i++;
-            if (i >= lexeme->length)
-            {
-                set_error(ERROR_LEXICAL_ANALYSIS, "Invalid escape sequence", -1, -1);
-                dstring_free(new_lex);
-                return NULL;
-            }
-            char next = lexeme->data[i];
-            switch (next)
-            {
-            case 'n':
-                dstring_add_str(new_lex, "\\010");
-                break;
-            case 't':
-                dstring_add_str(new_lex, "\\009");
-                break;
-            case 'r':
-                dstring_add_str(new_lex, "\\013");
-                break;
-            case '\\':
-                if(!is_multiline){
-                    dstring_add_str(new_lex, "\\092");
-                }    
-                break;
-            case '"':
-                dstring_add_str(new_lex, "\"");
-                break;
-            case 'x':
-            {
-                if (i + 2 >= lexeme->length || !isxdigit(lexeme->data[i + 1]) || !isxdigit(lexeme->data[i + 2]))
-                {
-                    set_error(ERROR_LEXICAL_ANALYSIS, "Invalid \\x escape sequence: must be followed by exactly two hexadecimal digits", -1, -1);
-                    dstring_free(new_lex);
-                    return NULL;
-                }
-
-                char hex[3] = {lexeme->data[i + 1], lexeme->data[i + 2], '\0'};
-                i += 2;
+        case 'n':
+            c = '\n';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        case 'x':
+            c = (char)(hex_digit_value(data[i]) * 16 + hex_digit_value(data[i + 1]));
+            i += 2;
+            break;
+        default:
+            // '"' and '\' stand for themselves
+            break;
+        }
+    }
+    *position = i;
+    return (unsigned char)c;
+}
 
-                int ascii_value = (int)strtol(hex, NULL, 16);
+/**
+ * @brief Checks whether a character has to be written as an escape sequence in IFJcode24.
+ */
+static bool string_char_needs_escape(int c)
+{
+    return c <= 32 || c == '#' || c == '\\';
+}
 
-                if (ascii_value > 255)
-                {
-                    set_error(ERROR_LEXICAL_ANALYSIS, "Invalid \\x escape sequence: value out of range", -1, -1);
-                    dstring_free(new_lex);
-                    return NULL;
-                }
+/**
+ * @brief Converts a string literal to its IFJcode24 form.
+ * @details Whitespace, control characters, '#' and '\' are written as escape sequences \ddd.
+ *          The literal is decoded twice, once to size the result exactly and once to fill it,
+ *          so its bytes are copied only into the result.
+ * @param literal The string literal.
+ * @param prefix Text put before the literal, e.g. "string@".
+ * @return Newly allocated encoded literal, or NULL on allocation failure.
+ */
+char *string_literal_encode(const token_slice_t *literal, const char *prefix)
+{
+    size_t prefix_length = strlen(prefix);
+    size_t length = prefix_length;
+    size_t position = 0;
+    int c;
 
-                char encoded[5];
-                snprintf(encoded, sizeof(encoded), "\\%03d", ascii_value);
-                dstring_add_str(new_lex, encoded);
+    while ((c = string_literal_next(literal, &position)) != EOF)
+        length += string_char_needs_escape(c) ? 4 : 1;
 
-                break;
-            }
+    char *encoded = malloc(length + 1);
+    if (encoded == NULL)
+    {
+        set_error(ERROR_INTERNAL_COMPILER_ERROR, "Memory allocation failed", -1, -1);
+        return NULL;
+    }
+    memcpy(encoded, prefix, prefix_length);
 
-            default:
-                set_error(ERROR_LEXICAL_ANALYSIS, "Invalid escape sequence", -1, -1);
-                dstring_free(new_lex);
-                return NULL;
-            }
-        }
-        else if (current <= 32 || current == 35)
+    char *out = encoded + prefix_length;
+    position = 0;
+    while ((c = string_literal_next(literal, &position)) != EOF)
+    {
+        if (string_char_needs_escape(c))
         {
-            char encoded[5];
-            snprintf(encoded, sizeof(encoded), "\\%03d", current);
-            dstring_add_str(new_lex, encoded);
+            snprintf(out, 5, "\\%03d", c);
+            out += 4;
         }
         else
         {
-            dstring_add_char(new_lex, current);
+            *out++ = (char)c;
         }
     }
+    *out = '\0';
+    return encoded;
+}
 
-    return new_lex;
+/**
+ * @brief Compares a decoded string literal with a C string.
+ * @param literal The string literal.
+ * @param str The string to compare with.
+ * @return True if both strings are equal.
+ */
+bool string_literal_equals(const token_slice_t *literal, const char *str)
+{
+    size_t position = 0;
+    int c;
+    while ((c = string_literal_next(literal, &position)) != EOF)
+    {
+        if (*str == '\0' || (unsigned char)*str != c)
+            return false;
+        str++;
+    }
+    return *str == '\0';
 }
 
 /**
  * @brief Retrieves the next token from the input stream.
  * @return A pointer to the next token or NULL if an error occurred.
  */
-int get_next_token(FILE *source, token_t **current_token)
+int get_next_token(source_t *source, token_t **current_token)
 {
     if (*current_token != NULL)
     {
@@ -196,6 +255,8 @@ int get_next_token(FILE *source, token_t **current_token)
     fsm_state_t state = STATE_START;
     dstring_t *lexeme = dstring_init();
     token_attribute attribute;
+    size_t literal_start = 0;
+    size_t literal_end = 0;
 
     if (lexeme == NULL)
     {
@@ -207,7 +268,7 @@ int get_next_token(FILE *source, token_t **current_token)
 
     while (1)
     {
-        c = getc(source);
+        c = source_getc(source);
         switch (state)
         {
         case STATE_START:
@@ -215,7 +276,7 @@ int get_next_token(FILE *source, token_t **current_token)
             {
             case '"':
                 state = STATE_STR_START;
-                dstring_add_char(lexeme, c);
+                literal_start = source->position;
                 break;
             case '0' ... '9':
                 state = STATE_INTEGER;
@@ -223,7 +284,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 break;
             case '\\':
                 state = STATE_STR_ML_BACKSLASH;
-                dstring_add_char(lexeme, c);
+                literal_start = source->position - 1;
                 break;
             case '+':
                 *current_token = token_init(TOKEN_ADD, NULL);
@@ -331,7 +392,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 dstring_add_char(lexeme, c);
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 if (dstring_compare_charstr(lexeme, "@import") != 0)
                 {
                     set_error(ERROR_LEXICAL_ANALYSIS, "Invalid character", -1, -1);
@@ -351,7 +412,7 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_DIV, NULL);
                 dstring_free(lexeme);
                 return 0;
@@ -365,7 +426,7 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_OPEN_BRACK_LEFT, NULL);
                 dstring_free(lexeme);
                 return 0;
@@ -382,7 +443,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 state = STATE_ID_KW;
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_OPEN_BRACK_RIGHT, NULL);
                 dstring_free(lexeme);
                 return 0;
@@ -404,7 +465,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 dstring_add_char(lexeme, c);
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_QUEST, NULL);
                 dstring_free(lexeme);
                 return 0;
@@ -417,7 +478,7 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 token_type keyword = is_keyword(lexeme);
                 if (keyword == -1)
                 {
@@ -454,14 +515,14 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_NOT, NULL);
                 dstring_free(lexeme);
                 return 0;
             }
             break;
         case STATE_NEQ:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_NEQ, NULL);
             dstring_free(lexeme);
             return 0;
@@ -473,14 +534,14 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_ASSIGN, NULL);
                 dstring_free(lexeme);
                 return 0;
             }
             break;
         case STATE_EQ:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_EQ, NULL);
             dstring_free(lexeme);
             return 0;
@@ -492,14 +553,14 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_COMP_L, NULL);
                 dstring_free(lexeme);
                 return 0;
             }
             break;
         case STATE_COMP_LE:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_COMP_LE, NULL);
             dstring_free(lexeme);
             return 0;
@@ -511,14 +572,14 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_COMP_G, NULL);
                 dstring_free(lexeme);
                 return 0;
             }
             break;
         case STATE_COMP_GE:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_COMP_GE, NULL);
             dstring_free(lexeme);
             return 0;
@@ -536,7 +597,7 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             break;
         case STATE_LOGIC_AND2:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_LOGICAL_AND, NULL);
             dstring_free(lexeme);
             return 0;
@@ -548,14 +609,14 @@ int get_next_token(FILE *source, token_t **current_token)
             }
             else
             {
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_VERTICAL_BAR, NULL);
                 dstring_free(lexeme);
                 return 0;
             }
             break;
         case STATE_LOGIC_OR2:
-            ungetc(c, source);
+            source_ungetc(source, c);
             *current_token = token_init(TOKEN_LOGICAL_OR, NULL);
             dstring_free(lexeme);
             return 0;
@@ -570,7 +631,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 dstring_add_char(lexeme, c);
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 *current_token = token_init(TOKEN_UNDERSCORE, NULL);
                 dstring_free(lexeme);
                 return 0;
@@ -593,7 +654,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 state = STATE_ID_IFJ_FUNC;
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 token_type keyword = is_keyword(lexeme);
                 if (keyword == -1)
                 {
@@ -619,7 +680,7 @@ int get_next_token(FILE *source, token_t **current_token)
                 state = STATE_ID_IFJ_FUNC;
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 token_type keyword = is_keyword(lexeme);
                 if (keyword == -1)
                 {
@@ -647,7 +708,7 @@ int get_next_token(FILE *source, token_t **current_token)
             case '\n':
                 break;
             default:
-                ungetc(c, source);
+                source_ungetc(source, c);
                 int res = is_built_in(lexeme);
                 if (res == 0)
                 {
@@ -693,7 +754,7 @@ int get_next_token(FILE *source, token_t **current_token)
                     dstring_free(lexeme);
                     return ERROR_LEXICAL_ANALYSIS;
                 }
-                ungetc(c, source);
+                source_ungetc(source, c);
                 attribute.i = (int)strtol(lexeme->data, NULL, 10);
                 *current_token = token_init(TOKEN_INT, &attribute);
                 dstring_free(lexeme);
@@ -734,7 +795,7 @@ int get_next_token(FILE *source, token_t **current_token)
                     dstring_free(lexeme);
                     return ERROR_LEXICAL_ANALYSIS;
                 }
-                ungetc(c, source);
+                source_ungetc(source, c);
                 attribute.f = atof(lexeme->data);
                 *current_token = token_init(TOKEN_FLOAT, &attribute);
                 dstring_free(lexeme);
@@ -791,7 +852,7 @@ int get_next_token(FILE *source, token_t **current_token)
                     dstring_free(lexeme);
                     return ERROR_LEXICAL_ANALYSIS;
                 }
-                ungetc(c, source);
+                source_ungetc(source, c);
                 attribute.f = atof(lexeme->data);
                 *current_token = token_init(TOKEN_FLOAT, &attribute);
                 dstring_free(lexeme);
@@ -801,14 +862,13 @@ int get_next_token(FILE *source, token_t **current_token)
         case STATE_STR_START:
             if (c == '"')
             {
+                literal_end = source->position - 1;
                 state = STATE_STR_END;
-                dstring_add_char(lexeme, c);
                 break;
             }
             else if (c == '\\')
             {
                 state = STATE_STR_ESC;
-                dstring_add_char(lexeme, c);
                 break;
             }
             else if (c == '\n' || c == '\0' || c == EOF || c == '\t')
@@ -818,22 +878,10 @@ int get_next_token(FILE *source, token_t **current_token)
 
                 return ERROR_LEXICAL_ANALYSIS;
             }
-            else
-            {
-                dstring_add_char(lexeme, c);
-                break;
-            }
             break;
         case STATE_STR_END:
-            ungetc(c, source);
-            attribute.s = process_str(lexeme);
-            if (attribute.s == NULL)
-            {
-                set_error(ERROR_LEXICAL_ANALYSIS, "Invalid string", -1, -1);
-
-                return ERROR_LEXICAL_ANALYSIS;
-            }
-            *current_token = token_init(TOKEN_STRING, &attribute);
+            source_ungetc(source, c);
+            *current_token = string_token(source, literal_start, literal_end, false);
             dstring_free(lexeme);
             return 0;
         case STATE_STR_ESC:
@@ -844,11 +892,9 @@ int get_next_token(FILE *source, token_t **current_token)
             case 'r':
             case 't':
             case '\\':
-                dstring_add_char(lexeme, c);
                 state = STATE_STR_START;
                 break;
             case 'x':
-                dstring_add_char(lexeme, c);
                 state = STATE_STR_ESC_X1;
                 break;
             default:
@@ -864,7 +910,6 @@ int get_next_token(FILE *source, token_t **current_token)
             case '0' ... '9':
             case 'a' ... 'f':
             case 'A' ... 'F':
-                dstring_add_char(lexeme, c);
                 state = STATE_STR_ESC_X2;
                 break;
             default:
@@ -880,7 +925,6 @@ int get_next_token(FILE *source, token_t **current_token)
             case '0' ... '9':
             case 'a' ... 'f':
             case 'A' ... 'F':
-                dstring_add_char(lexeme, c);
                 state = STATE_STR_START;
                 break;
             default:
@@ -894,7 +938,6 @@ int get_next_token(FILE *source, token_t **current_token)
             if (c == '\\')
             {
                 state = STATE_STR_ML_BODY;
-                dstring_add_char(lexeme, c);
             }
             else
             {
@@ -907,77 +950,30 @@ int get_next_token(FILE *source, token_t **current_token)
         case STATE_STR_ML_BODY:
             if (c == '\n')
             {
+                literal_end = source->position - 1;
                 state = STATE_STR_ML_NEWLINE_CHECK;
             }
             else if (c == EOF)
             {
-                attribute.s = process_str(lexeme);
-                if (attribute.s == NULL)
-                {
-                    set_error(ERROR_LEXICAL_ANALYSIS, "Invalid string", -1, -1);
-                    dstring_free(lexeme);
-
-                    return ERROR_LEXICAL_ANALYSIS;
-                }
-                *current_token = token_init(TOKEN_STRING, &attribute);
+                *current_token = string_token(source, literal_start, source->position, true);
                 dstring_free(lexeme);
                 return 0;
             }
-            else
-            {
-                dstring_add_char(lexeme, c);
-            }
             break;
         case STATE_STR_ML_NEWLINE_CHECK:
-            if (c == '\t' || c == ' ')
-            {
-                state = STATE_STR_ML_SKIP_WHITESPACE;
-            }
-            else if (c == '\\')
-            {
-                dstring_add_char(lexeme, '\n');
-                state = STATE_STR_ML_BACKSLASH;
-                dstring_add_char(lexeme, c);
-            }
-            else
-            {
-                ungetc(c, source);
-                attribute.s = process_str(lexeme);
-                if (attribute.s == NULL)
-                {
-                    set_error(ERROR_LEXICAL_ANALYSIS, "Invalid string", -1, -1);
-                    dstring_free(lexeme);
-
-                    return ERROR_LEXICAL_ANALYSIS;
-                }
-                *current_token = token_init(TOKEN_STRING, &attribute);
-                dstring_free(lexeme);
-                return 0;
-            }
-            break;
         case STATE_STR_ML_SKIP_WHITESPACE:
             if (c == '\t' || c == ' ')
             {
-                // continue skipping
+                state = STATE_STR_ML_SKIP_WHITESPACE;
             }
             else if (c == '\\')
             {
-                dstring_add_char(lexeme, '\n');
                 state = STATE_STR_ML_BACKSLASH;
-                dstring_add_char(lexeme, c);
             }
             else
             {
-                ungetc(c, source);
-                attribute.s = process_str(lexeme);
-                if (attribute.s == NULL)
-                {
-                    set_error(ERROR_LEXICAL_ANALYSIS, "Invalid string", -1, -1);
-                    dstring_free(lexeme);
-
-                    return ERROR_LEXICAL_ANALYSIS;
-                }
-                *current_token = token_init(TOKEN_STRING, &attribute);
+                source_ungetc(source, c);
+                *current_token = string_token(source, literal_start, literal_end, true);
                 dstring_free(lexeme);
                 return 0;
             }
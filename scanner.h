@@ -6,9 +6,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include "dstring.h"
 #include "error_codes.h"
 #include "token.h"
+#include "file.h"
 
 typedef struct {
     FILE *code_file;
@@ -85,6 +87,9 @@ typedef enum lex_function_states {
 } fsm_state_t;
 
 int is_keyword(dstring_t *lexeme);
-int get_next_token(FILE *source, token_t **current_token);
+int get_next_token(source_t *source, token_t **current_token);
+int string_literal_next(const token_slice_t *literal, size_t *position);
+char *string_literal_encode(const token_slice_t *literal, const char *prefix);
+bool string_literal_equals(const token_slice_t *literal, const char *str);
 
 #endif
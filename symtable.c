@@ -419,6 +419,7 @@ void symtable_exit_scope(symtable_t *table) {
                         temp->value->funcData = NULL;
                     }
                     if (temp->value->varData) {
+                        free(temp->value->varData->literal);
                         free(temp->value->varData);
                         temp->value->varData = NULL;
                     }
@@ -469,6 +470,7 @@ void symtable_free(symtable_t *table) {
                     temp->value->funcData = NULL;
                 }
                 if (temp->value->varData) {
+                    free(temp->value->varData->literal);
                     free(temp->value->varData);
                     temp->value->varData = NULL;
                 }
@@ -43,6 +43,7 @@ typedef struct {
     dstring_t *name;
     data_type type;
     bool isUsed;
+    char *literal;      // Literal operand a constant is replaced with, e.g. "int@100", or NULL
 } var_data_t;
 
 typedef struct {
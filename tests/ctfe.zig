@@ -0,0 +1,56 @@
+const ifj = @import("ifj24.zig");
+
+pub fn fib(n: i32) i32 {
+    if (n < 2) {
+        return n;
+    } else {
+        const a = fib(n - 1);
+        const b = fib(n - 2);
+        return a + b;
+    }
+}
+
+pub fn middle(s: []u8) i32 {
+    const t = ifj.substring(s, 1, 3);
+    if (t) |u| {
+        const c = ifj.ord(u, 1);
+        const l = ifj.length(u);
+        return c + l;
+    } else {
+        return 0 - 1;
+    }
+}
+
+pub fn count(n: i32) i32 {
+    var i: i32 = 0;
+    var s: i32 = 0;
+    while (i < n) {
+        s = s + 3;
+        i = i + 1;
+    }
+    return s;
+}
+
+pub fn half(n: i32) i32 {
+    return n / 2;
+}
+
+pub fn main() void {
+    const x = fib(20);
+    ifj.write(x);
+    ifj.write("\n");
+    const hello = ifj.string("hello");
+    const m = middle(hello);
+    ifj.write(m);
+    ifj.write("\n");
+    const accented = ifj.string("\xc3\xa1bc");
+    const n = middle(accented);
+    ifj.write(n);
+    ifj.write("\n");
+    const c = count(400000);
+    ifj.write(c);
+    ifj.write("\n");
+    const h = half(0 - 7);
+    ifj.write(h);
+    ifj.write("\n");
+}
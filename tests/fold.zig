@@ -0,0 +1,58 @@
+const ifj = @import("ifj24.zig");
+
+pub fn show(s: ?[]u8) void {
+    if (s) |text| {
+        ifj.write("[");
+        ifj.write(text);
+        ifj.write("]\n");
+    } else {
+        ifj.write("null\n");
+    }
+}
+
+pub fn main() void {
+    const word = ifj.string("abc");
+    const empty = ifj.string("");
+    const a = ifj.substring(word, 0, 3);
+    show(a);
+    const b = ifj.substring(word, 2, 1);
+    show(b);
+    const c = ifj.substring(word, 3, 3);
+    show(c);
+    const d = ifj.substring(word, 1, 1);
+    show(d);
+    const e = ifj.substring(word, 0, 4);
+    show(e);
+    const f = ifj.substring(empty, 0, 0);
+    show(f);
+    ifj.write(ifj.ord(word, 0));
+    ifj.write(" ");
+    ifj.write(ifj.ord(word, 3));
+    ifj.write(" ");
+    ifj.write(ifj.ord(word, 0 - 1));
+    ifj.write(" ");
+    ifj.write(ifj.ord(empty, 0));
+    ifj.write("\n");
+    const ab = ifj.string("ab");
+    ifj.write(ifj.strcmp(ab, word));
+    ifj.write(" ");
+    ifj.write(ifj.strcmp(word, ab));
+    ifj.write(" ");
+    ifj.write(ifj.strcmp(empty, ab));
+    ifj.write(" ");
+    ifj.write(ifj.strcmp(word, word));
+    ifj.write("\n");
+    const limit: i32 = 3;
+    if (limit > 2) {
+        ifj.write("taken\n");
+    } else {
+        ifj.write("not taken\n");
+    }
+    var n: i32 = limit * 2;
+    while (n < 6) {
+        ifj.write("loop\n");
+        n = n + 1;
+    }
+    ifj.write(n);
+    ifj.write("\n");
+}
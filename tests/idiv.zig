@@ -0,0 +1,14 @@
+const ifj = @import("ifj24.zig");
+
+pub fn main() void {
+    const a: i32 = 7;
+    var b: i32 = 2;
+    b = a / b;
+    ifj.write(b);
+    ifj.write("\n");
+    ifj.write(7 / 2);
+    ifj.write("\n");
+    const c: f64 = 7.0 / 2.0;
+    ifj.write(c);
+    ifj.write("\n");
+}
@@ -0,0 +1,26 @@
+const ifj = @import("ifj24.zig");
+
+pub fn sub(a: i32, b: i32) i32 {
+    return a - b;
+}
+
+pub fn join(first: []u8, second: []u8, separator: []u8) []u8 {
+    const head = ifj.concat(first, separator);
+    return ifj.concat(head, second);
+}
+
+pub fn main() void {
+    const x: i32 = 10;
+    const y: i32 = 3;
+    ifj.write(sub(x, y));
+    ifj.write("\n");
+    const d = sub(y, x);
+    ifj.write(d);
+    ifj.write("\n");
+    const ab = ifj.string("ab");
+    const cd = ifj.string("cd");
+    const dash = ifj.string("-");
+    const s = join(ab, cd, dash);
+    ifj.write(s);
+    ifj.write("\n");
+}
@@ -0,0 +1,44 @@
+const ifj = @import("ifj24.zig");
+
+pub fn mix(n: i32) i32 {
+    const a = n + 1;
+    ifj.write(a);
+    ifj.write(" ");
+    const b = n * 2;
+    ifj.write(b);
+    ifj.write(" ");
+    const c = n - 3;
+    ifj.write(c);
+    ifj.write("\n");
+    var total: i32 = 0;
+    var i: i32 = 0;
+    while (i < n) {
+        const square = i * i;
+        total = total + square;
+        i = i + 1;
+    }
+    var j: i32 = 0;
+    while (j < n) {
+        const double = j + j;
+        total = total - double;
+        j = j + 1;
+    }
+    return total;
+}
+
+pub fn main() void {
+    const first = ifj.readi32();
+    if (first) |n| {
+        const result = mix(n);
+        ifj.write(result);
+        ifj.write("\n");
+    } else {
+    }
+    const second = ifj.readi32();
+    if (second) |m| {
+        const other = mix(m);
+        ifj.write(other);
+        ifj.write("\n");
+    } else {
+    }
+}
@@ -0,0 +1,68 @@
+const ifj = @import("ifj24.zig");
+
+pub fn scale(x: f64, n: i32) f64 {
+    var result: f64 = x;
+    var i: i32 = 1;
+    while (i < n) {
+        result = result * x;
+        i = i + 1;
+    }
+    return result;
+}
+
+pub fn steps(n: i32) i32 {
+    var count: i32 = 0;
+    var value: i32 = n;
+    while (value != 1) {
+        const half = value / 2;
+        if (half * 2 == value) {
+            value = half;
+        } else {
+            value = 3 * value + 1;
+        }
+        count = count + 1;
+    }
+    return count;
+}
+
+pub fn report(exponent: i32, start: i32) void {
+    const base: f64 = 1.5;
+    const power = scale(base, exponent);
+    ifj.write(power);
+    ifj.write("\n");
+    const limit = steps(start);
+    ifj.write(limit);
+    ifj.write("\n");
+    const ratio = ifj.i2f(limit) / 4.0;
+    ifj.write(ratio);
+    ifj.write("\n");
+    var maybe: ?i32 = null;
+    if (limit > 100) {
+        maybe = limit - 100;
+    } else {
+    }
+    if (maybe) |extra| {
+        const twice = extra * 2;
+        ifj.write(twice);
+        ifj.write("\n");
+    } else {
+        ifj.write("none\n");
+    }
+    const name = ifj.string("typed");
+    const length = ifj.length(name);
+    const half = ifj.i2f(length) * 0.5;
+    ifj.write(half);
+    ifj.write("\n");
+}
+
+pub fn main() void {
+    const first = ifj.readi32();
+    const second = ifj.readi32();
+    if (first) |exponent| {
+        if (second) |start| {
+            report(exponent, start);
+        } else {
+        }
+    } else {
+    }
+}
@@ -0,0 +1,20 @@
+const ifj = @import("ifj24.zig");
+
+pub fn main() void {
+    var i: i32 = 0;
+    while (i < 5) {
+        ifj.write(i);
+        i = i + 2;
+    }
+    ifj.write("\n");
+    ifj.write(i);
+    ifj.write("\n");
+    var j: i32 = 1;
+    var sum: i32 = 0;
+    while (j <= 4) {
+        sum = sum + j;
+        j = j + 1;
+    }
+    ifj.write(sum);
+    ifj.write("\n");
+}
@@ -0,0 +1,20 @@
+const ifj = @import("ifj24.zig");
+
+pub fn main() void {
+    var l: i32 = 0;
+    const read = ifj.readi32();
+    if (read) |value| {
+        l = value;
+    } else {
+    }
+    var x: i32 = 0;
+    var i: i32 = 0;
+    while ((i < 8) && (x < l)) {
+        x = x + 1;
+        i = i + 1;
+    }
+    ifj.write(i);
+    ifj.write(" ");
+    ifj.write(x);
+    ifj.write("\n");
+}
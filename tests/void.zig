@@ -0,0 +1,17 @@
+const ifj = @import("ifj24.zig");
+
+pub fn main() void {
+    show(1, 2);
+    show(3, 4);
+}
+
+pub fn show(a: i32, b: i32) void {
+    if (a > b) {
+        return;
+    } else {
+    }
+    ifj.write(a);
+    ifj.write(" ");
+    ifj.write(b);
+    ifj.write("\n");
+}
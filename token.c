@@ -38,11 +38,6 @@ token_t *token_init(token_type type, token_attribute *attribute) {
  */
 void token_free(token_t* token) {
     if (token == NULL) return;
-    if (token->type == TOKEN_STRING && token->attribute.s != NULL) { 
-        dstring_free(token->attribute.s);
-        token->attribute.s = NULL;
-    }
-
     free(token); 
 }
 
@@ -81,16 +76,8 @@ token_t *token_copy(const token_t *original) {
     copy->type = original->type;
     switch (original->type) {
         case TOKEN_STRING:
-            if (original->attribute.s) {
-                copy->attribute.s = dstring_copy(original->attribute.s);
-                if (!copy->attribute.s) {
-                    free(copy);
-                    set_error(ERROR_INTERNAL_COMPILER_ERROR, "Failed to copy string attribute", 0, 0);
-                    return NULL;
-                }
-            } else {
-                copy->attribute.s = NULL; 
-            }
+            // The slice keeps referencing the source buffer
+            copy->attribute.str = original->attribute.str;
             break;
 
         case TOKEN_INT:
@@ -4,6 +4,7 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <stdbool.h>
 #include "dstring.h"
 #include "error_codes.h"
 
@@ -72,10 +73,17 @@ typedef enum {
 
 } token_type;
 
+typedef struct {
+    const char *data;             // Start of the literal in the source buffer, without quotes
+    size_t length;
+    bool multiline;               // Lines prefixed with '\\', no escape sequences
+} token_slice_t;
+
 typedef union {
     int i;
     float f;
     dstring_t *s;
+    token_slice_t str;            // TOKEN_STRING, decoded lazily at emission
 } token_attribute;
 
 typedef struct {
@@ -0,0 +1,1400 @@
+/**
+ * IFJ24
+ * @brief Bytecode virtual machine running the generated IFJcode24 in-process.
+ * @details The instruction lists of the header and all functions are lowered
+ *          to an array of bytecode instructions. Labels are dropped and jumps
+ *          and calls refer to instruction indices, literals are decoded once
+ *          and variables are resolved to slots: global variables to slots of
+ *          the global frame, local and temporary variables to slots of the
+ *          frames of the function they appear in. Like generator.c does, a
+ *          function creates, pushes and pops its own frame, so a frame gets
+ *          the slots of the function that created it. The instructions run
+ *          with direct-threaded dispatch where the compiler supports computed
+ *          goto, and with a switch otherwise. Run-time errors end the program
+ *          with the exit codes of the IFJcode24 interpreter. The optimizer
+ *          evaluates calls of pure functions on the same machine, under a
+ *          budget and without input or output.
+ */
+
+#include "vm.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__)
+#define VM_THREADED
+#endif
+
+#define VM_ERROR_CODE       32  // Malformed instruction or operand
+#define VM_ERROR_SEMANTIC   52  // Undefined label, redefined label or variable
+#define VM_ERROR_TYPES      53  // Wrong operand types
+#define VM_ERROR_VARIABLE   54  // Access to an undefined variable
+#define VM_ERROR_FRAME      55  // Frame does not exist
+#define VM_ERROR_VALUE      56  // Missing value in a variable, on the data stack or the call stack
+#define VM_ERROR_OPERAND    57  // Wrong operand value, e.g. division by zero
+#define VM_ERROR_STRING     58  // Wrong string operation
+#define VM_ERROR_BUDGET     1   // Evaluation ran out of its budget, never the result of a run
+
+#define VM_FRAME_CACHE      64  // Frames with fewer slots are reused instead of freed
+
+// Instruction name and number of operands
+#define VM_OPS(X) \
+    X(MOVE, 2) X(CREATEFRAME, 0) X(PUSHFRAME, 0) X(POPFRAME, 0) X(DEFVAR, 1) X(CALL, 1) X(RETURN, 0) \
+    X(PUSHS, 1) X(POPS, 1) X(CLEARS, 0) \
+    X(ADD, 3) X(SUB, 3) X(MUL, 3) X(DIV, 3) X(IDIV, 3) X(LT, 3) X(GT, 3) X(EQ, 3) X(AND, 3) X(OR, 3) \
+    X(STRI2INT, 3) X(CONCAT, 3) X(GETCHAR, 3) \
+    X(NOT, 2) X(INT2FLOAT, 2) X(FLOAT2INT, 2) X(INT2CHAR, 2) X(STRLEN, 2) \
+    X(ADDS, 0) X(SUBS, 0) X(MULS, 0) X(DIVS, 0) X(IDIVS, 0) X(LTS, 0) X(GTS, 0) X(EQS, 0) X(ANDS, 0) \
+    X(ORS, 0) X(STRI2INTS, 0) \
+    X(NOTS, 0) X(INT2FLOATS, 0) X(FLOAT2INTS, 0) X(INT2CHARS, 0) \
+    X(READ, 2) X(WRITE, 1) X(SETCHAR, 3) X(TYPE, 2) \
+    X(JUMP, 1) X(JUMPIFEQ, 3) X(JUMPIFNEQ, 3) X(JUMPIFEQS, 1) X(JUMPIFNEQS, 1) \
+    X(EXIT, 1) X(BREAK, 0) X(DPRINT, 1) X(LABEL, 1) X(END, 0) X(MISSING, 0)
+
+#define VM_OP_ENUM(name, arity) VM_OP_##name,
+typedef enum {
+    VM_OPS(VM_OP_ENUM)
+    VM_OP_COUNT,
+} vm_op_t;
+#undef VM_OP_ENUM
+
+#define VM_OP_NAME(name, arity) #name,
+static const char *const vm_op_names[] = { VM_OPS(VM_OP_NAME) };
+#undef VM_OP_NAME
+
+#define VM_OP_ARITY(name, arity) arity,
+static const int vm_op_arity[] = { VM_OPS(VM_OP_ARITY) };
+#undef VM_OP_ARITY
+
+typedef enum {
+    VM_UNDEFINED,       // Slot of a variable whose DEFVAR has not run
+    VM_UNSET,           // Defined variable without a value
+    VM_NIL,
+    VM_INT,
+    VM_FLOAT,
+    VM_BOOL,
+    VM_STRING,
+} vm_kind_t;
+
+typedef struct {
+    int refs;
+    bool ascii;             // Every character is one byte
+    size_t length;          // Length in bytes
+    char bytes[];           // UTF-8 text, terminated by '\0'
+} vm_string_t;
+
+typedef struct {
+    vm_kind_t kind;
+    union {
+        long long i;
+        double f;
+        bool b;
+        vm_string_t *s;
+    } as;
+} vm_value_t;
+
+typedef enum {
+    VM_ARG_NONE,
+    VM_ARG_CONST,
+    VM_ARG_GF,
+    VM_ARG_LF,
+    VM_ARG_TF,
+} vm_arg_kind_t;
+
+typedef struct {
+    vm_arg_kind_t kind;
+    int slot;
+    vm_value_t constant;
+} vm_arg_t;
+
+typedef struct {
+    const void *handler;        // Address of the implementation with threaded dispatch
+    vm_op_t op;
+    vm_op_t base;               // Operation of a stack instruction without the 'S' suffix
+    int target;                 // Jump or call target, slots of a created frame or type read
+    vm_arg_t args[IR_MAX_OPERANDS];
+} vm_instr_t;
+
+typedef struct vm_frame {
+    int size;
+    struct vm_frame *next_free;
+    vm_value_t slots[];
+} vm_frame_t;
+
+typedef struct {
+    const char *name;
+    int index;
+} vm_name_t;
+
+typedef struct {
+    vm_name_t *names;
+    int count, capacity;
+} vm_names_t;
+
+typedef struct {
+    vm_instr_t *code;
+    int code_count, code_capacity;
+    vm_frame_t *global;
+    vm_frame_t **frames;        // Local frame stack
+    int frame_count, frame_capacity;
+    vm_frame_t *temporary;
+    vm_frame_t *free_frames[VM_FRAME_CACHE];
+    vm_value_t *stack;
+    int stack_count, stack_capacity;
+    vm_instr_t **calls;         // Return addresses
+    int call_count, call_capacity;
+    FILE *in;
+    FILE *out;
+    char *line;                 // Buffer of READ
+    size_t line_capacity;
+    long budget;                // Jumps and calls left to execute
+    bool evaluating;            // Compile-time evaluation, see vm_evaluate()
+    bool missing;               // Evaluation ran into code that was not loaded
+    int return_slot;            // Global slot of GF@return
+    int status;
+} vm_t;
+
+/**
+ * @brief Grows a dynamic array, exiting on allocation failure.
+ */
+static void *vm_grow(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, *capacity * item_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Could not allocate memory for the virtual machine.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static void *vm_alloc(size_t size) {
+    void *memory = malloc(size ? size : 1);
+    if (!memory) {
+        fprintf(stderr, "Error: Could not allocate memory for the virtual machine.\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/**
+ * @brief Reports a run-time error.
+ * @return False, so failing helpers can return its result.
+ */
+static bool vm_fail(vm_t *vm, int status, const char *format, ...) {
+    vm->status = status;
+    if (vm->evaluating) return false;
+    va_list args;
+    va_start(args, format);
+    fflush(vm->out);
+    fprintf(stderr, "Error: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    return false;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Values                                                                    */
+/* ------------------------------------------------------------------------ */
+
+static vm_string_t *vm_string_new(const char *bytes, size_t length) {
+    vm_string_t *string = vm_alloc(sizeof(vm_string_t) + length + 1);
+    string->refs = 1;
+    string->length = length;
+    string->ascii = true;
+    for (size_t i = 0; i < length; i++) {
+        if ((unsigned char)bytes[i] >= 128) string->ascii = false;
+    }
+    memcpy(string->bytes, bytes, length);
+    string->bytes[length] = '\0';
+    return string;
+}
+
+static vm_value_t vm_string(const char *bytes, size_t length) {
+    vm_value_t value = { .kind = VM_STRING, .as.s = vm_string_new(bytes, length) };
+    return value;
+}
+
+static vm_value_t vm_int(long long number) {
+    vm_value_t value = { .kind = VM_INT, .as.i = number };
+    return value;
+}
+
+static vm_value_t vm_float(double number) {
+    vm_value_t value = { .kind = VM_FLOAT, .as.f = number };
+    return value;
+}
+
+static vm_value_t vm_bool(bool truth) {
+    vm_value_t value = { .kind = VM_BOOL, .as.b = truth };
+    return value;
+}
+
+static vm_value_t vm_nil(void) {
+    vm_value_t value = { .kind = VM_NIL };
+    return value;
+}
+
+static void vm_retain(const vm_value_t *value) {
+    if (value->kind == VM_STRING) value->as.s->refs++;
+}
+
+static void vm_release(vm_value_t *value) {
+    if (value->kind == VM_STRING && --value->as.s->refs == 0) {
+        free(value->as.s);
+    }
+    value->kind = VM_UNSET;
+}
+
+/**
+ * @brief Returns the number of bytes of the UTF-8 sequence starting with a byte.
+ */
+static size_t vm_utf8_size(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+static size_t vm_utf8_encode(long code, char *out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+static long vm_utf8_decode(const char *bytes, size_t size) {
+    const unsigned char *text = (const unsigned char *)bytes;
+    if (size == 1) return text[0];
+    long code = text[0] & (0xFF >> (size + 1));
+    for (size_t i = 1; i < size; i++) {
+        code = (code << 6) | (text[i] & 0x3F);
+    }
+    return code;
+}
+
+/**
+ * @brief Returns the number of characters of a string.
+ */
+static long long vm_char_count(const vm_string_t *string) {
+    if (string->ascii) return (long long)string->length;
+    long long count = 0;
+    for (size_t i = 0; i < string->length; i += vm_utf8_size((unsigned char)string->bytes[i])) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the bytes of a character of a string.
+ * @return False if the index is out of range.
+ */
+static bool vm_char_at(const vm_string_t *string, long long index, size_t *offset, size_t *size) {
+    if (index < 0) return false;
+    if (string->ascii) {
+        if (index >= (long long)string->length) return false;
+        *offset = (size_t)index;
+        *size = 1;
+        return true;
+    }
+    size_t i = 0;
+    for (; i < string->length && index > 0; index--) {
+        i += vm_utf8_size((unsigned char)string->bytes[i]);
+    }
+    if (i >= string->length) return false;
+    *offset = i;
+    *size = vm_utf8_size((unsigned char)string->bytes[i]);
+    if (i + *size > string->length) *size = string->length - i;
+    return true;
+}
+
+/**
+ * @brief Parses a literal operand.
+ * @return False if the operand is no valid literal.
+ */
+static bool vm_parse_literal(const char *text, vm_value_t *value) {
+    char *end;
+    if (strncmp(text, "int@", 4) == 0) {
+        *value = vm_int(strtoll(text + 4, &end, 10));
+        return end != text + 4 && *end == '\0';
+    }
+    if (strncmp(text, "float@", 6) == 0) {
+        *value = vm_float(strtod(text + 6, &end));
+        return end != text + 6 && *end == '\0';
+    }
+    if (strncmp(text, "bool@", 5) == 0) {
+        *value = vm_bool(strcmp(text + 5, "true") == 0);
+        return strcmp(text + 5, "true") == 0 || strcmp(text + 5, "false") == 0;
+    }
+    if (strcmp(text, "nil@nil") == 0) {
+        *value = vm_nil();
+        return true;
+    }
+    if (strncmp(text, "string@", 7) != 0) return false;
+
+    text += 7;
+    char *bytes = vm_alloc(4 * strlen(text) + 1);
+    size_t length = 0;
+    while (*text) {
+        if (*text == '\\') {
+            if (!isdigit((unsigned char)text[1]) || !isdigit((unsigned char)text[2]) || !isdigit((unsigned char)text[3])) {
+                free(bytes);
+                return false;
+            }
+            long code = (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+            length += vm_utf8_encode(code, bytes + length);
+            text += 4;
+        } else {
+            bytes[length++] = *text++;
+        }
+    }
+    *value = vm_string(bytes, length);
+    free(bytes);
+    return true;
+}
+
+static const char *vm_type_name(vm_kind_t kind) {
+    switch (kind) {
+        case VM_NIL:    return "nil";
+        case VM_INT:    return "int";
+        case VM_FLOAT:  return "float";
+        case VM_BOOL:   return "bool";
+        case VM_STRING: return "string";
+        default:        return "";
+    }
+}
+
+static void vm_print(const vm_value_t *value, FILE *out) {
+    switch (value->kind) {
+        case VM_INT:    fprintf(out, "%lld", value->as.i); break;
+        case VM_FLOAT:  fprintf(out, "%a", value->as.f); break;
+        case VM_BOOL:   fputs(value->as.b ? "true" : "false", out); break;
+        case VM_STRING: fwrite(value->as.s->bytes, 1, value->as.s->length, out); break;
+        default:        break;
+    }
+}
+
+/**
+ * @brief Writes a value as a literal operand, encoded like the scanner encodes literals.
+ * @return Newly allocated operand, or NULL for a variable without a value.
+ */
+static char *vm_format(const vm_value_t *value) {
+    char *text = vm_alloc(value->kind == VM_STRING ? strlen("string@") + 4 * value->as.s->length + 1 : 64);
+    switch (value->kind) {
+        case VM_INT:
+            snprintf(text, 64, "int@%lld", value->as.i);
+            break;
+        case VM_FLOAT:
+            snprintf(text, 64, "float@%a", value->as.f);
+            break;
+        case VM_BOOL:
+            snprintf(text, 64, "bool@%s", value->as.b ? "true" : "false");
+            break;
+        case VM_NIL:
+            snprintf(text, 64, "nil@nil");
+            break;
+        case VM_STRING: {
+            char *out = text + sprintf(text, "string@");
+            for (size_t i = 0; i < value->as.s->length; i++) {
+                int c = (unsigned char)value->as.s->bytes[i];
+                if (c <= 32 || c == '#' || c == '\\') {
+                    out += sprintf(out, "\\%03d", c);
+                } else {
+                    *out++ = (char)c;
+                }
+            }
+            *out = '\0';
+            break;
+        }
+        default:
+            free(text);
+            return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Orders two strings, byte order of UTF-8 is the order of the characters.
+ */
+static int vm_compare_strings(const vm_string_t *a, const vm_string_t *b) {
+    size_t common = a->length < b->length ? a->length : b->length;
+    int order = memcmp(a->bytes, b->bytes, common);
+    if (order != 0) return order;
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+/**
+ * @brief Tests two values for equality, nil equals only nil.
+ * @return 1 if equal, 0 if not, -1 if the types cannot be compared.
+ */
+static int vm_equal(const vm_value_t *a, const vm_value_t *b) {
+    if (a->kind == VM_NIL || b->kind == VM_NIL) return a->kind == b->kind;
+    if (a->kind != b->kind) return -1;
+    switch (a->kind) {
+        case VM_INT:    return a->as.i == b->as.i;
+        case VM_FLOAT:  return a->as.f == b->as.f;
+        case VM_BOOL:   return a->as.b == b->as.b;
+        case VM_STRING: return vm_compare_strings(a->as.s, b->as.s) == 0;
+        default:        return -1;
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Operations                                                                */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Produces an integer result, an evaluation fails outside the range of i32 like constant folding does.
+ */
+static bool vm_int_result(vm_t *vm, long long number, vm_value_t *result) {
+    if (vm->evaluating && (number < INT_MIN || number > INT_MAX)) {
+        return vm_fail(vm, VM_ERROR_OPERAND, "Integer result out of range");
+    }
+    *result = vm_int(number);
+    return true;
+}
+
+/**
+ * @brief Checks that an evaluation counts and indexes the characters of a string like any interpreter.
+ * @details Only ASCII strings have one byte per character everywhere.
+ */
+static bool vm_portable(vm_t *vm, const vm_string_t *string) {
+    return !vm->evaluating || string->ascii || vm_fail(vm, VM_ERROR_STRING, "Characters of a non-ASCII string");
+}
+
+/**
+ * @brief Evaluates an instruction that computes a value from its arguments.
+ * @param b Second argument, unused by unary operations.
+ * @return False on a run-time error.
+ */
+static bool vm_compute(vm_t *vm, vm_op_t op, const vm_value_t *a, const vm_value_t *b, vm_value_t *result) {
+    switch (op) {
+        case VM_OP_ADD:
+        case VM_OP_SUB:
+        case VM_OP_MUL:
+            if (a->kind == VM_INT && b->kind == VM_INT) {
+                // Wrap around on overflow instead of undefined behaviour
+                unsigned long long x = (unsigned long long)a->as.i, y = (unsigned long long)b->as.i;
+                return vm_int_result(vm, (long long)(op == VM_OP_ADD ? x + y : op == VM_OP_SUB ? x - y : x * y), result);
+            }
+            if (a->kind == VM_FLOAT && b->kind == VM_FLOAT) {
+                double x = a->as.f, y = b->as.f;
+                *result = vm_float(op == VM_OP_ADD ? x + y : op == VM_OP_SUB ? x - y : x * y);
+                return true;
+            }
+            return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[op]);
+        case VM_OP_DIV:
+            if (a->kind != VM_FLOAT || b->kind != VM_FLOAT) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of DIV");
+            }
+            if (b->as.f == 0.0) return vm_fail(vm, VM_ERROR_OPERAND, "Division by zero");
+            *result = vm_float(a->as.f / b->as.f);
+            return true;
+        case VM_OP_IDIV:
+            if (a->kind != VM_INT || b->kind != VM_INT) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of IDIV");
+            }
+            if (b->as.i == 0) return vm_fail(vm, VM_ERROR_OPERAND, "Division by zero");
+            // Rounding of negative quotients is left to the interpreter the program runs on
+            if (vm->evaluating && (a->as.i < 0 || b->as.i < 0)) return vm_fail(vm, VM_ERROR_OPERAND, "Negative IDIV");
+            *result = vm_int(b->as.i == -1 ? (long long)(0ULL - (unsigned long long)a->as.i) : a->as.i / b->as.i);
+            return true;
+        case VM_OP_LT:
+        case VM_OP_GT: {
+            if (a->kind != b->kind || a->kind == VM_NIL) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[op]);
+            }
+            int order;
+            switch (a->kind) {
+                case VM_INT:    order = (a->as.i > b->as.i) - (a->as.i < b->as.i); break;
+                case VM_FLOAT:  order = (a->as.f > b->as.f) - (a->as.f < b->as.f); break;
+                case VM_BOOL:   order = (int)a->as.b - (int)b->as.b; break;
+                default:        order = vm_compare_strings(a->as.s, b->as.s); break;
+            }
+            *result = vm_bool(op == VM_OP_LT ? order < 0 : order > 0);
+            return true;
+        }
+        case VM_OP_EQ: {
+            int equal = vm_equal(a, b);
+            if (equal < 0) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of EQ");
+            *result = vm_bool(equal);
+            return true;
+        }
+        case VM_OP_AND:
+        case VM_OP_OR:
+            if (a->kind != VM_BOOL || b->kind != VM_BOOL) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[op]);
+            }
+            *result = vm_bool(op == VM_OP_AND ? a->as.b && b->as.b : a->as.b || b->as.b);
+            return true;
+        case VM_OP_NOT:
+            if (a->kind != VM_BOOL) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of NOT");
+            *result = vm_bool(!a->as.b);
+            return true;
+        case VM_OP_INT2FLOAT:
+            if (a->kind != VM_INT) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of INT2FLOAT");
+            *result = vm_float((double)a->as.i);
+            return true;
+        case VM_OP_FLOAT2INT:
+            if (a->kind != VM_FLOAT) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of FLOAT2INT");
+            if (!(a->as.f > (double)LLONG_MIN - 1.0 && a->as.f < (double)LLONG_MAX)) {
+                return vm_fail(vm, VM_ERROR_OPERAND, "FLOAT2INT of a value out of range");
+            }
+            return vm_int_result(vm, (long long)a->as.f, result);
+        case VM_OP_INT2CHAR: {
+            if (a->kind != VM_INT) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of INT2CHAR");
+            if (a->as.i < 0 || a->as.i > 0x10FFFF) return vm_fail(vm, VM_ERROR_STRING, "INT2CHAR of an invalid code");
+            if (vm->evaluating && a->as.i > 127) return vm_fail(vm, VM_ERROR_STRING, "INT2CHAR of a non-ASCII code");
+            char bytes[4];
+            *result = vm_string(bytes, vm_utf8_encode((long)a->as.i, bytes));
+            return true;
+        }
+        case VM_OP_STRI2INT:
+        case VM_OP_GETCHAR: {
+            if (a->kind != VM_STRING || b->kind != VM_INT) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[op]);
+            }
+            if (!vm_portable(vm, a->as.s)) return false;
+            size_t offset, size;
+            if (!vm_char_at(a->as.s, b->as.i, &offset, &size)) {
+                return vm_fail(vm, VM_ERROR_STRING, "%s index out of range", vm_op_names[op]);
+            }
+            if (op == VM_OP_STRI2INT) {
+                *result = vm_int(vm_utf8_decode(a->as.s->bytes + offset, size));
+            } else {
+                *result = vm_string(a->as.s->bytes + offset, size);
+            }
+            return true;
+        }
+        case VM_OP_CONCAT: {
+            if (a->kind != VM_STRING || b->kind != VM_STRING) {
+                return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of CONCAT");
+            }
+            vm_string_t *joined = vm_alloc(sizeof(vm_string_t) + a->as.s->length + b->as.s->length + 1);
+            joined->refs = 1;
+            joined->ascii = a->as.s->ascii && b->as.s->ascii;
+            joined->length = a->as.s->length + b->as.s->length;
+            memcpy(joined->bytes, a->as.s->bytes, a->as.s->length);
+            memcpy(joined->bytes + a->as.s->length, b->as.s->bytes, b->as.s->length + 1);
+            result->kind = VM_STRING;
+            result->as.s = joined;
+            return true;
+        }
+        case VM_OP_STRLEN:
+            if (a->kind != VM_STRING) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of STRLEN");
+            if (!vm_portable(vm, a->as.s)) return false;
+            *result = vm_int(vm_char_count(a->as.s));
+            return true;
+        default:
+            return vm_fail(vm, VM_ERROR_CODE, "Unsupported instruction %s", vm_op_names[op]);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Frames and the data stack                                                 */
+/* ------------------------------------------------------------------------ */
+
+static vm_frame_t *vm_frame_new(vm_t *vm, int size) {
+    vm_frame_t *frame;
+    if (size < VM_FRAME_CACHE && vm->free_frames[size]) {
+        frame = vm->free_frames[size];
+        vm->free_frames[size] = frame->next_free;
+    } else {
+        frame = vm_alloc(sizeof(vm_frame_t) + size * sizeof(vm_value_t));
+        frame->size = size;
+    }
+    for (int i = 0; i < size; i++) {
+        frame->slots[i].kind = VM_UNDEFINED;
+    }
+    return frame;
+}
+
+static void vm_frame_free(vm_t *vm, vm_frame_t *frame) {
+    if (frame == NULL) return;
+    for (int i = 0; i < frame->size; i++) {
+        vm_release(&frame->slots[i]);
+    }
+    if (frame->size < VM_FRAME_CACHE) {
+        frame->next_free = vm->free_frames[frame->size];
+        vm->free_frames[frame->size] = frame;
+    } else {
+        free(frame);
+    }
+}
+
+/**
+ * @brief Finds the slot of a variable operand.
+ * @return The slot, or NULL on a run-time error.
+ */
+static vm_value_t *vm_variable(vm_t *vm, const vm_arg_t *arg) {
+    vm_frame_t *frame;
+    switch (arg->kind) {
+        case VM_ARG_GF:
+            frame = vm->global;
+            break;
+        case VM_ARG_LF:
+            frame = vm->frame_count > 0 ? vm->frames[vm->frame_count - 1] : NULL;
+            break;
+        case VM_ARG_TF:
+            frame = vm->temporary;
+            break;
+        default:
+            vm_fail(vm, VM_ERROR_CODE, "Operand is not a variable");
+            return NULL;
+    }
+    if (frame == NULL) {
+        vm_fail(vm, VM_ERROR_FRAME, "Frame does not exist");
+        return NULL;
+    }
+    if (arg->slot >= frame->size || frame->slots[arg->slot].kind == VM_UNDEFINED) {
+        vm_fail(vm, VM_ERROR_VARIABLE, "Access to an undefined variable");
+        return NULL;
+    }
+    return &frame->slots[arg->slot];
+}
+
+/**
+ * @brief Reads a symbol operand, the value stays owned by the variable or literal.
+ * @return The value, or NULL on a run-time error.
+ */
+static const vm_value_t *vm_read(vm_t *vm, const vm_arg_t *arg) {
+    if (arg->kind == VM_ARG_CONST) return &arg->constant;
+    const vm_value_t *value = vm_variable(vm, arg);
+    if (value && value->kind == VM_UNSET) {
+        vm_fail(vm, VM_ERROR_VALUE, "Read of a variable without a value");
+        return NULL;
+    }
+    return value;
+}
+
+/**
+ * @brief Stores a value in a variable, which takes over the value.
+ */
+static bool vm_store(vm_t *vm, const vm_arg_t *arg, vm_value_t value) {
+    vm_value_t *variable = vm_variable(vm, arg);
+    if (variable == NULL) {
+        vm_release(&value);
+        return false;
+    }
+    vm_release(variable);
+    *variable = value;
+    return true;
+}
+
+static void vm_push(vm_t *vm, vm_value_t value) {
+    if (vm->stack_count == vm->stack_capacity) {
+        vm->stack = vm_grow(vm->stack, &vm->stack_capacity, sizeof(vm_value_t));
+    }
+    vm->stack[vm->stack_count++] = value;
+}
+
+static bool vm_pop(vm_t *vm, vm_value_t *value) {
+    if (vm->stack_count == 0) return vm_fail(vm, VM_ERROR_VALUE, "Pop from an empty data stack");
+    *value = vm->stack[--vm->stack_count];
+    return true;
+}
+
+/**
+ * @brief Reads a line of input without its line break.
+ * @return False at the end of input.
+ */
+static bool vm_read_line(vm_t *vm, size_t *length) {
+    int c = fgetc(vm->in);
+    if (c == EOF) return false;
+    *length = 0;
+    while (c != EOF && c != '\n') {
+        if (*length + 1 >= vm->line_capacity) {
+            vm->line_capacity = vm->line_capacity ? 2 * vm->line_capacity : 128;
+            vm->line = realloc(vm->line, vm->line_capacity);
+            if (vm->line == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for the virtual machine.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        vm->line[(*length)++] = (char)c;
+        c = fgetc(vm->in);
+    }
+    if (vm->line == NULL) {
+        vm->line_capacity = 128;
+        vm->line = vm_alloc(vm->line_capacity);
+    }
+    vm->line[*length] = '\0';
+    return true;
+}
+
+/**
+ * @brief Reads a value of the given type, nil at the end of input or on malformed input.
+ */
+static vm_value_t vm_read_value(vm_t *vm, vm_kind_t type) {
+    size_t length;
+    if (!vm_read_line(vm, &length)) return vm_nil();
+    if (type == VM_STRING) return vm_string(vm->line, length);
+
+    char *text = vm->line;
+    while (isspace((unsigned char)*text)) text++;
+    char *last = vm->line + length;
+    while (last > text && isspace((unsigned char)last[-1])) *--last = '\0';
+    char *end;
+    if (type == VM_INT) {
+        long long number = strtoll(text, &end, 10);
+        return end != text && *end == '\0' ? vm_int(number) : vm_nil();
+    }
+    if (type == VM_FLOAT) {
+        double number = strtod(text, &end);
+        return end != text && *end == '\0' ? vm_float(number) : vm_nil();
+    }
+    bool truth = strlen(text) == 4;
+    for (int i = 0; truth && i < 4; i++) {
+        truth = tolower((unsigned char)text[i]) == "true"[i];
+    }
+    return vm_bool(truth);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Loading                                                                   */
+/* ------------------------------------------------------------------------ */
+
+static int vm_name_compare(const void *a, const void *b) {
+    return strcmp(((const vm_name_t *)a)->name, ((const vm_name_t *)b)->name);
+}
+
+/**
+ * @brief Finds a name in a sorted table, NULL if missing.
+ */
+static vm_name_t *vm_name_find(const vm_names_t *table, const char *name) {
+    if (table->count == 0) return NULL;
+    vm_name_t key = { name, 0 };
+    return bsearch(&key, table->names, table->count, sizeof(vm_name_t), vm_name_compare);
+}
+
+/**
+ * @brief Returns the slot of a variable name, adding it to the table if missing.
+ */
+static int vm_slot(vm_names_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->names[i].name, name) == 0) return table->names[i].index;
+    }
+    if (table->count == table->capacity) {
+        table->names = vm_grow(table->names, &table->capacity, sizeof(vm_name_t));
+    }
+    table->names[table->count].name = name;
+    table->names[table->count].index = table->count;
+    return table->count++;
+}
+
+static bool vm_is_branch(vm_op_t op) {
+    return op == VM_OP_JUMP || op == VM_OP_JUMPIFEQ || op == VM_OP_JUMPIFNEQ ||
+           op == VM_OP_JUMPIFEQS || op == VM_OP_JUMPIFNEQS || op == VM_OP_CALL;
+}
+
+static vm_op_t vm_lookup_op(const char *name) {
+    for (int op = 0; op < VM_OP_COUNT; op++) {
+        if (strcmp(vm_op_names[op], name) == 0) return (vm_op_t)op;
+    }
+    return VM_OP_COUNT;
+}
+
+/**
+ * @brief Lowers all instructions of the program to bytecode.
+ * @details A function, whose local variables get their own slot numbers,
+ *          starts with each function list and, in the header, at each label
+ *          that is called. Labels refer to the next instruction. Dead
+ *          instructions are left out. An evaluation may load only part of the
+ *          program, its jumps and calls to labels that are not loaded go to a
+ *          MISSING instruction.
+ * @param entry Label to start at, or NULL to start at the first instruction.
+ * @param start Set to the index of the first instruction to run.
+ * @return False on malformed code.
+ */
+static bool vm_load(vm_t *vm, ir_list_t **lists, int list_count, const char *entry, int *start) {
+    vm_names_t labels = { NULL, 0, 0 }, calls = { NULL, 0, 0 }, globals = { NULL, 0, 0 };
+
+    // Called labels and label positions
+    int position = 0;
+    for (int l = 0; l < list_count; l++) {
+        for (ir_instr_t *instr = lists[l]->head; instr; instr = instr->next) {
+            if (instr->opcode[0] == '.' || instr->dead) continue;
+            if (ir_is(instr, "CALL") && instr->operand_count == 1) {
+                if (calls.count == calls.capacity) calls.names = vm_grow(calls.names, &calls.capacity, sizeof(vm_name_t));
+                calls.names[calls.count].name = instr->operands[0];
+                calls.names[calls.count++].index = 0;
+            }
+            if (ir_is(instr, "LABEL") && instr->operand_count == 1) {
+                if (labels.count == labels.capacity) labels.names = vm_grow(labels.names, &labels.capacity, sizeof(vm_name_t));
+                labels.names[labels.count].name = instr->operands[0];
+                labels.names[labels.count++].index = position;
+            } else {
+                position++;
+            }
+        }
+    }
+    if (labels.count > 0) qsort(labels.names, labels.count, sizeof(vm_name_t), vm_name_compare);
+    if (calls.count > 0) qsort(calls.names, calls.count, sizeof(vm_name_t), vm_name_compare);
+    for (int i = 1; i < labels.count; i++) {
+        if (strcmp(labels.names[i - 1].name, labels.names[i].name) == 0) {
+            vm_fail(vm, VM_ERROR_SEMANTIC, "Redefinition of label %s", labels.names[i].name);
+            break;
+        }
+    }
+
+    vm_names_t locals = { NULL, 0, 0 };
+    int *create_frames = NULL;  // CREATEFRAME instructions of the current function
+    int create_count = 0, create_capacity = 0;
+    for (int l = 0; l <= list_count && vm->status == 0; l++) {
+        ir_instr_t *instr = l < list_count ? lists[l]->head : NULL;
+        bool function_start = true;
+        while (vm->status == 0) {
+            bool called = instr && ir_is(instr, "LABEL") && instr->operand_count == 1 &&
+                          (vm_name_find(&calls, instr->operands[0]) ||
+                           strcmp(instr->operands[0], "$main") == 0);
+            if (function_start || called || instr == NULL) {
+                for (int i = 0; i < create_count; i++) {
+                    vm->code[create_frames[i]].target = locals.count;
+                }
+                create_count = 0;
+                locals.count = 0;
+                function_start = false;
+            }
+            if (instr == NULL) break;
+            if (instr->opcode[0] == '.' || instr->dead || ir_is(instr, "LABEL")) {
+                instr = instr->next;
+                continue;
+            }
+
+            vm_op_t op = vm_lookup_op(instr->opcode);
+            if (op == VM_OP_COUNT || op == VM_OP_END || op == VM_OP_MISSING || instr->operand_count != vm_op_arity[op]) {
+                vm_fail(vm, VM_ERROR_CODE, "Malformed instruction %s", instr->opcode);
+                break;
+            }
+            if (vm->code_count == vm->code_capacity) {
+                vm->code = vm_grow(vm->code, &vm->code_capacity, sizeof(vm_instr_t));
+            }
+            vm_instr_t *code = &vm->code[vm->code_count];
+            memset(code, 0, sizeof(vm_instr_t));
+            code->op = op;
+            code->base = op;
+            const char *name = vm_op_names[op];
+            size_t name_length = strlen(name);
+            if (op >= VM_OP_ADDS && op <= VM_OP_INT2CHARS) {
+                char base[16];
+                snprintf(base, sizeof(base), "%.*s", (int)(name_length - 1), name);
+                code->base = vm_lookup_op(base);
+            }
+            if (op == VM_OP_CREATEFRAME) {
+                if (create_count == create_capacity) create_frames = vm_grow(create_frames, &create_capacity, sizeof(int));
+                create_frames[create_count++] = vm->code_count;
+            }
+
+            for (int i = 0; i < instr->operand_count && vm->status == 0; i++) {
+                const char *operand = instr->operands[i];
+                vm_arg_t *arg = &code->args[i];
+                if (i == 0 && vm_is_branch(op)) {
+                    vm_name_t *found = vm_name_find(&labels, operand);
+                    if (found) code->target = found->index;
+                    else if (vm->evaluating) code->target = -1;
+                    else vm_fail(vm, VM_ERROR_SEMANTIC, "Undefined label %s", operand);
+                } else if (i == 1 && op == VM_OP_READ) {
+                    vm_kind_t types[] = { VM_INT, VM_FLOAT, VM_STRING, VM_BOOL };
+                    const char *type_names[] = { "int", "float", "string", "bool" };
+                    code->target = -1;
+                    for (int t = 0; t < 4; t++) {
+                        if (strcmp(operand, type_names[t]) == 0) code->target = (int)types[t];
+                    }
+                    if (code->target < 0) vm_fail(vm, VM_ERROR_CODE, "Invalid type %s", operand);
+                } else if (strncmp(operand, "GF@", 3) == 0) {
+                    arg->kind = VM_ARG_GF;
+                    arg->slot = vm_slot(&globals, operand + 3);
+                } else if (strncmp(operand, "LF@", 3) == 0 || strncmp(operand, "TF@", 3) == 0) {
+                    arg->kind = operand[0] == 'L' ? VM_ARG_LF : VM_ARG_TF;
+                    arg->slot = vm_slot(&locals, operand + 3);
+                } else if (vm_parse_literal(operand, &arg->constant)) {
+                    arg->kind = VM_ARG_CONST;
+                } else {
+                    vm_fail(vm, VM_ERROR_CODE, "Invalid operand %s", operand);
+                }
+            }
+            vm->code_count++;
+            instr = instr->next;
+        }
+    }
+
+    vm_op_t ends[] = { VM_OP_END, VM_OP_MISSING };
+    for (int i = 0; i < 2; i++) {
+        if (vm->code_count == vm->code_capacity) {
+            vm->code = vm_grow(vm->code, &vm->code_capacity, sizeof(vm_instr_t));
+        }
+        memset(&vm->code[vm->code_count], 0, sizeof(vm_instr_t));
+        vm->code[vm->code_count].op = ends[i];
+        vm->code[vm->code_count].base = ends[i];
+        vm->code_count++;
+    }
+    for (int i = 0; i < vm->code_count; i++) {
+        if (vm_is_branch(vm->code[i].op) && vm->code[i].target < 0) vm->code[i].target = vm->code_count - 1;
+    }
+
+    *start = 0;
+    if (entry) {
+        vm_name_t *found = vm_name_find(&labels, entry);
+        *start = found ? found->index : vm->code_count - 1;
+    }
+    vm->return_slot = vm_slot(&globals, "return");
+    vm->global = vm_frame_new(vm, globals.count);
+    free(labels.names);
+    free(calls.names);
+    free(globals.names);
+    free(locals.names);
+    free(create_frames);
+    return vm->status == 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Execution                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#ifdef VM_THREADED
+// Computed goto is a GNU extension, the switch below is the portable fallback
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define VM_CASE(name) vm_op_##name:
+#define VM_DISPATCH() goto *pc->handler
+#else
+#define VM_CASE(name) case VM_OP_##name:
+#define VM_DISPATCH() continue
+#endif
+
+#define VM_TRY(condition) do { if (!(condition)) return vm->status; } while (0)
+
+// Jumps and calls spend the budget, every loop and recursion runs through one
+#define VM_SPEND() do { if (--vm->budget < 0) return vm_fail(vm, VM_ERROR_BUDGET, "Budget exhausted"), vm->status; } while (0)
+
+// Input, output and exits cannot be repeated at compile time
+#define VM_EFFECT() do { if (vm->evaluating) return vm_fail(vm, VM_ERROR_CODE, "Side effect"), vm->status; } while (0)
+
+/**
+ * @brief Runs the loaded bytecode.
+ * @param start Index of the first instruction.
+ * @return Exit code of the program.
+ */
+static int vm_execute(vm_t *vm, int start) {
+#ifdef VM_THREADED
+#define VM_HANDLER(name, arity) &&vm_op_##name,
+    static const void *const handlers[] = { VM_OPS(VM_HANDLER) };
+#undef VM_HANDLER
+    for (int i = 0; i < vm->code_count; i++) {
+        vm->code[i].handler = handlers[vm->code[i].op];
+    }
+#endif
+    vm_instr_t *code = vm->code;
+    vm_instr_t *pc = code + start;
+
+#ifdef VM_THREADED
+    VM_DISPATCH();
+#else
+    for (;;) switch (pc->op) {
+#endif
+
+    VM_CASE(MOVE) {
+        const vm_value_t *value = vm_read(vm, &pc->args[1]);
+        VM_TRY(value);
+        vm_value_t copy = *value;
+        vm_retain(&copy);
+        VM_TRY(vm_store(vm, &pc->args[0], copy));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(CREATEFRAME) {
+        vm_frame_free(vm, vm->temporary);
+        vm->temporary = vm_frame_new(vm, pc->target);
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(PUSHFRAME) {
+        if (vm->temporary == NULL) return vm_fail(vm, VM_ERROR_FRAME, "PUSHFRAME without a temporary frame"), vm->status;
+        if (vm->frame_count == vm->frame_capacity) {
+            vm->frames = vm_grow(vm->frames, &vm->frame_capacity, sizeof(vm_frame_t *));
+        }
+        vm->frames[vm->frame_count++] = vm->temporary;
+        vm->temporary = NULL;
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(POPFRAME) {
+        if (vm->frame_count == 0) return vm_fail(vm, VM_ERROR_FRAME, "POPFRAME without a local frame"), vm->status;
+        vm_frame_free(vm, vm->temporary);
+        vm->temporary = vm->frames[--vm->frame_count];
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(DEFVAR) {
+        const vm_arg_t *arg = &pc->args[0];
+        vm_frame_t *frame = arg->kind == VM_ARG_GF ? vm->global :
+                            arg->kind == VM_ARG_TF ? vm->temporary :
+                            vm->frame_count > 0 ? vm->frames[vm->frame_count - 1] : NULL;
+        if (frame == NULL) return vm_fail(vm, VM_ERROR_FRAME, "Frame does not exist"), vm->status;
+        if (arg->slot >= frame->size) return vm_fail(vm, VM_ERROR_VARIABLE, "Variable outside of its frame"), vm->status;
+        if (frame->slots[arg->slot].kind != VM_UNDEFINED) {
+            return vm_fail(vm, VM_ERROR_SEMANTIC, "Redefinition of a variable"), vm->status;
+        }
+        frame->slots[arg->slot].kind = VM_UNSET;
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(CALL) {
+        VM_SPEND();
+        if (vm->call_count == vm->call_capacity) {
+            vm->calls = vm_grow(vm->calls, &vm->call_capacity, sizeof(vm_instr_t *));
+        }
+        vm->calls[vm->call_count++] = pc + 1;
+        pc = code + pc->target;
+        VM_DISPATCH();
+    }
+    VM_CASE(RETURN) {
+        if (vm->call_count == 0) return vm_fail(vm, VM_ERROR_VALUE, "RETURN with an empty call stack"), vm->status;
+        pc = vm->calls[--vm->call_count];
+        VM_DISPATCH();
+    }
+    VM_CASE(PUSHS) {
+        const vm_value_t *value = vm_read(vm, &pc->args[0]);
+        VM_TRY(value);
+        vm_value_t copy = *value;
+        vm_retain(&copy);
+        vm_push(vm, copy);
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(POPS) {
+        vm_value_t value;
+        VM_TRY(vm_pop(vm, &value));
+        VM_TRY(vm_store(vm, &pc->args[0], value));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(CLEARS) {
+        while (vm->stack_count > 0) {
+            vm_release(&vm->stack[--vm->stack_count]);
+        }
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(ADD) VM_CASE(SUB) VM_CASE(MUL) VM_CASE(DIV) VM_CASE(IDIV) VM_CASE(LT) VM_CASE(GT) VM_CASE(EQ)
+    VM_CASE(AND) VM_CASE(OR) VM_CASE(STRI2INT) VM_CASE(CONCAT) VM_CASE(GETCHAR) {
+        const vm_value_t *a = vm_read(vm, &pc->args[1]);
+        VM_TRY(a);
+        const vm_value_t *b = vm_read(vm, &pc->args[2]);
+        VM_TRY(b);
+        vm_value_t result;
+        if (pc->op == VM_OP_ADD && a->kind == VM_INT && b->kind == VM_INT && !vm->evaluating) {
+            result = vm_int((long long)((unsigned long long)a->as.i + (unsigned long long)b->as.i));
+        } else {
+            VM_TRY(vm_compute(vm, pc->op, a, b, &result));
+        }
+        VM_TRY(vm_store(vm, &pc->args[0], result));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(NOT) VM_CASE(INT2FLOAT) VM_CASE(FLOAT2INT) VM_CASE(INT2CHAR) VM_CASE(STRLEN) {
+        const vm_value_t *a = vm_read(vm, &pc->args[1]);
+        VM_TRY(a);
+        vm_value_t result;
+        VM_TRY(vm_compute(vm, pc->op, a, NULL, &result));
+        VM_TRY(vm_store(vm, &pc->args[0], result));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(ADDS) VM_CASE(SUBS) VM_CASE(MULS) VM_CASE(DIVS) VM_CASE(IDIVS) VM_CASE(LTS) VM_CASE(GTS)
+    VM_CASE(EQS) VM_CASE(ANDS) VM_CASE(ORS) VM_CASE(STRI2INTS) {
+        if (vm->stack_count < 2) return vm_fail(vm, VM_ERROR_VALUE, "Pop from an empty data stack"), vm->status;
+        vm_value_t *a = &vm->stack[vm->stack_count - 2], *b = &vm->stack[vm->stack_count - 1];
+        vm_value_t result;
+        if (a->kind == VM_INT && b->kind == VM_INT && pc->op != VM_OP_IDIVS && pc->op != VM_OP_STRI2INTS &&
+            pc->op != VM_OP_DIVS && pc->op != VM_OP_ANDS && pc->op != VM_OP_ORS && !vm->evaluating) {
+            // Integer fast path, no strings to release
+            long long x = a->as.i, y = b->as.i;
+            unsigned long long ux = (unsigned long long)x, uy = (unsigned long long)y;
+            switch (pc->op) {
+                case VM_OP_ADDS: result = vm_int((long long)(ux + uy)); break;
+                case VM_OP_SUBS: result = vm_int((long long)(ux - uy)); break;
+                case VM_OP_MULS: result = vm_int((long long)(ux * uy)); break;
+                case VM_OP_LTS:  result = vm_bool(x < y); break;
+                case VM_OP_GTS:  result = vm_bool(x > y); break;
+                default:         result = vm_bool(x == y); break;
+            }
+        } else {
+            VM_TRY(vm_compute(vm, pc->base, a, b, &result));
+            vm_release(a);
+            vm_release(b);
+        }
+        vm->stack_count -= 2;
+        vm->stack[vm->stack_count++] = result;
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(NOTS) VM_CASE(INT2FLOATS) VM_CASE(FLOAT2INTS) VM_CASE(INT2CHARS) {
+        if (vm->stack_count < 1) return vm_fail(vm, VM_ERROR_VALUE, "Pop from an empty data stack"), vm->status;
+        vm_value_t *a = &vm->stack[vm->stack_count - 1];
+        vm_value_t result;
+        VM_TRY(vm_compute(vm, pc->base, a, NULL, &result));
+        vm_release(a);
+        *a = result;
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(READ) {
+        VM_EFFECT();
+        VM_TRY(vm_store(vm, &pc->args[0], vm_read_value(vm, (vm_kind_t)pc->target)));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(WRITE) {
+        VM_EFFECT();
+        const vm_value_t *value = vm_read(vm, &pc->args[0]);
+        VM_TRY(value);
+        vm_print(value, vm->out);
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(SETCHAR) {
+        vm_value_t *target = vm_variable(vm, &pc->args[0]);
+        VM_TRY(target);
+        const vm_value_t *index = vm_read(vm, &pc->args[1]);
+        VM_TRY(index);
+        const vm_value_t *with = vm_read(vm, &pc->args[2]);
+        VM_TRY(with);
+        if (target->kind != VM_STRING || index->kind != VM_INT || with->kind != VM_STRING) {
+            return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of SETCHAR"), vm->status;
+        }
+        VM_TRY(vm_portable(vm, target->as.s) && vm_portable(vm, with->as.s));
+        size_t offset, size, with_size;
+        if (!vm_char_at(target->as.s, index->as.i, &offset, &size) || !vm_char_at(with->as.s, 0, &(size_t){ 0 }, &with_size)) {
+            return vm_fail(vm, VM_ERROR_STRING, "SETCHAR index out of range or empty string"), vm->status;
+        }
+        vm_string_t *old = target->as.s;
+        size_t length = old->length - size + with_size;
+        char *bytes = vm_alloc(length);
+        memcpy(bytes, old->bytes, offset);
+        memcpy(bytes + offset, with->as.s->bytes, with_size);
+        memcpy(bytes + offset + with_size, old->bytes + offset + size, old->length - offset - size);
+        vm_value_t changed = vm_string(bytes, length);
+        free(bytes);
+        vm_release(target);
+        *target = changed;
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(TYPE) {
+        const vm_value_t *value = pc->args[1].kind == VM_ARG_CONST ? &pc->args[1].constant : vm_variable(vm, &pc->args[1]);
+        VM_TRY(value);
+        const char *name = vm_type_name(value->kind);
+        VM_TRY(vm_store(vm, &pc->args[0], vm_string(name, strlen(name))));
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMP) {
+        VM_SPEND();
+        pc = code + pc->target;
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMPIFEQ) VM_CASE(JUMPIFNEQ) {
+        VM_SPEND();
+        const vm_value_t *a = vm_read(vm, &pc->args[1]);
+        VM_TRY(a);
+        const vm_value_t *b = vm_read(vm, &pc->args[2]);
+        VM_TRY(b);
+        int equal = a->kind == VM_INT && b->kind == VM_INT ? a->as.i == b->as.i : vm_equal(a, b);
+        if (equal < 0) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[pc->op]), vm->status;
+        pc = equal == (pc->op == VM_OP_JUMPIFEQ) ? code + pc->target : pc + 1;
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMPIFEQS) VM_CASE(JUMPIFNEQS) {
+        VM_SPEND();
+        if (vm->stack_count < 2) return vm_fail(vm, VM_ERROR_VALUE, "Pop from an empty data stack"), vm->status;
+        vm_value_t *a = &vm->stack[vm->stack_count - 2], *b = &vm->stack[vm->stack_count - 1];
+        int equal = vm_equal(a, b);
+        if (equal < 0) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand types of %s", vm_op_names[pc->op]), vm->status;
+        vm_release(a);
+        vm_release(b);
+        vm->stack_count -= 2;
+        pc = equal == (pc->op == VM_OP_JUMPIFEQS) ? code + pc->target : pc + 1;
+        VM_DISPATCH();
+    }
+    VM_CASE(EXIT) {
+        VM_EFFECT();
+        const vm_value_t *value = vm_read(vm, &pc->args[0]);
+        VM_TRY(value);
+        if (value->kind != VM_INT) return vm_fail(vm, VM_ERROR_TYPES, "Wrong operand type of EXIT"), vm->status;
+        if (value->as.i < 0 || value->as.i > 9) return vm_fail(vm, VM_ERROR_OPERAND, "EXIT code out of range"), vm->status;
+        return (int)value->as.i;
+    }
+    VM_CASE(BREAK) {
+        VM_EFFECT();
+        fprintf(stderr, "Instruction %d, %d frames, %d values on the data stack, %d calls\n",
+                (int)(pc - code), vm->frame_count, vm->stack_count, vm->call_count);
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(DPRINT) {
+        VM_EFFECT();
+        const vm_value_t *value = vm_read(vm, &pc->args[0]);
+        VM_TRY(value);
+        vm_print(value, stderr);
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(LABEL) {
+        pc++;
+        VM_DISPATCH();
+    }
+    VM_CASE(END) {
+        return 0;
+    }
+    VM_CASE(MISSING) {
+        vm->missing = true;
+        return vm_fail(vm, VM_ERROR_SEMANTIC, "Jump or call to code that is not loaded"), vm->status;
+    }
+
+#ifndef VM_THREADED
+        default:
+            return vm_fail(vm, VM_ERROR_CODE, "Invalid bytecode"), vm->status;
+    }
+#endif
+}
+
+#undef VM_TRY
+#undef VM_SPEND
+#undef VM_EFFECT
+#undef VM_CASE
+#undef VM_DISPATCH
+#ifdef VM_THREADED
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * @brief Releases everything a loaded machine holds.
+ */
+static void vm_free(vm_t *vm) {
+    for (int i = 0; i < vm->code_count; i++) {
+        for (int j = 0; j < IR_MAX_OPERANDS; j++) {
+            if (vm->code[i].args[j].kind == VM_ARG_CONST) vm_release(&vm->code[i].args[j].constant);
+        }
+    }
+    free(vm->code);
+    while (vm->stack_count > 0) {
+        vm_release(&vm->stack[--vm->stack_count]);
+    }
+    free(vm->stack);
+    while (vm->frame_count > 0) {
+        vm_frame_free(vm, vm->frames[--vm->frame_count]);
+    }
+    free(vm->frames);
+    vm_frame_free(vm, vm->temporary);
+    vm->temporary = NULL;
+    if (vm->global) {
+        for (int i = 0; i < vm->global->size; i++) {
+            vm_release(&vm->global->slots[i]);
+        }
+        free(vm->global);
+    }
+    for (int size = 0; size < VM_FRAME_CACHE; size++) {
+        while (vm->free_frames[size]) {
+            vm_frame_t *next = vm->free_frames[size]->next_free;
+            free(vm->free_frames[size]);
+            vm->free_frames[size] = next;
+        }
+    }
+    free(vm->calls);
+    free(vm->line);
+}
+
+/**
+ * @brief Lowers the generated program to bytecode and runs it.
+ * @param header Header and built-in functions.
+ * @param functions Code of all user functions.
+ * @param count Number of functions.
+ * @param in Input of READ.
+ * @param out Output of WRITE.
+ * @return Exit code of the program, the interpreter's error code on a run-time error.
+ */
+int vm_run(ir_list_t *header, ir_list_t **functions, int count, FILE *in, FILE *out) {
+    vm_t vm;
+    memset(&vm, 0, sizeof(vm_t));
+    vm.in = in;
+    vm.out = out;
+    vm.budget = LONG_MAX;
+
+    ir_list_t **lists = vm_alloc((count + 1) * sizeof(ir_list_t *));
+    lists[0] = header;
+    for (int i = 0; i < count; i++) {
+        lists[i + 1] = functions[i];
+    }
+    int start;
+    int status = vm_load(&vm, lists, count + 1, NULL, &start) ? vm_execute(&vm, start) : vm.status;
+    fflush(out);
+    free(lists);
+    vm_free(&vm);
+    return status;
+}
+
+/**
+ * @brief Evaluates a call of a function at compile time.
+ * @details The call runs without input or output, and gives up where the
+ *          result could differ from a run on another interpreter: on integers
+ *          outside of i32, negative IDIV operands and characters of non-ASCII
+ *          strings. Global variables are defined before the call.
+ * @param lists Header and the code of the functions the call may run.
+ * @param count Number of lists.
+ * @param label Label of the called function including the '$' prefix.
+ * @param args Literal operands of the arguments in the order they are pushed.
+ * @param arg_count Number of arguments.
+ * @param budget Jumps and calls the evaluation may execute, decreased by those it does.
+ * @param missing Set if the call runs into a function that is not in the lists.
+ * @return Newly allocated literal the call returns, or NULL if it is not evaluated.
+ */
+char *vm_evaluate(ir_list_t **lists, int count, const char *label, char **args, int arg_count, long *budget, bool *missing) {
+    vm_t vm;
+    memset(&vm, 0, sizeof(vm_t));
+    vm.budget = *budget;
+    vm.evaluating = true;
+
+    char *result = NULL;
+    int start;
+    if (vm_load(&vm, lists, count, label, &start)) {
+        for (int i = 0; i < vm.global->size; i++) {
+            vm.global->slots[i].kind = VM_UNSET;
+        }
+        bool literals = true;
+        for (int i = 0; i < arg_count && literals; i++) {
+            vm_value_t value;
+            literals = vm_parse_literal(args[i], &value);
+            if (literals) vm_push(&vm, value);
+        }
+        // The call returns to the END instruction
+        vm.calls = vm_grow(vm.calls, &vm.call_capacity, sizeof(vm_instr_t *));
+        vm.calls[vm.call_count++] = &vm.code[vm.code_count - 2];
+        if (literals && vm_execute(&vm, start) == 0 && vm.status == 0) {
+            result = vm_format(&vm.global->slots[vm.return_slot]);
+        }
+    }
+    *budget = vm.budget < 0 ? 0 : vm.budget;
+    *missing = vm.missing;
+    vm_free(&vm);
+    return result;
+}
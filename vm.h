@@ -0,0 +1,16 @@
+/**
+ * IFJ24
+ * @brief Header for the bytecode virtual machine running generated IFJcode24 in-process.
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ir.h"
+
+int vm_run(ir_list_t *header, ir_list_t **functions, int count, FILE *in, FILE *out);
+char *vm_evaluate(ir_list_t **lists, int count, const char *label, char **args, int arg_count, long *budget, bool *missing);
+
+#endif